@@ -10,12 +10,26 @@
 #include <vector>
 #include <random>
 #include <functional>
-#include <any>
+#include <limits>
 
 namespace coast {
 
 class fbgd {
 
+public:
+    /*
+     * Repulsion between nodes: the grid mode only considers the nodes of the 3x3 neighborhood of a node's grid cell
+     * (cheap, but nodes crowd in dense cells and distant clusters do not push each other apart). The Barnes-Hut mode
+     * considers all nodes: a quadtree over the node positions is built on every update and distant quadrants are
+     * approximated by their center of mass. A quadrant is approximated if its size divided by its distance is below
+     * theta, i.e., smaller values are more accurate and slower (0 computes all pairs).
+     */
+    enum class repulsion_t {
+        grid,
+        barnes_hut
+    };
+
+private:
     static constexpr float region_size = 1.0f;
     static constexpr float cell_size   = 0.1f;
     static constexpr float local_size  = 0.04f;
@@ -31,17 +45,17 @@ class fbgd {
 
     static constexpr std::size_t iterations = 1;
 
+    // nodes per quadtree leaf and maximum depth (coinciding nodes end up in one deep leaf)
+    static constexpr std::size_t quad_leaf_size = 8;
+    static constexpr std::size_t quad_max_depth = 24;
+
 public:
     using node_id_t = uint32_t;
     using cell_id_t = uint32_t;
 
-    struct node {
-        node_id_t node_id;
-        cell_id_t cell_id;
-        std::array<float,2> pos;
-        bool fixed;
-        std::any payload;
-    };
+    // nodes carry a typed payload, an index into the node data of the caller
+    using payload_t = uint32_t;
+    static constexpr payload_t no_payload = std::numeric_limits<payload_t>::max();
 
     struct edge {
         node_id_t from;
@@ -52,45 +66,86 @@ private:
     std::mt19937 rgen {0};
     std::uniform_real_distribution<float> rnd_dis {0.0, region_size};
 
-    node_id_t next_node_id = 0;
-
-    bool nodes_dirty = true;
     bool edges_dirty = true;
 
-    std::vector<node> nodes;
+    /*
+     * Nodes are stored as structure of arrays indexed by node id, the kernels only touch the arrays they need.
+     * Positions are updated in two phases: all displacements (velocities) are computed in parallel from the
+     * positions of the previous update, then they are applied.
+     */
+    std::vector<float>     pos_x;
+    std::vector<float>     pos_y;
+    std::vector<float>     vel_x;
+    std::vector<float>     vel_y;
+    std::vector<uint8_t>   fixed;
+    std::vector<payload_t> payloads;
+    std::vector<node_id_t> node_order;   // 0 .. node_cnt-1, iterated by the parallel kernels
+
     std::vector<edge> edges;
 
-    using edge_it = std::vector<edge>::iterator;
-    using node_it = std::vector<node>::iterator;
+    // adjacency and "indirect siblings" (neighbors of neighbors that are neither the node itself nor its neighbors)
+    // as compressed rows, rebuilt only if nodes or edges were added
+    std::vector<uint32_t>  adj_start;
+    std::vector<node_id_t> adj;
+    std::vector<uint32_t>  sib_start;
+    std::vector<node_id_t> sib;
 
-    std::vector<uint32_t> node_look_up;
-    std::vector<std::pair<node_it,node_it>> cell_look_up;
-    std::vector<std::pair<edge_it,edge_it>> edge_look_up;
+    // grid of the grid mode, rebuilt on every update: the positions sorted by cell, the nodes of a cell are the range
+    // [cell_start[c], cell_start[c + 1])
+    std::vector<cell_id_t> node_cell;
+    std::vector<uint32_t>  cell_start;
+    std::vector<uint32_t>  cell_fill;
+    std::vector<float>     cell_x;
+    std::vector<float>     cell_y;
 
-    static constexpr cell_id_t pos_to_cell(const std::array<float,2> &pos) ;
+    static constexpr cell_id_t pos_to_cell(float x, float y);
 
-    void rebuild_cell_and_node_look_up();
+    void rebuild_grid();
     void rebuild_edge_look_up();
 
-    std::vector<std::pair<node_it,node_it>> nb_tmp;
-    std::vector<edge> sib_tmp;
+    repulsion_t repulsion = repulsion_t::grid;
+    float       theta     = 0.7f;
+
+    // quadtree of the Barnes-Hut mode, rebuilt on every update. Quadrants are stored depth first, the nodes of a
+    // quadrant are the range [begin, end) of quad_order (and of the positions copied in that order to quad_x/quad_y),
+    // the children of a quadrant follow it directly
+    struct quad_t {
+        std::array<float,2> com;     // center of mass
+        std::array<float,2> lo;      // lower corner
+        float               size;
+        uint32_t            begin;
+        uint32_t            end;
+        uint32_t            next;    // index of the next quadrant that is not a child of this one
+        bool                leaf;
+    };
+    std::vector<quad_t>    quads;
+    std::vector<node_id_t> quad_order;
+    std::vector<float>     quad_x;
+    std::vector<float>     quad_y;
 
-    using draw_func_t = std::function<
-        void(
-            const std::vector<node>&,     // nodes
-            const std::vector<edge>&,     // edges
-            const std::vector<uint32_t>&  // node look up
-    )>;
+    void build_quadtree();
+    void build_quad(uint32_t begin, uint32_t end, std::array<float,2> lo, float size, std::size_t depth);
+    [[nodiscard]] std::array<float,2> grid_repulsion(node_id_t id, float c2) const;
+    [[nodiscard]] std::array<float,2> quadtree_repulsion(node_id_t id, float c2) const;
+    [[nodiscard]] static float local_push(float dist);
+    static void accumulate_push(const float *xs, const float *ys, std::size_t cnt, float px, float py, float c2,
+                                std::array<float,2> &force);
+
+    using draw_func_t = std::function<void(const fbgd&)>;
 
      draw_func_t draw_func = nullptr;
 
 public:
-    node_id_t add_node(std::any payload = nullptr);
-    node_id_t add_node(const std::array<float,2> &pos, bool fixed = true, std::any payload = nullptr);
+    node_id_t add_node(payload_t payload = no_payload);
+    node_id_t add_node(const std::array<float,2> &pos, bool fixed = true, payload_t payload = no_payload);
     void add_edge(node_id_t node_a, node_id_t node_b);
 
     void update();
 
+    void set_repulsion(repulsion_t mode, float _theta = 0.7f);
+    [[nodiscard]] repulsion_t get_repulsion() const { return repulsion; }
+    [[nodiscard]] float get_theta() const { return theta; }
+
     void set_draw_func(draw_func_t df);
 
     void draw() const;
@@ -98,7 +153,11 @@ public:
     static float get_region_size() { return region_size; }
     static float get_local_size() { return local_size; }
 
-    const std::array<float,2>& get_node_pos(node_id_t node_id);
+    [[nodiscard]] std::size_t get_node_cnt() const { return pos_x.size(); }
+    [[nodiscard]] std::array<float,2> get_node_pos(node_id_t node_id) const { return {pos_x[node_id], pos_y[node_id]}; }
+    [[nodiscard]] payload_t get_node_payload(node_id_t node_id) const { return payloads[node_id]; }
+    [[nodiscard]] bool is_fixed(node_id_t node_id) const { return fixed[node_id] != 0; }
+    [[nodiscard]] const std::vector<edge>& get_edges() const { return edges; }
 };
 
 }
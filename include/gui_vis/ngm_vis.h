@@ -53,11 +53,7 @@ public:
 
     void free_resources();
 
-    void paint(
-        const std::vector<fbgd::node>& vis_nodes,
-        const std::vector<fbgd::edge>& vis_edges,
-        const std::vector<uint32_t>&   vis_node_lu
-    );
+    void paint(const fbgd &vis);
 
 };
 
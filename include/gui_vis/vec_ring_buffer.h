@@ -22,10 +22,15 @@ class vec_ring_buffer {
 
     uint16_t ring_pos;
 
+    void write_column(std::span<const float> data, bool auto_norm, float min_val, float max_val);
+
 public:
     vec_ring_buffer(uint16_t _vec_size, uint16_t _ring_size);
 
     void update(const std::span<float> &data, bool auto_norm = true, float min_val = 0.0f, float max_val = 1.0f);
+
+    // writes vec_cnt consecutive vectors (oldest first) and uploads the texture only once
+    void update_batch(std::span<const float> data, std::size_t vec_cnt, bool auto_norm = true, float min_val = 0.0f, float max_val = 1.0f);
     void paint(Vector2 pos, float rot = 0.0f, float scale = 1.0f);
 
     void free_resources();
@@ -17,7 +17,8 @@ inline neuron_group_t::params_t basic_cng(
     std::size_t  neuron_cnt,
     std::size_t  input_size,
     const std::set<partial_id_t>& input_ids,
-    int          rnd_seed = 0
+    int          rnd_seed = 0,
+    std::size_t  dendrite_cnt = 3
 ){
     constexpr float learning_multiplier = 1.0f;
 
@@ -36,7 +37,7 @@ inline neuron_group_t::params_t basic_cng(
                 {0.6, 0.66}
             );
         np.default_branch_interval = 5000;
-        np.dendrite_params.resize(3); // 5
+        np.dendrite_params.resize(dendrite_cnt); // 5
         np.random_seed = rnd_seed++;
         for (auto &dp : np.dendrite_params) {
             dp.permanence_threshold            = 0.3f;
@@ -10,10 +10,13 @@
 #include <unordered_map>
 #include <random>
 #include <tuple>
+#include <utility>
 #include <functional>
 #include <set>
+#include <span>
 
 #include "io_buffer.h"
+#include "sim_alloc.h"
 
 
 namespace ngm2 {
@@ -58,15 +61,20 @@ public:
 
     using seg_id_t = uint16_t;
 
+    // the segments of a tree with max_branch_level L have the indices 1 .. 2^(L+1)-1, which (including the loops
+    // over them) have to fit into seg_id_t
+    static constexpr int max_supported_branch_level = 14;
+
     // main data structure to model the synapses on the dendritic branch.
     // the data structure is layout as "struct of arrays" (SOA) to allow for optimal
-    // cache friendliness and facilitate SIMD optimization by the compiler
+    // cache friendliness and facilitate SIMD optimization by the compiler. the arrays are allocated with the project
+    // allocator (see sim_alloc.h), i.e., cache line aligned and huge page backed if enabled
     struct synapses_t {
-        std::vector<float>    permanence;
-        std::vector<float>    mismatch;
-        std::vector<float>    adapt_history;
-        std::vector<seg_id_t> segment_idx;
-        std::vector<uint8_t>  input_inc;
+        sim::aligned_vector<float>    permanence;
+        sim::aligned_vector<float>    mismatch;
+        sim::aligned_vector<float>    adapt_history;
+        sim::aligned_vector<seg_id_t> segment_idx;
+        sim::aligned_vector<uint8_t>  input_inc;
 
         // helper functions to manage SOA layout
         void reserve(std::size_t size);
@@ -85,9 +93,9 @@ private:
     const seg_id_t    max_segment_idx;
 
     // state
-    synapses_t         synapses;
-    std::vector<float> segment_activity;
-    std::vector<float> segment_weights;
+    synapses_t                 synapses;
+    sim::aligned_vector<float> segment_activity;
+    sim::aligned_vector<float> segment_weights;
     float              primary_learning_rate;
     float              secondary_learning_rate;
     float              mismatch_smoothing;
@@ -97,16 +105,63 @@ private:
     float              mismatch_act_thres;
     float              last_max_inp;
 
+    // change tracking for delta checkpoints, the version is increased whenever a synapse value actually changed
+    uint64_t           synapse_version;
+    uint64_t           saved_synapse_version;
+
     // helper structures
     std::unordered_map<
         partial_id_t,
         std::function<sim::io_buffer::inp_buf_t()>
     > input_mem;
 
+    /*
+     * sparse inputs (see get_sparse_segment_activity): the response is computed from the sparse views of the inputs if
+     * all partial inputs provide them (opt-in, see neuron_group_t::params_t::sparse_inputs). input_syn_offsets maps
+     * each input position (partial inputs concatenated in the order of input_mem) to its first synapse. For each
+     * segment, segment_penalty lists the input positions of its connected synapses along with the cumulative penalty of
+     * all its connected synapses up to that position, connected_before holds the number of connected synapses before
+     * each input position. All are rebuilt if the synapse structure changed, the penalties are kept up to date during
+     * the (dense) adaptation.
+     */
+    std::unordered_map<
+        partial_id_t,
+        std::function<sim::io_buffer::sparse_inp_t()>
+    > sparse_input_mem;
+    std::vector<uint32_t> input_syn_offsets;
+    std::vector<std::vector<std::pair<uint32_t, float>>> segment_penalty;
+    std::vector<uint32_t> connected_before;
+    bool                  sparse_cache_valid;
+
     std::mt19937 rgen;
 
     // helper functions
     static constexpr seg_id_t calc_max_segment_idx(seg_id_t max_branch_level);
+    [[nodiscard]] float perm_strength(float permanence) const
+    {
+        return (permanence - params.permanence_threshold) / (1.0f - params.permanence_threshold);
+    }
+    void  rebuild_sparse_cache();
+    void  reset_penalties();
+    void  add_penalty(std::size_t pos, std::size_t syn_idx);
+    void  finish_penalties();
+    float get_sparse_segment_activity();
+
+    // dense sweeps through the synapses of a single partial input in its native element type (see io_elem.h),
+    // starting at synapse syn_idx, returning the first synapse of the next partial input. The adaptation sets modified
+    // if any synapse value actually changed.
+    template<class E>
+    std::size_t accumulate_partial(std::span<const E> inp, const sim::io_buffer::stats &inp_stats, std::size_t syn_idx);
+    template<class E>
+    std::size_t adapt_partial(
+        std::span<const E>           inp,
+        const sim::io_buffer::stats &inp_stats,
+        std::size_t                  syn_idx,
+        std::size_t                  pos_base,
+        float                        max_activity,
+        bool                         track_penalty,
+        bool                        &modified
+    );
 public:
     explicit dendrite_t(params_t _params);
 
@@ -115,6 +170,7 @@ public:
 
     // the core processing functions
     void set_inp_func(partial_id_t id, std::function<sim::io_buffer::inp_buf_t()> inp_func);
+    void set_sparse_inp_func(partial_id_t id, std::function<sim::io_buffer::sparse_inp_t()> inp_func);
     float get_response();
     void  adapt_synapses(float max_activity, float weight);
     void  adapt_branches();
@@ -142,7 +198,14 @@ public:
     [[nodiscard]] std::size_t          get_synapse_count()              const;
     [[nodiscard]] const synapses_t&    get_synapses()                   const;
     [[nodiscard]] seg_id_t             get_max_segment_idx()            const;
+    [[nodiscard]] std::span<const float> get_segment_activity()         const;
     [[nodiscard]] std::size_t          get_input_size()                 const;
+    [[nodiscard]] uint64_t             get_synapse_version()            const { return synapse_version; }
+
+    // checkpoint support (see checkpoint.h)
+    void save_state(sim::checkpoint_writer &cw) const;
+    bool load_state(sim::checkpoint_reader &cr);
+    void mark_checkpointed() { saved_synapse_version = synapse_version; }
 
 };
 
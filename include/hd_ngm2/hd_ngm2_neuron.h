@@ -13,6 +13,7 @@
 #include "hd_ngm2_dendrite.h"
 #include "hd_ngm2_tools.h"
 #include "io_buffer.h"
+#include "sim_timing.h"
 
 namespace ngm2 {
 
@@ -59,8 +60,9 @@ public:
 
     // core processing functions
     void set_inp_func(partial_id_t id, const std::function<sim::io_buffer::inp_buf_t()> &inp_func);
+    void set_sparse_inp_func(partial_id_t id, const std::function<sim::io_buffer::sparse_inp_t()> &inp_func);
     float get_response();
-    void  adapt(float weight);
+    void  adapt(float weight, sim::latency_histogram *branch_timing = nullptr);
 
     // runtime parameterization
     void set_branch_interval(std::size_t interval)                     { branch_interval          = interval; }
@@ -75,6 +77,11 @@ public:
     [[nodiscard]] std::size_t          get_dendrite_count() const;
     [[nodiscard]] std::size_t          get_synapse_count() const;
 
+    // checkpoint support (see checkpoint.h)
+    void save_state(sim::checkpoint_writer &cw) const;
+    bool load_state(sim::checkpoint_reader &cr);
+    void mark_checkpointed();
+
 };
 
 }
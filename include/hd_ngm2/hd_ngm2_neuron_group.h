@@ -6,6 +6,7 @@
 #define HD_NGM2_NEURON_GROUP_H
 
 #include <vector>
+#include <map>
 #include <functional>
 #include <span>
 #include <random>
@@ -32,6 +33,17 @@ public:
         sigmoid_shape_t                 default_weight_filter;
         float                           default_stochastic_win_thres;
         int                             random_seed;
+        // optional per input delay in steps (see sim::io_buffer), inputs not listed are not delayed
+        std::map<partial_id_t,std::size_t> input_delays;
+        // if > 0, only the k most active neurons publish their activity (all others output 0), which allows
+        // downstream groups to consume the output as a sparse list (see sim::io_buffer::sparse_inp_t)
+        std::size_t                     k_winners = 0;
+        // opt-in: compute the responses from the sparse views of the inputs if all inputs provide them (e.g., k-winners
+        // groups or synthetic inputs). Much faster for very sparse inputs and equal to the dense response up to rounding
+        // (see dendrite_t::get_sparse_segment_activity), which may still change learning results over long runs.
+        bool                            sparse_inputs = false;
+        // storage type of the output buffer, the activities are in [0..1] and may be quantized (see sim::io_elem_t)
+        sim::io_elem_t                  outp_elem = sim::io_elem_t::f32;
     };
 
 private:
@@ -51,7 +63,30 @@ private:
 
     std::mt19937 rgen;
 
+    // frozen groups only compute their responses and do not adapt (see sim::env::freeze)
+    bool frozen {false};
+
+    // timings of the processing phases (only recorded if COAST_ENABLE_TIMING is defined)
+    enum phase_t : std::size_t {
+        phase_response,
+        phase_local_inhibition,
+        phase_winner_adapt,
+        phase_secondary_adapt,
+        phase_branch_check
+    };
+    sim::timing_set phase_timings {"response", "local_inhibition", "winner_adapt", "secondary_adapt", "branch_check"};
+
+    // branch checks happen within the adaptation of the neurons and are timed separately
+    sim::latency_histogram* branch_timing() { return sim::timing_enabled ? &phase_timings[phase_branch_check] : nullptr; }
+
+    // processing steps shared by process() and process_all()
+    float inhibit_and_adapt_winner(std::span<float> out);
+    void  sparsify_output(std::span<float> out) const;
+    [[nodiscard]] float secondary_weight(std::span<const float> out, std::size_t idx, float act_sum) const;
+
 public:
+    static constexpr std::string_view checkpoint_tag = "neuron_group";
+
     // main constructor the sets up the neuron group
     explicit neuron_group_t(params_t  _params);
 
@@ -61,24 +96,41 @@ public:
     // core functionality / io_entity interface
     void set_outp_func(std::function<std::span<float>()> outp_func) override;
     void set_inp_func(partial_id_t id, const std::function<sim::io_buffer::inp_buf_t()> &inp_func) override;
+    void set_sparse_inp_func(partial_id_t id, const std::function<sim::io_buffer::sparse_inp_t()> &inp_func) override;
 
     // main function that models one processing step of the neuron group
     void process() override;
 
+    // processes all neuron groups of a simulation as one batch (see sim::process_batch in sim_env.h), the response and
+    // secondary adaptation phases are not timed per group in that case
+    static void process_all(std::span<neuron_group_t> groups);
+
     [[nodiscard]] std::size_t get_outp_id() const override;
     [[nodiscard]] std::size_t get_outp_size() const override;
     [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override;
+    [[nodiscard]] std::size_t get_inp_delay(std::size_t id) const override;
+    [[nodiscard]] std::size_t get_outp_sparsity() const override { return params.k_winners; }
+    [[nodiscard]] sim::io_elem_t get_outp_elem_type() const override { return params.outp_elem; }
 
     [[nodiscard]] std::string status_str() const override;
 
+    [[nodiscard]] const sim::timing_set* get_phase_timings() const override { return &phase_timings; }
+    void reset_phase_timings() override { phase_timings.reset(); }
+
+    void save_state(sim::checkpoint_writer &cw) const override;
+    bool load_state(sim::checkpoint_reader &cr) override;
+    void mark_checkpointed() override;
+
     // runtime parameterization
     void set_local_inhibition_strength(const float strength) { local_inhibition_strength = strength; }
     void set_common_learning_rate(const float rate)          { common_learning_rate      = rate;     }
     void set_weight_filter(const sigmoid_shape_t filter)     { weight_filter             = filter;   }
+    void set_frozen(const bool freeze) override               { frozen                    = freeze;   }
 
     [[nodiscard]] float& get_local_inhibition_strength() { return local_inhibition_strength; } // converted to return reference to enable use with dear imgui
     [[nodiscard]] float get_common_learning_rate()      const { return common_learning_rate;      }
     [[nodiscard]] sigmoid_shape_t get_weight_filter()   const { return weight_filter;             }
+    [[nodiscard]] bool is_frozen()                      const { return frozen;                    }
 
     // introspection support - used by the visualizations
     [[nodiscard]] const neuron_t&      get_neuron(std::size_t idx)    const;
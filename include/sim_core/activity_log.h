@@ -0,0 +1,200 @@
+#ifndef SIM_ACTIVITY_LOG_H
+#define SIM_ACTIVITY_LOG_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "io_elem.h"
+
+namespace sim {
+
+/*
+ * Append-only log of io buffer streams for the offline analysis of long runs (written by the recorder entity). The
+ * file starts with a header and the descriptions of the recorded streams, followed by one frame per recorded step.
+ * A frame holds one block per stream, the payload of every block is 8 byte aligned, i.e., uncompressed blocks can be
+ * viewed in place in the memory mapped file.
+ *
+ *     header | stream 0 .. stream n-1 | frame header | block header | payload | block header | payload | frame header ...
+ *
+ * The streams are stored in their recorded element type (see io_elem.h). Compressed blocks are encoded as runs of zero
+ * bytes and literal bytes (zero_run, literal_cnt as LEB128, then the literal bytes), either of the stored bytes
+ * (rle) or of the xor with the stored bytes of the previous frame (delta_rle). Sparse activity and inputs that do not
+ * change between steps therefore shrink to a few bytes per step. Every keyframe_interval-th frame does not depend on
+ * its predecessor, hence readers only have to decode from the last keyframe when seeking. A block is only stored
+ * compressed if that is smaller. A log that was not closed properly (e.g., after a crash) ends at the last complete
+ * frame.
+ */
+struct activity_log_header_t {
+    static constexpr std::array<char,8> magic_value { 'C','O','A','S','T','L','O','G' };
+    static constexpr uint32_t           version_value = 1;
+
+    std::array<char,8> magic;
+    uint32_t           version;
+    uint32_t           stream_cnt;
+    uint32_t           keyframe_interval;
+    uint32_t           reserved;
+};
+
+struct activity_log_stream_t {
+    uint64_t  id;
+    uint64_t  size;
+    io_elem_t elem;
+    uint8_t   reserved[7];
+};
+
+struct activity_log_frame_t {
+    static constexpr uint32_t magic_value = 0x4d415246; // "FRAM"
+
+    uint32_t magic;
+    uint32_t bytes;   // blocks of the frame, without this header
+    uint64_t step;
+};
+
+enum class log_codec_t : uint8_t {
+    raw,
+    rle,
+    delta_rle
+};
+
+struct activity_log_block_t {
+    uint32_t    bytes;   // payload without padding
+    log_codec_t codec;
+    uint8_t     reserved[3];
+};
+
+/*
+ * zero-run encoding of src (xor prev if prev is not empty) appended to dst, returns the encoded size
+ */
+std::size_t rle_encode(std::span<const std::byte> src, std::span<const std::byte> prev, std::vector<std::byte> &dst);
+
+/*
+ * decodes an rle block into dst (xor prev if prev is not empty, prev may alias dst), false if the block is corrupt
+ */
+bool rle_decode(std::span<const std::byte> src, std::span<const std::byte> prev, std::span<std::byte> dst);
+
+/*
+ * Appends frames to a memory mapped log file. The file grows in steps of the mapping size (doubled on every growth)
+ * and is truncated to the written size by close(). Not thread-safe, meant to be owned by one writer thread.
+ */
+class activity_log_writer {
+
+public:
+    struct stream_t {
+        std::size_t id;
+        std::size_t size;
+        io_elem_t   elem;  // recorded element type, inputs of other types are converted
+    };
+
+    struct params_t {
+        bool        compress          = true;
+        std::size_t keyframe_interval = 256;
+        std::size_t initial_size      = std::size_t{64} << 20;
+    };
+
+private:
+    struct stream_state_t {
+        stream_t               desc;
+        std::vector<std::byte> prev;     // stored bytes of the previous frame
+        std::vector<std::byte> cur;      // stored bytes of the current frame
+    };
+
+    int                         fd {-1};
+    std::byte                  *mapping {nullptr};
+    std::size_t                 map_size {0};
+    std::size_t                 offset {0};
+    params_t                    params;
+    std::vector<stream_state_t> streams;
+    std::vector<std::byte>      encoded;
+    uint64_t                    frame_cnt {0};
+    std::size_t                 raw_bytes {0};
+
+    bool reserve(std::size_t bytes);
+    void write_raw(const void *src, std::size_t bytes);
+    void pad();
+
+public:
+    activity_log_writer() = default;
+    ~activity_log_writer() { close(); }
+
+    activity_log_writer(const activity_log_writer&)            = delete;
+    activity_log_writer& operator=(const activity_log_writer&) = delete;
+
+    // creates (truncates) the file and writes the header
+    bool open(const std::string &file_name, std::span<const stream_t> stream_descs, const params_t &_params);
+
+    // appends one frame, the views have to be in the order of the streams (in any element type)
+    bool append(uint64_t step, std::span<const io_span_t> views);
+
+    void close();
+
+    [[nodiscard]] bool        is_open()       const { return fd >= 0;   }
+    [[nodiscard]] uint64_t    get_frame_cnt() const { return frame_cnt; }
+    [[nodiscard]] std::size_t get_size()      const { return offset;    }
+
+    // size of all frames without compression
+    [[nodiscard]] std::size_t get_raw_size()  const { return raw_bytes; }
+};
+
+/*
+ * Reads a log file through a read-only memory mapping. Uncompressed blocks are viewed in place (zero-copy), compressed
+ * blocks are decoded into per-stream buffers. Frames are read in order (next) or by index (seek, decodes from the last
+ * keyframe).
+ */
+class activity_log_reader {
+
+    struct stream_state_t {
+        activity_log_stream_t     desc;
+        std::vector<std::byte>    buf[2];
+        std::span<const std::byte> data;   // current frame, points into the mapping or into buf
+        uint8_t                   cur_buf {0};
+    };
+
+    const std::byte            *mapping {nullptr};
+    std::size_t                 map_size {0};
+    activity_log_header_t       header {};
+    std::vector<stream_state_t> streams;
+    std::vector<std::size_t>    frame_offsets;
+    std::size_t                 cur_frame {~std::size_t{0}};
+    uint64_t                    cur_step {0};
+
+    bool decode_frame(std::size_t frame);
+
+public:
+    activity_log_reader() = default;
+    explicit activity_log_reader(const std::string &file_name) { open(file_name); }
+    ~activity_log_reader() { close(); }
+
+    activity_log_reader(const activity_log_reader&)            = delete;
+    activity_log_reader& operator=(const activity_log_reader&) = delete;
+
+    bool open(const std::string &file_name);
+    void close();
+
+    [[nodiscard]] bool        is_open()          const { return mapping != nullptr; }
+    [[nodiscard]] std::size_t get_frame_cnt()    const { return frame_offsets.size(); }
+    [[nodiscard]] std::size_t get_stream_cnt()   const { return streams.size(); }
+    [[nodiscard]] const activity_log_stream_t& get_stream(std::size_t idx) const { return streams[idx].desc; }
+
+    // index of the stream with the given entity id, get_stream_cnt() if there is none
+    [[nodiscard]] std::size_t find_stream(std::size_t id) const;
+
+    // decodes the frame after the current one (the first frame after open), false at the end of the log
+    bool next();
+
+    // decodes the given frame
+    bool seek(std::size_t frame);
+
+    [[nodiscard]] std::size_t get_cur_frame() const { return cur_frame; }
+    [[nodiscard]] uint64_t    get_cur_step()  const { return cur_step;  }
+
+    // view of a stream in the current frame, valid until the next call of next / seek
+    [[nodiscard]] io_span_t view(std::size_t stream) const;
+};
+
+} // sim
+
+#endif //SIM_ACTIVITY_LOG_H
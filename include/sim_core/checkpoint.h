@@ -0,0 +1,229 @@
+#ifndef SIM_CHECKPOINT_H
+#define SIM_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace sim {
+
+/*
+ * Binary checkpoint format for the full state of a simulation environment.
+ *
+ * A checkpoint consists of a fixed header followed by a sequence of records (one per io_entity and one per
+ * io_buffer). Each record stores its payload size, such that records of unknown or mismatching entities can be
+ * skipped. Entity records are identified by the output ID and the checkpoint tag of the entity type (see
+ * io_entity.h), version 3 and older stored the compiler specific typeid name instead. Scalars are stored in native byte order, arrays are stored as element count followed by the raw array
+ * data aligned to 64 bytes within the file. Together with the memory mapped reader this allows to access all synapse
+ * arrays straight from the page cache without any parsing.
+ * Random number engines are stored as the words of their standard textual representation (converted to a binary
+ * array) to guarantee bit-identical continuation of a simulation.
+ *
+ * Besides full snapshots, delta checkpoints only contain the synapse arrays that changed since the previous checkpoint
+ * of the same chain (all other state is small and always stored). A delta names the sequence ID of the checkpoint it
+ * is based on, hence a base snapshot followed by its deltas can be replayed in order.
+ */
+struct checkpoint_header_t {
+    static constexpr char     magic_value[8] = {'C','O','A','S','T','C','K','P'};
+    static constexpr uint32_t cur_version    = 4;
+
+    enum class kind_t : uint32_t {
+        full  = 0,
+        delta = 1
+    };
+
+    char     magic[8];
+    uint32_t version;
+    kind_t   kind;
+    uint64_t entity_cnt;
+    uint64_t buffer_cnt;
+};
+
+// follows the header from version 2 onward
+struct checkpoint_chain_t {
+    uint64_t sequence;
+    uint64_t base_sequence; // 0 for full snapshots
+};
+
+// follows the chain from version 3 onward, the step count aligns the entity clocks (see env::set_clock)
+struct checkpoint_step_t {
+    uint64_t step_cnt;
+};
+
+class checkpoint_writer {
+
+    std::FILE  *file;
+    std::string file_name;
+    std::size_t offset;
+    bool        ok;
+    bool        delta;
+
+    void write_raw(const void *data, std::size_t size);
+    void pad_to(std::size_t alignment);
+
+public:
+    static constexpr std::size_t array_alignment = 64;
+
+    explicit checkpoint_writer(const std::string &_file_name, bool _delta = false);
+    ~checkpoint_writer();
+
+    // flushes all buffered data to the disk (fsync) and closes the file, false if any write or the flush failed
+    bool close();
+
+    checkpoint_writer(const checkpoint_writer&) = delete;
+    checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+
+    [[nodiscard]] bool        good()     const { return ok;     }
+    [[nodiscard]] std::size_t position() const { return offset; }
+
+    // in delta mode entities may omit state that did not change since the last checkpoint
+    [[nodiscard]] bool        is_delta() const { return delta;  }
+
+    template<class T>
+    requires std::is_trivially_copyable_v<T>
+    void write(const T &val)
+    {
+        write_raw(&val, sizeof(T));
+    }
+
+    template<class T>
+    requires std::is_trivially_copyable_v<T>
+    void write_array(std::span<const T> arr)
+    {
+        write<uint64_t>(arr.size());
+        pad_to(array_alignment);
+        write_raw(arr.data(), arr.size_bytes());
+    }
+
+    template<class T, class A>
+    void write_array(const std::vector<T,A> &vec)
+    {
+        write_array(std::span<const T>(vec));
+    }
+
+    void write_string(std::string_view str);
+
+    void write_rng(const auto &rng)
+    {
+        std::ostringstream os;
+        os << rng;
+        std::istringstream is { os.str() };
+        std::vector<uint64_t> words;
+        for (uint64_t word; is >> word;)
+            words.push_back(word);
+        write_array(words);
+    }
+
+    // records are written with a size placeholder that gets patched once the record is complete
+    std::size_t begin_record();
+    void        end_record(std::size_t record_start);
+};
+
+// moves a closed checkpoint over the target file and syncs the directory, such that the rename survives a crash. The
+// source file is removed if it could not be moved (false), a failed directory sync only produces a warning as the
+// target has already been replaced.
+bool commit_checkpoint(const std::string &tmp_file_name, const std::string &file_name);
+
+class checkpoint_reader {
+
+    const uint8_t *mapping;
+    std::size_t    map_size;
+    std::size_t    offset;
+    bool           ok;
+    bool           delta;
+    uint32_t       version;
+
+    const uint8_t *read_raw(std::size_t size);
+    void skip_to(std::size_t alignment);
+
+public:
+    explicit checkpoint_reader(const std::string &file_name);
+    ~checkpoint_reader();
+
+    checkpoint_reader(const checkpoint_reader&) = delete;
+    checkpoint_reader& operator=(const checkpoint_reader&) = delete;
+
+    [[nodiscard]] bool        good()     const { return ok;       }
+    [[nodiscard]] bool        at_end()   const { return offset >= map_size; }
+    [[nodiscard]] std::size_t position() const { return offset;   }
+    [[nodiscard]] bool        is_delta() const { return delta;    }
+
+    void set_delta(bool _delta) { delta = _delta; }
+
+    // format version of the checkpoint (see checkpoint_header_t), entities use it to read records of older versions
+    [[nodiscard]] uint32_t get_version() const { return version; }
+    void set_version(uint32_t _version) { version = _version; }
+
+    // marks the checkpoint as invalid, e.g., if an entity detects inconsistent state
+    void fail() { ok = false; }
+
+    template<class T>
+    requires std::is_trivially_copyable_v<T>
+    T read()
+    {
+        T val {};
+        if (const uint8_t *src = read_raw(sizeof(T)))
+            std::memcpy(&val, src, sizeof(T));
+        return val;
+    }
+
+    template<class T>
+    requires std::is_trivially_copyable_v<T>
+    void read_into(T &val)
+    {
+        val = read<T>();
+    }
+
+    // zero-copy view into the memory mapped checkpoint
+    template<class T>
+    requires std::is_trivially_copyable_v<T>
+    std::span<const T> read_array()
+    {
+        const auto cnt = read<uint64_t>();
+        skip_to(checkpoint_writer::array_alignment);
+        // the count is untrusted, cnt * sizeof(T) may wrap around
+        if (!ok || cnt > (map_size - offset) / sizeof(T)) {
+            ok = false;
+            return {};
+        }
+        const uint8_t *src = read_raw(cnt * sizeof(T));
+        if (src == nullptr)
+            return {};
+        return { reinterpret_cast<const T*>(src), cnt };
+    }
+
+    template<class T, class A>
+    void read_array_into(std::vector<T,A> &vec)
+    {
+        const auto arr = read_array<T>();
+        vec.assign(arr.begin(), arr.end());
+    }
+
+    std::string_view read_string();
+
+    void read_rng(auto &rng)
+    {
+        std::ostringstream os;
+        for (const uint64_t word : read_array<uint64_t>())
+            os << word << ' ';
+        std::istringstream is { os.str() };
+        is >> rng;
+        if (is.fail())
+            ok = false;
+    }
+
+    // returns the end offset of the record that starts at the current position
+    std::size_t begin_record();
+    void        skip_record(std::size_t record_end);
+    void        seek(std::size_t pos);
+};
+
+} // sim
+
+#endif //SIM_CHECKPOINT_H
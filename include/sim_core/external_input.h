@@ -0,0 +1,125 @@
+#ifndef SIM_EXTERNAL_INPUT_H
+#define SIM_EXTERNAL_INPUT_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include "io_entity.h"
+#include "spsc_queue.h"
+
+namespace sim {
+
+/*
+ * Input port for embedding the simulation into a host application. The host provides the output of this entity, either
+ *
+ *  - synchronously, if the host drives the environment itself: write_span() is the output slot of the next step, i.e.,
+ *    the host writes its data in place (zero-copy) and calls env::process and env::swap_io afterward, or
+ *  - asynchronously from one host thread while the simulation runs on its own thread: frames are written in place into
+ *    a bounded queue of pending frames (acquire + commit) or copied into it (submit). The queue applies back-pressure,
+ *    i.e., the blocking variants wait until the simulation consumed a frame. process() copies one pending frame per step
+ *    into the output slot.
+ *
+ * Steps without a new frame are handled according to the empty policy: block waits for the next frame (the simulation
+ * runs at the rate of the host, close() releases the wait), zero outputs zeros and repeat outputs the last frame again
+ * (at the cost of one additional copy per step).
+ * The host has to take the reference to the entity after all entities were added to the environment (see env::reserve).
+ */
+class external_input : public io_entity {
+
+public:
+    enum class empty_policy_t {
+        block,
+        zero,
+        repeat
+    };
+
+private:
+    std::function<std::span<float>()> output_mem {};
+    std::size_t    id;
+    std::size_t    size;
+    empty_policy_t on_empty;
+    io_elem_t      outp_elem;
+    bool           direct_written {false};
+    std::size_t    missed_cnt {0};
+    std::vector<float> last;   // last output, only maintained for the repeat policy
+
+    // shared with the host thread, on the heap to keep the entity movable
+    struct port_t {
+        spsc_queue<std::vector<float>> queue;
+        std::atomic<bool>              closed {false};
+
+        port_t(std::size_t depth, std::size_t frame_size) : queue(depth, std::vector<float>(frame_size, 0.0f)) {}
+    };
+    std::unique_ptr<port_t> port;
+
+public:
+    static constexpr std::string_view checkpoint_tag = "external_input";
+
+    external_input(
+        std::size_t    _id,
+        std::size_t    _size,
+        std::size_t    queue_depth = 4,
+        empty_policy_t _on_empty   = empty_policy_t::block,
+        io_elem_t      _outp_elem  = io_elem_t::f32
+    );
+
+    /*
+     * host side, synchronous use
+     */
+
+    // output slot of the next step, only valid until the next env::swap_io
+    [[nodiscard]] std::span<float> write_span();
+
+    /*
+     * host side, asynchronous use (a single host thread)
+     */
+
+    // pending frame to be filled in place, empty if the queue is full (or closed)
+    [[nodiscard]] std::span<float> try_acquire();
+
+    // blocks until a pending frame is free, empty if the stop was requested or the port was closed
+    [[nodiscard]] std::span<float> acquire(const std::stop_token &stoken = {});
+
+    // hands the acquired frame over to the simulation
+    void commit();
+
+    // copies a frame into the queue, false if the queue is full (or closed) or the frame size does not match
+    bool try_submit(std::span<const float> frame);
+
+    // blocking variant of try_submit
+    bool submit(std::span<const float> frame, const std::stop_token &stoken = {});
+
+    // releases all waits of the simulation and the host, pending frames are still consumed
+    void close();
+    void reopen();
+
+    [[nodiscard]] std::size_t pending() const { return port->queue.size(); }
+    [[nodiscard]] bool        closed()  const { return port->closed.load(std::memory_order_acquire); }
+
+    /*
+     * simulation side
+     */
+    void set_outp_func(std::function<std::span<float>()>) override;
+
+    void process() override;
+
+    [[nodiscard]] std::size_t get_outp_id() const override { return id; }
+    [[nodiscard]] std::size_t get_outp_size() const override { return size; }
+    [[nodiscard]] io_elem_t get_outp_elem_type() const override { return outp_elem; }
+
+    [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return {}; }
+
+    [[nodiscard]] std::string status_str() const override;
+
+    // number of steps without a new frame
+    [[nodiscard]] std::size_t get_missed_cnt() const { return missed_cnt; }
+};
+
+} // sim
+
+#endif //SIM_EXTERNAL_INPUT_H
@@ -0,0 +1,72 @@
+#ifndef SIM_IO_BATCH_H
+#define SIM_IO_BATCH_H
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "io_buffer.h"
+
+namespace sim {
+
+/*
+ * A batch of consecutive snapshots of a set of io buffers. For every buffer the snapshots are stored contiguously
+ * (oldest first), i.e., snapshot s of buffer b starts at s * buffer_sizes[b] within data[b].
+ */
+struct io_batch {
+    std::size_t                     last_step    {};
+    std::size_t                     snapshot_cnt {};
+    std::vector<std::size_t>        buffer_ids;
+    std::vector<std::size_t>        buffer_sizes;
+    std::vector<std::vector<float>> data;
+
+    [[nodiscard]] std::span<const float> snapshots(std::size_t buf_idx) const
+    {
+        return { data[buf_idx].data(), snapshot_cnt * buffer_sizes[buf_idx] };
+    }
+
+    [[nodiscard]] std::span<const float> snapshot(std::size_t buf_idx, std::size_t snap_idx) const
+    {
+        return { data[buf_idx].data() + snap_idx * buffer_sizes[buf_idx], buffer_sizes[buf_idx] };
+    }
+};
+
+/*
+ * Records snapshots of the read slots of a set of io buffers after every swap and hands them over to an observer
+ * function in batches. In "on_full" mode every snapshot is delivered (whenever the batch is full or on flush), in
+ * "latest" mode the recorder keeps a ring of the most recent snapshots that is only delivered on flush, e.g., once per
+ * gui frame, dropping older snapshots that would not be visible anyway.
+ */
+class io_batch_recorder {
+
+public:
+    enum class mode_t {
+        on_full,
+        latest
+    };
+
+private:
+    mode_t                                   mode;
+    std::size_t                              capacity;
+    std::size_t                              write_pos;
+    std::vector<io_buffer*>                  buffers;
+    io_batch                                 batch;
+    std::function<void(const io_batch&)>     func;
+
+public:
+    io_batch_recorder(
+        std::vector<std::size_t>             buffer_ids,
+        std::vector<io_buffer*>              _buffers,
+        std::size_t                          _capacity,
+        mode_t                               _mode,
+        std::function<void(const io_batch&)> _func
+    );
+
+    void record(std::size_t step);
+    void flush();
+};
+
+} // sim
+
+#endif //SIM_IO_BATCH_H
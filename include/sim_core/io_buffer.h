@@ -5,14 +5,29 @@
 #ifndef IO_BUFFER_H
 #define IO_BUFFER_H
 
-#include <array>
 #include <vector>
 #include <cstdint>
 #include <functional>
 #include <span>
+#include <variant>
+
+#include "checkpoint.h"
+#include "io_elem.h"
+#include "sim_alloc.h"
 
 namespace sim {
 
+/*
+ * Ring of output slots of an io_entity. The producer writes into one slot per step, consumers read the slot written in
+ * the previous step or, if they subscribe with a delay of k, the slot written k steps before that. Consumers get a
+ * span into the ring, i.e., delayed inputs do not require any copies. The statistics of a slot are computed once when
+ * it becomes readable and are shared by all consumers. The default of two slots is a plain double buffer.
+ * For sparse outputs (e.g., k-winners neuron groups) consumers may additionally subscribe to a sparse view of the
+ * slots, i.e., the (index, value) list of all non-zero elements, which is gathered once per slot on swap.
+ * The slots may be stored with reduced precision (see io_elem.h). In this case the producer writes into a float staging
+ * slot that is encoded on swap, consumers read the slots in their native element type. The statistics and the sparse
+ * views are computed from the decoded values, i.e., they describe exactly what the consumers see.
+ */
 class io_buffer {
 
 public:
@@ -25,50 +40,83 @@ public:
         float nse;
     };
 
+    struct sparse_inp_t {
+        std::span<const uint32_t> idx;
+        std::span<const float>    val;
+        std::size_t               size;     // size of the dense input
+        stats                     inp_stats;
+    };
+
 private:
 
-    std::array<std::vector<float>,2> buffer;
-    stats read_buffer_stats;
+    template<class E>
+    using slots_t = std::vector<aligned_vector<E>>;
+
+    // slots in their native element type (alternatives in the order of io_elem_t)
+    std::variant<slots_t<float>, slots_t<half_t>, slots_t<uint8_t>> buffer;
+    std::size_t        elem_cnt;
+    std::size_t        slot_count;
+    aligned_vector<float> staging; // write slot of reduced precision buffers, empty for f32
+    std::vector<stats> slot_stats;
     uint8_t write_idx;
     uint8_t read_idx;
 
-    void update_stats();
+    // sparse views of the slots (only maintained if a consumer subscribed to them)
+    bool                               sparse;
+    std::vector<std::vector<uint32_t>> sparse_idx;
+    std::vector<std::vector<float>>    sparse_val;
 
-public:
+    static stats compute_stats(std::span<const float> buf);
+    void gather_sparse(std::size_t slot, std::span<const float> values);
 
-    explicit io_buffer(std::size_t size);
+    // decoded copy of a slot (only needed outside of the regular swap, e.g., when loading checkpoints)
+    [[nodiscard]] std::vector<float> decoded_slot(std::size_t slot) const;
+    [[nodiscard]] io_span_t slot_view(std::size_t slot) const;
 
-    void swap_buffer()
+    [[nodiscard]] std::size_t delayed_idx(std::size_t delay) const
     {
-        read_idx  =  write_idx;
-        write_idx = (write_idx + 1) & 1;
-        update_stats();
+        return (read_idx + slot_count - delay) % slot_count;
     }
 
+public:
+    // the slot count is stored as uint8_t index, hence delays are limited accordingly
+    static constexpr std::size_t max_slot_cnt = 255;
+
+    // slot_cnt has to be at least max_delay + 2 of all consumers (write slot + read slot + delayed slots)
+    explicit io_buffer(std::size_t size, std::size_t slot_cnt = 2, io_elem_t elem = io_elem_t::f32);
+
+    void swap_buffer();
+
     std::function<std::span<float>()> outp_buffer_func()
     {
         return [this]() -> std::span<float> {
-            return { buffer[write_idx].begin(), buffer[write_idx].end() };
+            return cur_write_buffer();
         };
     }
 
-    using inp_buf_t = std::tuple<std::span<const float>,sim::io_buffer::stats>;
+    using inp_buf_t = std::tuple<io_span_t,sim::io_buffer::stats>;
 
-    std::function<inp_buf_t()> inp_buffer_func()
-    {
-        return [this]() -> inp_buf_t {
-            return {
-                std::span<const float> { buffer[read_idx].begin(), buffer[read_idx].end() },
-                read_buffer_stats
-            };
-        };
-    }
+    // delay 0 provides the output of the previous step, delay k the output of k steps before that
+    std::function<inp_buf_t()> inp_buffer_func(std::size_t delay = 0);
 
-    [[nodiscard]] std::size_t size() const { return buffer[0].size(); }
+    // sparse view of the same slot as inp_buffer_func(delay), enables the gathering of the sparse views
+    std::function<sparse_inp_t()> sparse_inp_func(std::size_t delay = 0);
 
+    [[nodiscard]] std::size_t size()      const { return elem_cnt;       }
+    [[nodiscard]] std::size_t slot_cnt()  const { return slot_count;     }
+    [[nodiscard]] std::size_t max_delay() const { return slot_count - 2; }
+    [[nodiscard]] io_elem_t   elem_type() const { return static_cast<io_elem_t>(buffer.index()); }
+
+    // the write buffer is always float (the staging slot for reduced precision buffers)
     [[nodiscard]] std::span<float> cur_write_buffer();
 
-    [[nodiscard]] std::span<const float> cur_read_buffer();
+    [[nodiscard]] io_span_t cur_read_buffer() const;
+
+    [[nodiscard]] io_span_t delayed_read_buffer(std::size_t delay) const;
+
+    // checkpoint support
+    void save_state(checkpoint_writer &cw) const;
+    bool load_state(checkpoint_reader &cr);
 
 };
 
@@ -0,0 +1,124 @@
+#ifndef SIM_IO_ELEM_H
+#define SIM_IO_ELEM_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <variant>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace sim {
+
+/*
+ * Element types of io buffer slots. Activities and pixel intensities are in [0..1], hence the reduced precision types
+ * trade a small quantization error for 2x (f16) or 4x (u8) less buffer bandwidth. u8 maps [0..1] linearly onto
+ * [0..255], f16 is an IEEE 754 binary16 value (stored as raw bits, see half_t) that is converted with the F16C
+ * instructions if available (e.g., with -march=native).
+ */
+enum class io_elem_t : uint8_t {
+    f32,
+    f16,
+    u8
+};
+
+struct half_t {
+    uint16_t bits;
+};
+
+// bytes per element
+[[nodiscard]] constexpr std::size_t io_elem_size(const io_elem_t elem)
+{
+    switch (elem) {
+        case io_elem_t::f16: return sizeof(half_t);
+        case io_elem_t::u8:  return sizeof(uint8_t);
+        default:             return sizeof(float);
+    }
+}
+
+// round to nearest even, overflows to infinity
+[[nodiscard]] inline half_t to_half(const float val)
+{
+#if defined(__F16C__)
+    return { static_cast<uint16_t>(_cvtss_sh(val, _MM_FROUND_TO_NEAREST_INT)) };
+#else
+    const uint32_t f    = std::bit_cast<uint32_t>(val);
+    const uint32_t sign = (f >> 16) & 0x8000u;
+    const uint32_t abs  = f & 0x7fffffffu;
+    if (abs >= 0x7f800000u) // inf and nan
+        return { static_cast<uint16_t>(sign | 0x7c00u | (abs > 0x7f800000u ? 0x200u : 0u)) };
+    if (abs >= 0x477ff000u) // rounds to inf
+        return { static_cast<uint16_t>(sign | 0x7c00u) };
+    if (abs < 0x38800000u) { // subnormal, the addition rounds the mantissa to multiples of 2^-24
+        const float sub = std::bit_cast<float>(abs) + 0.5f;
+        return { static_cast<uint16_t>(sign | (std::bit_cast<uint32_t>(sub) - 0x3f000000u)) };
+    }
+    // rebias the exponent (127 -> 15) and round the mantissa to 10 bits
+    return { static_cast<uint16_t>(sign | ((abs + 0xc8000fffu + ((abs >> 13) & 1u)) >> 13)) };
+#endif
+}
+
+[[nodiscard]] constexpr float to_float(const float val) { return val; }
+
+[[nodiscard]] constexpr float to_float(const uint8_t val) { return static_cast<float>(val) * (1.0f / 255.0f); }
+
+[[nodiscard]] inline float to_float(const half_t val)
+{
+#if defined(__F16C__)
+    return _cvtsh_ss(val.bits);
+#else
+    const uint32_t sign = static_cast<uint32_t>(val.bits & 0x8000u) << 16;
+    const uint32_t exp  = (val.bits >> 10) & 0x1fu;
+    const uint32_t mant = val.bits & 0x3ffu;
+    if (exp == 0) {
+        const float sub = static_cast<float>(mant) * 0x1p-24f;
+        return sign ? -sub : sub;
+    }
+    if (exp == 0x1f)
+        return std::bit_cast<float>(sign | 0x7f800000u | (mant << 13));
+    return std::bit_cast<float>(sign | ((exp + 112u) << 23) | (mant << 13));
+#endif
+}
+
+template<class E>
+[[nodiscard]] E from_float(float val);
+
+template<>
+[[nodiscard]] constexpr float from_float<float>(const float val) { return val; }
+
+template<>
+[[nodiscard]] inline half_t from_float<half_t>(const float val) { return to_half(val); }
+
+template<>
+[[nodiscard]] constexpr uint8_t from_float<uint8_t>(const float val)
+{
+    return static_cast<uint8_t>(std::clamp(val, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+/*
+ * read-only view of a buffer slot in its native element type (alternatives in the order of io_elem_t)
+ */
+using io_span_t = std::variant<std::span<const float>, std::span<const half_t>, std::span<const uint8_t>>;
+
+[[nodiscard]] inline std::size_t io_span_size(const io_span_t &view)
+{
+    return std::visit([](const auto &sp) { return sp.size(); }, view);
+}
+
+// decodes a view into floats, dst has to provide at least io_span_size(src) elements
+inline void decode_into(const io_span_t &src, std::span<float> dst)
+{
+    std::visit(
+        [&](const auto &sp) {
+            std::ranges::transform(sp, dst.begin(), [](const auto val) { return to_float(val); });
+        },
+        src
+    );
+}
+
+} // sim
+
+#endif //SIM_IO_ELEM_H
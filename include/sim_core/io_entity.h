@@ -5,10 +5,14 @@
 #ifndef SIM_IO_ENTITY_H
 #define SIM_IO_ENTITY_H
 
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <span>
 #include <string>
 #include "io_buffer.h"
+#include "checkpoint.h"
+#include "sim_timing.h"
 
 namespace sim {
 
@@ -19,13 +23,43 @@ struct io_entity {
     virtual void set_outp_func(std::function<std::span<float>()>) {}
     virtual void set_inp_func(std::size_t, const std::function<io_buffer::inp_buf_t()>&) {}
 
+    // entities that consume sparse views of their inputs (only handed over for inputs with sparse outputs)
+    virtual void set_sparse_inp_func(std::size_t, const std::function<io_buffer::sparse_inp_t()>&) {}
+
     virtual void process() = 0;
 
     [[nodiscard]] virtual std::size_t get_outp_id() const = 0;
     [[nodiscard]] virtual std::size_t get_outp_size() const = 0;
     [[nodiscard]] virtual std::span<const std::size_t> get_inp_ids() const = 0;
 
+    // entities with mostly zero outputs (e.g., k-winners) report the maximum number of non-zero elements, 0 if dense
+    [[nodiscard]] virtual std::size_t get_outp_sparsity() const { return 0; }
+
+    // element type of the output buffer slots (see io_elem.h), producers always write floats
+    [[nodiscard]] virtual io_elem_t get_outp_elem_type() const { return io_elem_t::f32; }
+
+    // number of additional steps an input is delayed, 0 provides the output of the previous step
+    [[nodiscard]] virtual std::size_t get_inp_delay(std::size_t) const { return 0; }
+
     [[nodiscard]] virtual std::string status_str() const { return ""; }
+
+    // layer-wise training support (see env::freeze): sources whose last output is a pure function of a sample (e.g.,
+    // data set image and noise variant) identify it by a key, learning entities stop adapting while frozen
+    [[nodiscard]] virtual std::optional<uint64_t> get_sample_key() const { return {}; }
+    virtual void set_frozen(bool) {}
+
+    // optional timings of the processing phases of an entity (see sim_timing.h)
+    [[nodiscard]] virtual const timing_set* get_phase_timings() const { return nullptr; }
+    virtual void reset_phase_timings() {}
+
+    // checkpoint support (see checkpoint.h) - stateless entities do not need to override these. Every entity type
+    // names itself in checkpoints by a static constexpr std::string_view checkpoint_tag, which unlike typeid names
+    // does not depend on the compiler or the standard library
+    virtual void save_state(checkpoint_writer&) const {}
+    virtual bool load_state(checkpoint_reader&) { return true; }
+
+    // called after a checkpoint was successfully written or loaded, i.e., the current state is the new base for deltas
+    virtual void mark_checkpointed() {}
 };
 
 
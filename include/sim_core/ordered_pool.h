@@ -0,0 +1,133 @@
+#ifndef SIM_ORDERED_POOL_H
+#define SIM_ORDERED_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace sim {
+
+/*
+ * Parallel variant of run_ahead: a pool of worker threads produces the frames of a sequence ahead of the simulation
+ * and the entity takes them strictly in sequence order (next). Every worker claims the next sequence number and fills
+ * the frame of that number into the slot seq % capacity, i.e., the frames do not depend on the scheduling of the
+ * workers as long as the producer function only depends on the sequence number (e.g., per-sequence seeds).
+ * A worker waits until the consumer released the frame that previously occupied its slot, hence at most capacity
+ * frames are ahead and the last taken frame stays valid until the next call of next().
+ */
+template<class Frame>
+class ordered_pool {
+
+    static constexpr std::size_t    cache_line = 64;
+    static constexpr uint64_t       no_seq     = ~uint64_t{0};
+
+    struct slot_t {
+        Frame                 frame;
+        std::atomic<uint64_t> ready {no_seq}; // sequence number of the frame in the slot
+    };
+
+    std::size_t                                     capacity;
+    std::unique_ptr<slot_t[]>                       slots;
+    std::function<void(Frame&, uint64_t)>           produce;
+    std::vector<std::jthread>                       workers;
+    std::size_t                                     worker_cnt;
+
+    alignas(cache_line) std::atomic<uint64_t>       next_seq {0};  // next sequence number to claim (workers)
+    alignas(cache_line) std::atomic<uint64_t>       released {0};  // frames released by the consumer
+    alignas(cache_line) std::atomic<uint32_t>       signal {0};    // changed on every release and stop
+    uint64_t                                        read_seq {0};
+    const Frame                                    *held {nullptr};
+
+    void notify()
+    {
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_all();
+    }
+
+    void work(const std::stop_token &stoken)
+    {
+        while (!stoken.stop_requested()) {
+            const uint64_t seq = next_seq.fetch_add(1, std::memory_order_relaxed);
+            // wait until the previous frame of the slot was released
+            while (true) {
+                const uint32_t sig = signal.load(std::memory_order_acquire);
+                if (stoken.stop_requested())
+                    return;
+                if (seq < released.load(std::memory_order_acquire) + capacity)
+                    break;
+                signal.wait(sig, std::memory_order_acquire);
+            }
+            slot_t &slot = slots[seq % capacity];
+            produce(slot.frame, seq);
+            slot.ready.store(seq, std::memory_order_release);
+            slot.ready.notify_all();
+        }
+    }
+
+public:
+    ordered_pool(std::size_t workers_cnt, std::size_t depth, const Frame &proto, std::function<void(Frame&, uint64_t)> produce_func) :
+        capacity(std::max<std::size_t>(depth, 1) + 1), // + 1 for the held frame
+        slots(std::make_unique<slot_t[]>(capacity)),
+        produce(std::move(produce_func)),
+        worker_cnt(std::max<std::size_t>(workers_cnt, 1))
+    {
+        for (std::size_t i = 0; i < capacity; ++i)
+            slots[i].frame = proto;
+    }
+
+    ordered_pool(const ordered_pool&)            = delete;
+    ordered_pool& operator=(const ordered_pool&) = delete;
+
+    ~ordered_pool() { stop(); }
+
+    // starts the workers, the first frame taken by next() has the given sequence number
+    void start(uint64_t first_seq = 0)
+    {
+        if (!workers.empty())
+            return;
+        next_seq.store(first_seq);
+        released.store(first_seq);
+        read_seq = first_seq;
+        for (std::size_t i = 0; i < worker_cnt; ++i)
+            workers.emplace_back([this](const std::stop_token &stoken) { work(stoken); });
+    }
+
+    void stop()
+    {
+        for (auto &worker : workers)
+            worker.request_stop();
+        notify();
+        workers.clear(); // joins
+        for (std::size_t i = 0; i < capacity; ++i)
+            slots[i].ready.store(no_seq);
+        held = nullptr;
+    }
+
+    [[nodiscard]] bool running() const { return !workers.empty(); }
+
+    // releases the previously taken frame and blocks until the next frame of the sequence is available
+    const Frame& next()
+    {
+        if (held != nullptr) {
+            released.fetch_add(1, std::memory_order_release);
+            notify();
+        }
+        const uint64_t seq  = read_seq++;
+        slot_t        &slot = slots[seq % capacity];
+        for (uint64_t cur = slot.ready.load(std::memory_order_acquire); cur != seq; cur = slot.ready.load(std::memory_order_acquire))
+            slot.ready.wait(cur, std::memory_order_acquire);
+        held = &slot.frame;
+        return *held;
+    }
+
+    // the frame taken by the last call of next(), nullptr if none was taken since the (re)start
+    [[nodiscard]] const Frame* last() const { return held; }
+};
+
+} // sim
+
+#endif //SIM_ORDERED_POOL_H
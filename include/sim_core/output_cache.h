@@ -0,0 +1,58 @@
+#ifndef SIM_OUTPUT_CACHE_H
+#define SIM_OUTPUT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "io_elem.h"
+
+namespace sim {
+
+/*
+ * Compact store of the outputs of one entity keyed by a 64 bit sample key (see env::freeze). Every entry occupies a
+ * fixed stride of one flat arena: dense outputs are stored in the given element type, sparse outputs (k-winners) as
+ * count + (index, value) list if that is smaller. Entries are never evicted, once max_bytes are used further outputs
+ * are not stored anymore (i.e., they are recomputed on every occurrence).
+ */
+class output_cache {
+
+public:
+    struct stats_t {
+        uint64_t    hits;
+        uint64_t    misses;
+        std::size_t entries;
+        std::size_t bytes;
+    };
+
+private:
+    std::size_t size;
+    std::size_t sparsity;     // maximum number of non-zero elements of the sparse layout, 0 for the dense layout
+    io_elem_t   elem;
+    std::size_t stride;
+    std::size_t max_entries;
+
+    std::vector<std::byte>                  arena;
+    std::unordered_map<uint64_t,uint32_t>   index;  // key -> entry
+    uint64_t                                hits   {0};
+    uint64_t                                misses {0};
+
+public:
+    output_cache(std::size_t _size, std::size_t _sparsity, io_elem_t _elem, std::size_t max_bytes);
+
+    // decodes the entry of key into outp, false (a miss) if the key is not cached
+    bool load(uint64_t key, std::span<float> outp);
+
+    // stores outp under key unless the key is already cached or the cache is full
+    void store(uint64_t key, std::span<const float> outp);
+
+    void clear();
+
+    [[nodiscard]] stats_t get_stats() const { return { hits, misses, index.size(), arena.size() }; }
+};
+
+} // sim
+
+#endif //SIM_OUTPUT_CACHE_H
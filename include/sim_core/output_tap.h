@@ -0,0 +1,112 @@
+#ifndef SIM_OUTPUT_TAP_H
+#define SIM_OUTPUT_TAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+#include "io_entity.h"
+#include "spsc_queue.h"
+
+namespace sim {
+
+/*
+ * Output port for embedding the simulation into a host application, the counterpart of external_input. The tap is a
+ * sink (it has no output buffer) that subscribes to the outputs of other entities like any consumer and hands them to
+ * the host, either
+ *
+ *  - zero-copy on the simulation thread: the callback gets the views of all inputs of the current step, or
+ *  - synchronously, if the host drives the environment itself: view() reads an input at any time between steps, or
+ *  - asynchronously: every step, the inputs are decoded (concatenated in the order of the input ids) into a bounded
+ *    queue that the host thread drains with try_pop / pop. The simulation never waits for the host, frames that do not
+ *    fit into the queue are dropped and counted.
+ *
+ * Frames carry the number of the step (processing calls of the tap, starting at 1) they were taken in. The output of
+ * an external_input frame reaches the tap after the depth of the network in steps.
+ */
+class output_tap : public io_entity {
+
+public:
+    struct frame_t {
+        std::vector<float> data;
+        uint64_t           step;
+    };
+
+    using callback_t = std::function<void(uint64_t step, std::span<const io_span_t> inputs)>;
+
+private:
+    std::size_t                                      id;
+    std::size_t                                      input_size;
+    std::vector<std::size_t>                         inp_ids;
+    std::map<std::size_t,std::size_t>                inp_delays;
+    std::vector<std::function<io_buffer::inp_buf_t()>> inp_funcs;  // in the order of inp_ids
+    std::vector<io_span_t>                           views;
+    callback_t                                       callback;
+    uint64_t                                         step_cnt {0};
+
+    // shared with the host thread, on the heap to keep the entity movable
+    struct port_t {
+        spsc_queue<frame_t>      queue;
+        std::atomic<std::size_t> dropped {0};
+        std::atomic<bool>        closed {false};
+
+        port_t(std::size_t depth, std::size_t frame_size) : queue(depth, frame_t{ std::vector<float>(frame_size), 0 }) {}
+    };
+    std::unique_ptr<port_t> port; // nullptr without queue
+
+    [[nodiscard]] std::size_t inp_idx(std::size_t inp_id) const;
+
+public:
+    static constexpr std::string_view checkpoint_tag = "output_tap";
+
+    // queue_depth 0 disables the queue (callback and view only)
+    output_tap(
+        std::size_t                       _id,
+        std::vector<std::size_t>          _inp_ids,
+        std::size_t                       _input_size,
+        std::size_t                       queue_depth = 0,
+        std::map<std::size_t,std::size_t> _inp_delays = {}
+    );
+
+    // called on the simulation thread during process(), the views are only valid during the call
+    void set_callback(callback_t func) { callback = std::move(func); }
+
+    // current view of an input, only valid until the next env::swap_io
+    [[nodiscard]] io_span_t view(std::size_t inp_id) const;
+
+    // copies the oldest queued frame into dst (of input_size elements), false if the queue is empty
+    bool try_pop(std::span<float> dst, uint64_t *step = nullptr);
+
+    // blocking variant of try_pop, false if the stop was requested or the tap was closed
+    bool pop(std::span<float> dst, const std::stop_token &stoken = {}, uint64_t *step = nullptr);
+
+    // releases a blocked pop
+    void close();
+
+    [[nodiscard]] std::size_t get_dropped_cnt() const { return port ? port->dropped.load(std::memory_order_relaxed) : 0; }
+    [[nodiscard]] std::size_t get_input_size()  const { return input_size; }
+
+    /*
+     * simulation side
+     */
+    void set_inp_func(std::size_t inp_id, const std::function<io_buffer::inp_buf_t()> &func) override;
+
+    void process() override;
+
+    [[nodiscard]] std::size_t get_outp_id() const override { return id; }
+    [[nodiscard]] std::size_t get_outp_size() const override { return 0; }
+    [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return inp_ids; }
+    [[nodiscard]] std::size_t get_inp_delay(std::size_t inp_id) const override;
+
+    [[nodiscard]] std::string status_str() const override;
+};
+
+} // sim
+
+#endif //SIM_OUTPUT_TAP_H
@@ -0,0 +1,110 @@
+#ifndef SIM_RECORDER_H
+#define SIM_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "activity_log.h"
+#include "io_entity.h"
+#include "spsc_queue.h"
+
+namespace sim {
+
+struct recorder_params_t {
+    std::optional<io_elem_t> elem;                    // recorded element type, the buffer's own type if empty
+    bool                     compress          = true;
+    std::size_t              keyframe_interval = 256;
+    std::size_t              queue_depth       = 256; // steps buffered for the writer thread
+};
+
+/*
+ * Records the outputs of other entities into an activity log (see activity_log.h) for offline analysis. The recorder
+ * is a sink like output_tap: every step, the read slots of its inputs are copied in their native element type into a
+ * lock-free queue, a background thread quantizes, compresses and appends them to the memory mapped log. The simulation
+ * only waits for the writer if the queue is full, i.e., recording does not lose frames (stalls are counted).
+ * The recorded frame of step s (processing calls of the recorder, starting at 1) holds the outputs written in step s-1.
+ * The log is started on the first process() call (when the input sizes are known) and completed by close() or the
+ * destructor.
+ */
+class recorder : public io_entity {
+
+    struct frame_t {
+        std::vector<std::byte> data;   // native bytes of all inputs one after the other
+        uint64_t               step;
+    };
+
+    // writer thread and everything it accesses, on the heap to keep the entity movable
+    struct sink_t {
+        spsc_queue<frame_t>      queue;
+        activity_log_writer      writer;
+        std::vector<io_elem_t>   elems;    // native element types of the inputs
+        std::vector<std::size_t> sizes;
+        std::vector<std::size_t> offsets;  // byte offsets of the inputs in a frame
+        std::atomic<uint64_t>    frames_written {0};
+        std::atomic<std::size_t> bytes_written {0};
+        std::atomic<std::size_t> raw_bytes {0};
+        std::jthread             thread;
+
+        sink_t(std::size_t depth, std::size_t frame_bytes) : queue(depth, frame_t{ std::vector<std::byte>(frame_bytes), 0 }) {}
+        ~sink_t() { finish(); }
+
+        void write_frames(const std::stop_token &stoken);
+
+        // writes the queued frames, stops the thread and completes the log
+        void finish();
+    };
+
+    std::size_t                                         id;
+    std::vector<std::size_t>                            inp_ids;
+    std::vector<std::function<io_buffer::inp_buf_t()>>  inp_funcs;  // in the order of inp_ids
+    std::vector<io_span_t>                              views;
+    std::string                                         file_name;
+    recorder_params_t                                   params;
+    uint64_t                                            step_cnt {0};
+    std::size_t                                         stall_cnt {0};
+    bool                                                closed {false};
+    std::unique_ptr<sink_t>                             sink;
+
+    bool start();
+
+public:
+    static constexpr std::string_view checkpoint_tag = "recorder";
+
+    recorder(
+        std::size_t              _id,
+        std::vector<std::size_t> _inp_ids,
+        std::string              _file_name,
+        recorder_params_t        _params = {}
+    );
+
+    // writes all queued frames and completes the log, later steps are not recorded
+    void close();
+
+    [[nodiscard]] uint64_t    get_frame_cnt() const { return sink ? sink->frames_written.load(std::memory_order_relaxed) : 0; }
+    [[nodiscard]] std::size_t get_stall_cnt() const { return stall_cnt; }
+
+    /*
+     * simulation side
+     */
+    void set_inp_func(std::size_t inp_id, const std::function<io_buffer::inp_buf_t()> &func) override;
+
+    void process() override;
+
+    [[nodiscard]] std::size_t get_outp_id() const override { return id; }
+    [[nodiscard]] std::size_t get_outp_size() const override { return 0; }
+    [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return inp_ids; }
+
+    [[nodiscard]] std::string status_str() const override;
+};
+
+} // sim
+
+#endif //SIM_RECORDER_H
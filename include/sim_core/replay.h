@@ -0,0 +1,63 @@
+#ifndef SIM_REPLAY_H
+#define SIM_REPLAY_H
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+#include "activity_log.h"
+#include "io_entity.h"
+
+namespace sim {
+
+/*
+ * Serves a stream of an activity log (written by a recorder) under its original output id, e.g., to train or profile
+ * upper neuron groups in isolation without running the entities below them. The log is memory mapped, uncompressed
+ * frames are decoded straight from the mapping into the output buffer, which keeps the element type of the recording.
+ * Step n of the replay (processing calls, starting at 1) outputs what the original entity wrote in its step n, i.e.,
+ * consumers see exactly the recorded input sequence (provided the recording started with the simulation). At the end
+ * of the log the replay starts over (loop) or outputs zeros. The position is part of checkpoints.
+ */
+class replay : public io_entity {
+
+    std::function<std::span<float>()>    output_mem {};
+    std::size_t                          id;
+    std::string                          file_name;
+    bool                                 loop;
+    std::unique_ptr<activity_log_reader> reader;     // on the heap to keep the entity movable
+    std::size_t                          stream_idx;
+    std::size_t                          next_frame {1}; // frame 0 holds the buffers before the first step
+    uint64_t                             pass {0};
+
+public:
+    static constexpr std::string_view checkpoint_tag = "replay";
+
+    // stream_id selects the recorded entity, the output id is used if it is not given
+    replay(std::size_t _id, std::string _file_name, bool _loop = true, std::optional<std::size_t> stream_id = {});
+
+    // false if the log could not be read or does not hold the stream
+    [[nodiscard]] bool is_valid() const { return stream_idx < reader->get_stream_cnt(); }
+
+    [[nodiscard]] std::size_t get_frame_cnt() const { return reader->get_frame_cnt(); }
+
+    void set_outp_func(std::function<std::span<float>()>) override;
+
+    void process() override;
+
+    [[nodiscard]] std::size_t get_outp_id() const override { return id; }
+    [[nodiscard]] std::size_t get_outp_size() const override;
+    [[nodiscard]] io_elem_t get_outp_elem_type() const override;
+
+    [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return {}; };
+
+    [[nodiscard]] std::string status_str() const override;
+
+    void save_state(checkpoint_writer &cw) const override;
+    bool load_state(checkpoint_reader &cr) override;
+};
+
+} // sim
+
+#endif //SIM_REPLAY_H
@@ -0,0 +1,86 @@
+#ifndef SIM_RUN_AHEAD_H
+#define SIM_RUN_AHEAD_H
+
+#include <functional>
+#include <thread>
+
+#include "spsc_queue.h"
+
+namespace sim {
+
+/*
+ * Runs the frame generation of an input entity ahead of the simulation on a background thread. The producer function
+ * fills frames into a spsc_queue of the given depth, the entity takes one frame per step (next) and only copies it
+ * into its output, i.e., the generation cost is removed from the step latency.
+ * The last taken frame stays valid until the next call of next(), such that entities can keep the generator state
+ * that belongs to the consumed frame (e.g., for checkpoints) within the frame instead of copying it. stop() joins the
+ * producer and discards all frames, the producer function may then be re-seeded and the producer restarted.
+ */
+template<class Frame>
+class run_ahead {
+
+    spsc_queue<Frame>           queue;
+    std::function<void(Frame&)> produce;
+    std::jthread                worker;
+    const Frame*                held {nullptr};
+
+public:
+    run_ahead(std::size_t depth, const Frame &proto, std::function<void(Frame&)> produce_func) :
+        queue(depth + 1, proto), // + 1 for the held frame
+        produce(std::move(produce_func))
+    {}
+
+    run_ahead(const run_ahead&)            = delete;
+    run_ahead& operator=(const run_ahead&) = delete;
+
+    ~run_ahead() { stop(); }
+
+    void start()
+    {
+        if (worker.joinable())
+            return;
+        worker = std::jthread([this](const std::stop_token &stoken) {
+            while (!stoken.stop_requested()) {
+                Frame *slot = queue.write_slot();
+                if (slot == nullptr) {
+                    queue.wait_writable(stoken);
+                    continue;
+                }
+                produce(*slot);
+                queue.publish();
+            }
+        });
+    }
+
+    void stop()
+    {
+        if (worker.joinable()) {
+            worker.request_stop();
+            queue.wake();
+            worker.join();
+        }
+        queue.clear();
+        held = nullptr;
+    }
+
+    [[nodiscard]] bool running() const { return worker.joinable(); }
+
+    // number of frames ready (including the held frame)
+    [[nodiscard]] std::size_t size() const { return queue.size(); }
+
+    // releases the previously taken frame and blocks until the next frame is available
+    const Frame& next()
+    {
+        if (held != nullptr)
+            queue.release();
+        held = &queue.wait_read_slot();
+        return *held;
+    }
+
+    // the frame taken by the last call of next(), nullptr if none was taken since the (re)start
+    [[nodiscard]] const Frame* last() const { return held; }
+};
+
+} // sim
+
+#endif //SIM_RUN_AHEAD_H
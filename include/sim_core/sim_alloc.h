@@ -0,0 +1,120 @@
+#ifndef SIM_ALLOC_H
+#define SIM_ALLOC_H
+
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace sim {
+
+// alignment of all allocations, one cache line (and one AVX-512 register)
+constexpr std::size_t alloc_alignment = 64;
+
+// allocations of at least this size are aligned to huge page boundaries (see set_huge_pages)
+constexpr std::size_t huge_page_size  = std::size_t{2} << 20;
+
+/*
+ * Enables madvise(MADV_HUGEPAGE) for all heap allocations of at least huge_page_size, i.e., large synapse arrays are
+ * backed by transparent huge pages and sweeping them takes far fewer TLB misses. Only affects allocations made after
+ * the call. Without transparent huge page support (or on non Linux systems) this is a no-op.
+ */
+void set_huge_pages(bool enable);
+[[nodiscard]] bool huge_pages_enabled();
+
+/*
+ * Bump allocator for models that are built once and then mostly read (e.g., loaded from a checkpoint for evaluation).
+ * Memory is taken from large chunks (mmap, optionally from hugetlbfs via MAP_HUGETLB with a fallback to transparent
+ * huge pages) and only released when the arena is destroyed, deallocations are ignored. Containers that grow after
+ * the construction therefore leave their old storage in the arena until then.
+ * All aligned_allocator instances constructed while an arena_scope is active on the current thread allocate from its
+ * arena, the arena has to outlive all containers using it.
+ */
+class arena {
+
+    struct chunk_t {
+        std::byte  *base;
+        std::size_t size;
+        std::size_t used;
+    };
+
+    std::vector<chunk_t> chunks;
+    std::size_t          chunk_size;
+    bool                 huge_tlb;
+    std::mutex           mtx; // containers may grow concurrently (e.g., during parallel adaptation)
+
+    void add_chunk(std::size_t min_size);
+
+public:
+    explicit arena(std::size_t chunk_size = std::size_t{64} << 20, bool huge_tlb = false);
+    ~arena();
+
+    arena(const arena&)            = delete;
+    arena& operator=(const arena&) = delete;
+
+    [[nodiscard]] void* allocate(std::size_t bytes);
+
+    [[nodiscard]] std::size_t used_bytes()     const;
+    [[nodiscard]] std::size_t reserved_bytes() const;
+
+    // arena of the innermost active arena_scope of the current thread, nullptr if none
+    [[nodiscard]] static arena* current();
+
+    friend class arena_scope;
+};
+
+class arena_scope {
+    arena *prev;
+public:
+    explicit arena_scope(arena &a);
+    ~arena_scope();
+
+    arena_scope(const arena_scope&)            = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+};
+
+// raw allocation functions used by aligned_allocator, src == nullptr allocates from the heap
+[[nodiscard]] void* allocate_aligned(std::size_t bytes, arena *src);
+void deallocate_aligned(void *ptr, std::size_t bytes, arena *src) noexcept;
+
+/*
+ * Project allocator for the large SOA arrays (synapses, segments, io buffer slots): 64-byte aligned, huge page backed
+ * if enabled and optionally taken from an arena. The allocator binds to the current arena on construction and is
+ * propagated with its container, such that the storage of a container always returns to where it came from.
+ */
+template<class T>
+class aligned_allocator {
+public:
+    using value_type                             = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+    using is_always_equal                        = std::false_type;
+
+    arena *src;
+
+    aligned_allocator() noexcept : src(arena::current()) {}
+
+    template<class U>
+    aligned_allocator(const aligned_allocator<U> &other) noexcept : src(other.src) {}
+
+    [[nodiscard]] T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(allocate_aligned(n * sizeof(T), src));
+    }
+
+    void deallocate(T *ptr, std::size_t n) noexcept
+    {
+        deallocate_aligned(ptr, n * sizeof(T), src);
+    }
+
+    template<class U>
+    bool operator==(const aligned_allocator<U> &other) const noexcept { return src == other.src; }
+};
+
+template<class T>
+using aligned_vector = std::vector<T, aligned_allocator<T>>;
+
+} // sim
+
+#endif //SIM_ALLOC_H
@@ -11,22 +11,68 @@
 #include <utility>
 #include <generator>
 #include <memory>
+#include <optional>
+#include <string_view>
+#include <functional>
 
 #include "io_entity.h"
 #include "io_buffer.h"
+#include "checkpoint.h"
+#include "sim_timing.h"
+#include "io_batch.h"
+#include "output_cache.h"
 
 namespace sim {
 
+/*
+ * Entity types may provide a static "process_all(std::span<T>)" to process all entities of the type as one batch
+ * (e.g., one parallel loop over the neurons of all neuron groups). Otherwise the entities are processed one after
+ * another with a statically dispatched call of T::process().
+ */
+template<class T>
+concept batch_processable = requires(std::span<T> ents) { T::process_all(ents); };
+
+template<class T>
+requires std::is_base_of_v<io_entity, T>
+void process_batch(std::span<T> ents)
+{
+    if constexpr (batch_processable<T>) {
+        T::process_all(ents);
+    } else {
+        for (T &ent : ents)
+            ent.T::process();
+    }
+}
+
+/*
+ * creates the io buffers of all given entities (sized by the maximum delay of the consumers, see io_buffer.h) and
+ * hands over the output and input functions, shared by the dynamic env and static_env (see static_env.h)
+ */
+void connect_io_buffers(std::unordered_map<std::size_t,io_buffer> &io_buffers, const std::vector<io_entity*> &entities);
+
 class entity_vec {
 public:
     virtual ~entity_vec() = default;
     [[nodiscard]] virtual std::size_t get_size() const { std::unreachable(); };
     [[nodiscard]] virtual io_entity&  as_base(std::size_t) { std::unreachable(); };
+    [[nodiscard]] virtual std::string_view get_checkpoint_tag() const { std::unreachable(); };
+
+    // processes all entities of this vector (only those that tick, if a tick function is given, see env::set_clock),
+    // records the timings into the per entity or per batch histograms
+    virtual void process_all(
+        std::unordered_map<std::size_t,latency_histogram>&,
+        const std::function<bool(std::size_t)>*
+    ) { std::unreachable(); };
+    [[nodiscard]] virtual const latency_histogram* get_batch_timing() const { return nullptr; }
+    virtual void reset_batch_timing() {}
 };
 
 template<class T>
 requires std::is_base_of_v<io_entity, T>
 class typed_entity_vec : public entity_vec, public std::vector<T> {
+
+    latency_histogram batch_timing;
+
 public:
     [[nodiscard]] std::size_t get_size() const override
     {
@@ -36,32 +82,162 @@ public:
     {
         return std::vector<T>::at(idx);
     }
+    [[nodiscard]] std::string_view get_checkpoint_tag() const override
+    {
+        return T::checkpoint_tag;
+    }
+
+    void process_all(
+        std::unordered_map<std::size_t,latency_histogram> &entity_timings,
+        const std::function<bool(std::size_t)>            *tick
+    ) override
+    {
+        if constexpr (batch_processable<T>) {
+            COAST_TIME_SCOPE(&batch_timing);
+            const std::span<T> ents(*this);
+            if (tick == nullptr) {
+                process_batch(ents);
+                return;
+            }
+            // consecutive entities that tick are processed as one batch
+            for (std::size_t begin = 0; begin < ents.size(); ) {
+                if (!(*tick)(ents[begin].get_outp_id())) {
+                    ++begin;
+                    continue;
+                }
+                std::size_t end = begin + 1;
+                while (end < ents.size() && (*tick)(ents[end].get_outp_id()))
+                    ++end;
+                process_batch(ents.subspan(begin, end - begin));
+                begin = end;
+            }
+        } else {
+            for (T &ent : *this) {
+                if (tick != nullptr && !(*tick)(ent.get_outp_id()))
+                    continue;
+                COAST_TIME_SCOPE(&entity_timings.at(ent.get_outp_id()));
+                ent.T::process();
+            }
+        }
+    }
+    [[nodiscard]] const latency_histogram* get_batch_timing() const override
+    {
+        return batch_processable<T> ? &batch_timing : nullptr;
+    }
+    void reset_batch_timing() override { batch_timing.reset(); }
+};
+
+// parameters of the output caches of frozen entities (see env::freeze)
+struct freeze_params_t {
+    std::optional<io_elem_t> elem;                               // element type of the buffers if empty
+    std::size_t              max_bytes = std::size_t{1} << 30;   // per entity
 };
 
 class env {
 
+    // optional arena for the arrays of the entities (see use_huge_page_arena), declared first to outlive the entities
+    std::unique_ptr<arena> alloc_arena;
+
     std::unordered_map<std::type_index,std::unique_ptr<entity_vec>> entities;
     std::unordered_map<std::size_t,io_buffer> io_buffers;
 
+    // number of simulation steps, i.e., calls to process()
+    std::size_t step_cnt {};
+
+    // hooks are called every "interval" steps
+    struct hook_t {
+        std::function<void()> func;
+        std::size_t           interval;
+    };
+
     std::size_t next_hook_id {};
-    std::unordered_map<std::size_t,std::function<void()>> pre_process_hooks;
-    std::unordered_map<std::size_t,std::function<void()>> post_process_hooks;
-    std::unordered_map<std::size_t,std::function<void()>> pre_swap_hooks;
-    std::unordered_map<std::size_t,std::function<void()>> post_swap_hooks;
+    std::unordered_map<std::size_t,hook_t> pre_process_hooks;
+    std::unordered_map<std::size_t,hook_t> post_process_hooks;
+    std::unordered_map<std::size_t,hook_t> pre_swap_hooks;
+    std::unordered_map<std::size_t,hook_t> post_swap_hooks;
+    std::unordered_map<std::size_t,io_batch_recorder> batch_hooks;
 
-public:
+    void run_hooks(std::unordered_map<std::size_t,hook_t> &hooks) const;
 
-    template<class T, class... Ps>
+    // step timings (only recorded if COAST_ENABLE_TIMING is defined, see sim_timing.h)
+    enum env_timing_t : std::size_t {
+        timing_process,
+        timing_swap_io
+    };
+    timing_set env_timings {"process", "swap_io"};
+    std::unordered_map<std::size_t,latency_histogram> entity_timings;
+
+    // sequence ID of the last checkpoint written or loaded (0 if none), deltas are based on it
+    uint64_t checkpoint_sequence {};
+
+    bool write_checkpoint(const std::string &file_name, checkpoint_header_t::kind_t kind);
+
+    // optional static partitioning of the entities onto threads (see set_schedule)
+    std::vector<std::vector<io_entity*>> schedule;
+
+    // optional clock dividers of the entities (see set_clock), keyed by output ID
+    struct entity_clock_t {
+        std::size_t divider;
+        std::size_t phase;
+    };
+    std::unordered_map<std::size_t,entity_clock_t> clocks;
+
+    [[nodiscard]] bool ticks(std::size_t id) const;
+
+    // optional frozen entities whose outputs are served from caches (see freeze), keyed by output ID
+    struct frozen_t {
+        io_entity               *ent;
+        io_buffer               *buf;
+        std::size_t             lag;     // steps between the output of the key source and the output of the entity
+        output_cache            cache;
+        std::optional<uint64_t> key;     // key of the current step, empty if unknown
+        bool                    served;  // output of the current step was taken from the cache
+    };
+    io_entity                                *key_source {nullptr};
+    std::unordered_map<std::size_t,frozen_t>  frozen;
+    std::vector<std::optional<uint64_t>>      sample_keys; // keys of the last outputs of the key source (ring)
+
+    void serve_frozen();
+    void store_frozen();
+
+    template<class T>
     requires std::is_base_of_v<io_entity, T>
-    void emplace_back(Ps... params)
+    typed_entity_vec<T>* get_or_create_entities()
     {
         auto it = entities.find(std::type_index(typeid(T)));
         if (it == entities.end()) {
             auto [new_it,inserted] = entities.insert( {std::type_index(typeid(T)), std::make_unique<typed_entity_vec<T>>() } );
             it = new_it;
         }
-        typed_entity_vec<T> *ev = dynamic_cast<typed_entity_vec<T>*>(it->second.get());
-        ev->emplace_back(params...);
+        return dynamic_cast<typed_entity_vec<T>*>(it->second.get());
+    }
+
+public:
+
+    template<class T, class... Ps>
+    requires std::is_base_of_v<io_entity, T>
+    void emplace_back(Ps&&... params)
+    {
+        std::optional<arena_scope> scope;
+        if (alloc_arena)
+            scope.emplace(*alloc_arena);
+        get_or_create_entities<T>()->emplace_back(std::forward<Ps>(params)...);
+    }
+
+    /*
+     * Allocates the arrays of all entities added after the call (e.g., the synapse arrays of the dendrites) from an
+     * arena owned by this env that is backed by transparent huge pages (see sim::arena). The arrays of a single
+     * dendrite are far below huge_page_size, i.e., set_huge_pages alone does not affect them. Storage left behind by
+     * growing arrays (e.g., when dendrites branch) is only released with the env.
+     */
+    void use_huge_page_arena();
+
+    // pre-sizes the storage for entities of type T, e.g., if the number of entities is known from a topology file
+    template<class T>
+    requires std::is_base_of_v<io_entity, T>
+    void reserve(std::size_t cnt)
+    {
+        get_or_create_entities<T>()->reserve(cnt);
     }
 
     template<class T>
@@ -88,18 +264,91 @@ public:
 
     std::generator<io_entity&> iterate_entities();
 
+    /*
+     * Entities only read the previous outputs and write their own output buffer during process(), hence they can be
+     * processed concurrently. A schedule assigns every entity (by output id) to one partition, the partitions are
+     * processed in parallel and the entities of a partition in the given order. An empty schedule processes all
+     * entity types one after another (see process_batch). No entities may be added after setting a schedule.
+     */
+    void set_schedule(const std::vector<std::vector<std::size_t>> &partitions);
+    [[nodiscard]] std::size_t get_partition_count() const { return schedule.size(); }
+
+    /*
+     * Entities with a clock divider n > 1 are only processed on every n-th step (on the steps with (step - 1) % n ==
+     * phase), their output buffer is only swapped on these steps as well, i.e., consumers keep reading the last
+     * published output in between and input delays of consumers count the ticks of the producer. Entities without a
+     * clock (or a divider of 1) are processed on every step. The step count is part of checkpoints, hence the clocks
+     * continue in phase after loading.
+     */
+    void set_clock(std::size_t id, std::size_t divider, std::size_t phase = 0);
+
+    /*
+     * Layer-wise training: freezes the given entities (they stop learning, see io_entity::set_frozen) and caches their
+     * outputs per sample key of the key source (e.g., a mnist_io with noise variants, see io_entity::get_sample_key).
+     * Every input of a frozen entity has to be the key source or another frozen entity, and all paths from the key
+     * source have to take the same number of steps (including input delays), i.e., the output of a frozen entity only
+     * depends on the sample that the key source emitted a fixed number of steps earlier. Once the output for a key is
+     * cached the entity is not processed anymore for that key, the cached output is published instead. Outputs are
+     * stored in the element type of their buffer unless params.elem is given, up to params.max_bytes per entity. The
+     * cache holds one entry per key, e.g., images * noise variants for a mnist_io source (see set_noise_variants).
+     * Stochastic entities (e.g., neuron groups with intrinsic noise) replay the first response to every key.
+     * Requires init_io_buffers() to be called before, frozen entities and the key source may not have a clock.
+     */
+    bool freeze(std::size_t key_source_id, const std::vector<std::size_t> &ids, const freeze_params_t &params = {});
+    void unfreeze();
+
+    [[nodiscard]] std::optional<output_cache::stats_t> get_frozen_stats(std::size_t id) const;
+
     void process();
     void swap_io();
 
-    std::size_t set_pre_process_hook(std::function<void()> func);
-    std::size_t set_post_process_hook(std::function<void()> func);
-    std::size_t set_pre_swap_hook(std::function<void()> func);
-    std::size_t set_post_swap_hook(std::function<void()> func);
+    [[nodiscard]] std::size_t get_step_cnt() const { return step_cnt; }
+
+    // hooks are called on every step by default, an interval > 1 calls the hook only on every n-th step
+    std::size_t set_pre_process_hook(std::function<void()> func, std::size_t interval = 1);
+    std::size_t set_post_process_hook(std::function<void()> func, std::size_t interval = 1);
+    std::size_t set_pre_swap_hook(std::function<void()> func, std::size_t interval = 1);
+    std::size_t set_post_swap_hook(std::function<void()> func, std::size_t interval = 1);
+
+    /*
+     * Batch hooks observe the given io buffers after every swap and receive the recorded snapshots in batches of up to
+     * batch_size steps (see io_batch.h), which allows observers like visualizations to pay their cost once per batch
+     * instead of once per step. flush_batch_hooks delivers all pending snapshots, e.g., once per gui frame.
+     * Requires init_io_buffers() to be called before.
+     */
+    std::size_t set_batch_hook(
+        const std::vector<std::size_t>       &buffer_ids,
+        std::size_t                          batch_size,
+        io_batch_recorder::mode_t            mode,
+        std::function<void(const io_batch&)> func
+    );
+    void flush_batch_hooks();
 
     void remove_pre_process_hook(std::size_t id);
     void remove_post_process_hook(std::size_t id);
     void remove_pre_swap_hook(std::size_t id);
     void remove_post_swap_hook(std::size_t id);
+    void remove_batch_hook(std::size_t id);
+
+    // timing support (see sim_timing.h). Per entity process() timings are keyed by the entity's output ID, the
+    // phase timings of the entities and the timings of batch processed types are included in the JSON dump.
+    [[nodiscard]] const timing_set&        get_env_timings() const { return env_timings; }
+    [[nodiscard]] const latency_histogram* get_entity_timing(std::size_t id) const;
+    [[nodiscard]] std::string              timings_json();
+    void reset_timings();
+
+    // checkpoint support (see checkpoint.h). Entities and io buffers are matched by their IDs, hence a checkpoint
+    // can only be loaded into an environment with the same topology after init_io_buffers() was called.
+    // Delta checkpoints require a previous checkpoint (written or loaded) and can only be loaded on top of the
+    // checkpoint they are based on, load_checkpoints replays a base snapshot followed by its deltas.
+    // A malformed checkpoint (e.g., truncated or with broken record headers) is rejected before any state is modified.
+    // Inconsistent contents of a single record are only detected while it is restored, such a failed load leaves the
+    // environment partially restored (and a chain partially replayed), i.e., it has to be reloaded from a valid
+    // checkpoint before it is used again.
+    bool save_checkpoint(const std::string &file_name);
+    bool save_delta_checkpoint(const std::string &file_name);
+    bool load_checkpoint(const std::string &file_name);
+    bool load_checkpoints(std::span<const std::string> file_names);
 
 };
 
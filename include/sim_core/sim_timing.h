@@ -0,0 +1,118 @@
+#ifndef SIM_TIMING_H
+#define SIM_TIMING_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sim {
+
+/*
+ * HDR-style latency histogram. Values (nanoseconds) are recorded into log-linear buckets, i.e., every power of two is
+ * split into linear sub buckets, which bounds the relative error of the reported percentiles to ~3% while the memory
+ * footprint stays constant. Recording is lock-free and can happen concurrently from multiple threads.
+ */
+class latency_histogram {
+
+public:
+    static constexpr int         sub_bucket_bits = 6;
+    static constexpr std::size_t half_sub_cnt    = 1 << (sub_bucket_bits - 1);
+    static constexpr std::size_t bucket_cnt      = (64 - sub_bucket_bits + 1) * half_sub_cnt + half_sub_cnt;
+
+private:
+    std::array<std::atomic<uint64_t>,bucket_cnt> counts {};
+    std::atomic<uint64_t> total_cnt {};
+    std::atomic<uint64_t> total_sum {};
+    std::atomic<uint64_t> max_val   {};
+
+    static std::size_t bucket_idx(uint64_t val);
+    static uint64_t    bucket_upper_bound(std::size_t idx);
+
+public:
+    void record(uint64_t ns);
+    void reset();
+
+    [[nodiscard]] uint64_t count() const { return total_cnt.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t max()   const { return max_val.load(std::memory_order_relaxed);   }
+    [[nodiscard]] double   mean()  const;
+
+    // percentile in [0..100], reported as the upper bound of the respective bucket
+    [[nodiscard]] uint64_t percentile(double p) const;
+
+    [[nodiscard]] std::string to_json() const;
+};
+
+/*
+ * fixed set of named histograms, e.g., one per processing phase of an entity. The histograms live on the heap, hence
+ * references to them stay valid when the owning entity is moved.
+ */
+class timing_set {
+
+    std::vector<std::string>             names;
+    std::unique_ptr<latency_histogram[]> hists;
+
+public:
+    timing_set(std::initializer_list<std::string_view> _names);
+
+    [[nodiscard]] std::size_t              size()                  const { return names.size(); }
+    [[nodiscard]] const std::string&       name(std::size_t idx)   const { return names[idx];   }
+    [[nodiscard]] latency_histogram&       operator[](std::size_t idx)   { return hists[idx];   }
+    [[nodiscard]] const latency_histogram& operator[](std::size_t idx) const { return hists[idx]; }
+
+    void reset();
+
+    [[nodiscard]] std::string to_json() const;
+};
+
+/*
+ * records the life time of the scope into the given histogram (if any)
+ */
+class scoped_timer {
+
+    using clock = std::chrono::steady_clock;
+
+    latency_histogram *hist;
+    clock::time_point  start;
+
+public:
+    explicit scoped_timer(latency_histogram *_hist) : hist(_hist), start(clock::now()) {}
+    ~scoped_timer()
+    {
+        if (hist)
+            hist->record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count());
+    }
+
+    scoped_timer(const scoped_timer&) = delete;
+    scoped_timer& operator=(const scoped_timer&) = delete;
+};
+
+// true if timings are recorded in this build
+inline constexpr bool timing_enabled =
+#ifdef COAST_ENABLE_TIMING
+    true;
+#else
+    false;
+#endif
+
+} // sim
+
+/*
+ * Times the enclosing scope. Timing is compiled out entirely (including the evaluation of the histogram expression)
+ * unless COAST_ENABLE_TIMING is defined (see the CMake option of the same name). The expression only appears in an
+ * unevaluated context in that case.
+ */
+#define COAST_TIMING_CONCAT_IMPL(a, b) a##b
+#define COAST_TIMING_CONCAT(a, b) COAST_TIMING_CONCAT_IMPL(a, b)
+#ifdef COAST_ENABLE_TIMING
+#define COAST_TIME_SCOPE(hist_ptr) const sim::scoped_timer COAST_TIMING_CONCAT(coast_scoped_timer_, __LINE__) { hist_ptr }
+#else
+#define COAST_TIME_SCOPE(hist_ptr) static_cast<void>(sizeof(hist_ptr))
+#endif
+
+#endif //SIM_TIMING_H
@@ -0,0 +1,112 @@
+#ifndef SIM_SPSC_QUEUE_H
+#define SIM_SPSC_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stop_token>
+#include <vector>
+
+namespace sim {
+
+/*
+ * Bounded lock-free single-producer / single-consumer queue of preallocated slots. Instead of pushing and popping
+ * values, the producer fills the next free slot in place (write_slot + publish) and the consumer reads the oldest slot
+ * in place (read_slot + release), i.e., there are no allocations or copies of the elements. A slot stays valid for
+ * the consumer until it is released.
+ * Blocking waits use std::atomic::wait, waits for a free slot (wait_writable) or a published slot (wait_readable) are
+ * additionally woken up by wake() (e.g., to stop the producer thread).
+ */
+template<class T>
+class spsc_queue {
+
+    static constexpr std::size_t cache_line = 64;
+
+    std::vector<T> slots;
+
+    // monotonic counters, the slot of a counter value is value % capacity
+    alignas(cache_line) std::atomic<std::size_t> head {0}; // next slot to read (consumer)
+    alignas(cache_line) std::atomic<std::size_t> tail {0}; // next slot to write (producer)
+    alignas(cache_line) std::atomic<uint32_t>    signal {0}; // changed on every publish, release and wake
+
+public:
+    explicit spsc_queue(std::size_t capacity, const T &proto = T{}) :
+        slots(std::max<std::size_t>(capacity, 1), proto)
+    {}
+
+    [[nodiscard]] std::size_t capacity() const { return slots.size(); }
+    [[nodiscard]] std::size_t size()     const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+    // producer side: next free slot or nullptr if the queue is full
+    [[nodiscard]] T* write_slot()
+    {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size())
+            return nullptr;
+        return &slots[t % slots.size()];
+    }
+
+    void publish()
+    {
+        tail.fetch_add(1, std::memory_order_release);
+        tail.notify_one();
+        wake();
+    }
+
+    // blocks until a slot is free, the stop is requested or wake() was called
+    void wait_writable(const std::stop_token &stoken)
+    {
+        const uint32_t sig = signal.load(std::memory_order_acquire);
+        if (stoken.stop_requested() || write_slot() != nullptr)
+            return;
+        signal.wait(sig, std::memory_order_acquire);
+    }
+
+    void wake()
+    {
+        signal.fetch_add(1, std::memory_order_release);
+        signal.notify_all();
+    }
+
+    // consumer side: oldest published slot or nullptr if the queue is empty
+    [[nodiscard]] T* read_slot()
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        if (tail.load(std::memory_order_acquire) == h)
+            return nullptr;
+        return &slots[h % slots.size()];
+    }
+
+    // blocks until a slot is published
+    [[nodiscard]] T& wait_read_slot()
+    {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        tail.wait(h, std::memory_order_acquire);
+        return slots[h % slots.size()];
+    }
+
+    // blocks until a slot is published, the stop is requested or wake() was called
+    void wait_readable(const std::stop_token &stoken)
+    {
+        const uint32_t sig = signal.load(std::memory_order_acquire);
+        if (stoken.stop_requested() || read_slot() != nullptr)
+            return;
+        signal.wait(sig, std::memory_order_acquire);
+    }
+
+    void release()
+    {
+        head.fetch_add(1, std::memory_order_release);
+        wake();
+    }
+
+    // discards all slots, only valid while the producer is not running
+    void clear()
+    {
+        head.store(tail.load());
+    }
+};
+
+} // sim
+
+#endif //SIM_SPSC_QUEUE_H
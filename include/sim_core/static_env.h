@@ -0,0 +1,95 @@
+#ifndef SIM_STATIC_ENV_H
+#define SIM_STATIC_ENV_H
+
+#include <algorithm>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "io_buffer.h"
+#include "io_entity.h"
+#include "sim_env.h"
+
+namespace sim {
+
+/*
+ * Compile-time variant of the simulation environment for a fixed list of entity types. The entities of each type are
+ * stored contiguously and processed as one batch (see process_batch in sim_env.h) without any virtual calls or type
+ * lookups. The io buffers are set up exactly like in env. Hooks, schedules, clocks, timings and checkpoints are only
+ * supported by the dynamic env, static_env is meant for lean headless runs, e.g., parameter sweeps.
+ */
+template<class... Ts>
+requires (std::is_base_of_v<io_entity, Ts> && ...)
+class static_env {
+
+    std::tuple<std::vector<Ts>...>            entities;
+    std::unordered_map<std::size_t,io_buffer> io_buffers;
+    std::size_t                               step_cnt {};
+
+public:
+
+    template<class T, class... Ps>
+    void emplace_back(Ps&&... params)
+    {
+        std::get<std::vector<T>>(entities).emplace_back(std::forward<Ps>(params)...);
+    }
+
+    template<class T>
+    void reserve(std::size_t cnt)
+    {
+        std::get<std::vector<T>>(entities).reserve(cnt);
+    }
+
+    template<class T>
+    [[nodiscard]] std::vector<T>& get_entities()
+    {
+        return std::get<std::vector<T>>(entities);
+    }
+
+    // no entities may be added after the io buffers were initialized
+    void init_io_buffers()
+    {
+        std::vector<io_entity*> all_entities;
+        std::apply(
+            [&](auto&... ent_vecs) {
+                (std::ranges::for_each(ent_vecs, [&](io_entity &ent) { all_entities.push_back(&ent); }), ...);
+            },
+            entities
+        );
+        connect_io_buffers(io_buffers, all_entities);
+    }
+
+    [[nodiscard]] std::optional<io_buffer*> get_io_buffer(std::size_t id)
+    {
+        auto it = io_buffers.find(id);
+        if (it == io_buffers.end())
+            return {};
+        return &it->second;
+    }
+
+    void process()
+    {
+        ++step_cnt;
+        std::apply(
+            [](auto&... ent_vecs) {
+                (process_batch(std::span(ent_vecs)), ...);
+            },
+            entities
+        );
+    }
+
+    void swap_io()
+    {
+        for (auto &buf : io_buffers | std::views::values)
+            buf.swap_buffer();
+    }
+
+    [[nodiscard]] std::size_t get_step_cnt() const { return step_cnt; }
+};
+
+} // sim
+
+#endif //SIM_STATIC_ENV_H
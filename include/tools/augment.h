@@ -0,0 +1,40 @@
+#ifndef AUGMENT_H
+#define AUGMENT_H
+
+#include <cstdint>
+#include <random>
+#include <span>
+
+namespace mdb {
+
+/*
+ * Parameters of the image augmentation, every transformation is disabled by a value of 0. The random parameters of
+ * each image are drawn uniformly from the given ranges.
+ */
+struct augment_params_t {
+    float max_shift      = 2.0f;   // translation in pixels
+    float max_rotation   = 10.0f;  // rotation in degrees
+    float elastic_alpha  = 0.0f;   // scale of the elastic displacement field in pixels (Simard et al. use 34)
+    float elastic_sigma  = 4.0f;   // smoothing of the elastic displacement field in pixels
+    float contrast       = 0.2f;   // contrast factor in [1-contrast..1+contrast] (around the mean intensity)
+    float occlusion_prob = 0.0f;   // probability of an occluding rectangle
+    float occlusion_size = 0.25f;  // edge length of the occluding rectangle relative to the image
+};
+
+/*
+ * Renders a randomly transformed copy of a u8 image (width * height, row-major) into outp (normalized intensities, see
+ * mnist_db::norm_pixel). All random values are drawn from rgen, i.e., the result only depends on the image, the
+ * parameters and the state of rgen. Thread-safe (the scratch buffers are thread local).
+ */
+void augment_image(
+    std::span<const uint8_t> img,
+    std::size_t              width,
+    std::size_t              height,
+    std::span<float>         outp,
+    const augment_params_t  &params,
+    std::mt19937            &rgen
+);
+
+} // mdb
+
+#endif //AUGMENT_H
@@ -0,0 +1,124 @@
+#ifndef IDX_STREAM_IO_H
+#define IDX_STREAM_IO_H
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "io_entity.h"
+#include "mnist_db.h"
+#include "run_ahead.h"
+
+namespace sim {
+
+struct idx_stream_params_t {
+    std::size_t chunk_size = 1024;  // samples per chunk
+    std::size_t window     = 4;     // chunks read ahead
+    bool        shuffle    = false;
+};
+
+/*
+ * Streaming variant of mnist_io for idx data sets that do not fit into memory (e.g., EMNIST or exported corpora with
+ * u8 images and u8 labels). A background thread reads chunks of consecutive samples ahead of the simulation into a
+ * bounded window (idx_stream_params_t::window chunks), i.e., only window * chunk_size samples are resident and process() always
+ * finds the next sample ready. With shuffle enabled, the order of the chunks and the order of the samples within each
+ * chunk are permuted per epoch (derived from the seed and the epoch, hence reproducible and checkpointable).
+ * The output is rendered like mnist_io (normalized intensities plus 5% noise, one sample per change interval).
+ */
+class idx_stream_io : public io_entity {
+
+public:
+    using params_t = idx_stream_params_t;
+
+private:
+    struct chunk_t {
+        std::vector<uint8_t>  images;
+        std::vector<uint8_t>  labels;
+        std::vector<uint32_t> order;       // sample order within the chunk
+        std::size_t           count;
+        std::size_t           epoch;
+        std::size_t           order_pos;   // position of the chunk in the chunk order of its epoch
+    };
+
+    // file access and read position of the prefetch thread, on the heap to keep the entity movable
+    struct source_t {
+        std::FILE            *img_file {nullptr};
+        std::FILE            *lbl_file {nullptr};
+        mdb::idx_header_t     img_header {};
+        mdb::idx_header_t     lbl_header {};
+        std::size_t           epoch {0};
+        std::size_t           order_pos {0};
+        std::size_t           order_epoch {~std::size_t{0}};
+        std::vector<uint32_t> chunk_order;
+
+        ~source_t();
+    };
+
+    std::function<std::span<float>()> output_mem {};
+    std::size_t id;
+    io_elem_t   outp_elem;
+    params_t    params;
+    int         change_interval;
+    int         seed;
+
+    std::unique_ptr<source_t>           source;
+    std::unique_ptr<run_ahead<chunk_t>> producer;
+    const chunk_t                      *cur_chunk {nullptr};
+
+    // position of the output within the current chunk
+    std::size_t  sample_pos {0};
+    std::size_t  ci_cnt {0};
+    uint8_t      cur_label {0};
+    std::mt19937 rgen;
+    std::uniform_real_distribution<float> dis;
+
+    [[nodiscard]] std::size_t chunk_cnt() const;
+    void read_chunk(chunk_t &chunk);
+    void restart_producer();
+
+public:
+    static constexpr std::string_view checkpoint_tag = "idx_stream_io";
+
+    idx_stream_io(
+        std::size_t        _id,
+        int                _change_interval,
+        const std::string &img_file,
+        const std::string &label_file,
+        params_t           _params     = {},
+        int                rnd_seed    = 0,
+        io_elem_t          _outp_elem  = io_elem_t::f32
+    );
+
+    // false if the files could not be opened or do not hold u8 images and labels of the same count
+    [[nodiscard]] bool is_valid() const { return source->img_file != nullptr; }
+
+    void set_outp_func(std::function<std::span<float>()>) override;
+
+    void process() override;
+
+    [[nodiscard]] std::size_t get_outp_id() const override { return id; }
+    [[nodiscard]] std::size_t get_outp_size() const override { return source->img_header.element_size; }
+    [[nodiscard]] io_elem_t get_outp_elem_type() const override { return outp_elem; }
+
+    [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return {}; };
+
+    [[nodiscard]] std::string status_str() const override;
+
+    void save_state(checkpoint_writer &cw) const override;
+    bool load_state(checkpoint_reader &cr) override;
+
+    [[nodiscard]] std::size_t get_sample_cnt() const { return source->img_header.num_elements; }
+
+    // label of the current output, 0 before the first step
+    [[nodiscard]] uint8_t get_cur_label() const { return cur_label; }
+
+    [[nodiscard]] int& get_change_interval() { return change_interval; }
+};
+
+} // sim
+
+#endif //IDX_STREAM_IO_H
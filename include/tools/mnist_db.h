@@ -5,111 +5,219 @@
 #ifndef MNIST_DB_H
 #define MNIST_DB_H
 
+#include <bit>
+#include <cstddef>
 #include <cstdint>
-#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <random>
 #include <vector>
 #include <string>
-#include <fstream>
 #include <span>
+#include <type_traits>
 #include <utility>
-#include <iostream>
+
+#include "sim_alloc.h"
 
 namespace mdb {
 
+/*
+ * Read-only memory mapping of a whole file. The mapping is shared with all processes that map the same file, i.e.,
+ * data sets are held only once in the page cache. On systems without mmap the file is read into memory instead.
+ */
+class mapped_file {
+
+    const std::byte        *base {nullptr};
+    std::size_t             length {0};
+    std::vector<std::byte>  fallback;
+
+    void unmap();
+
+public:
+    mapped_file() = default;
+    explicit mapped_file(const std::string &filename);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&)            = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file &&other) noexcept;
+    mapped_file& operator=(mapped_file &&other) noexcept;
+
+    [[nodiscard]] bool                       is_open() const { return base != nullptr; }
+    [[nodiscard]] std::span<const std::byte> bytes()   const { return { base, length }; }
+};
+
+/*
+ * idx file (big endian header and data, see http://yann.lecun.com/exdb/mnist/). The file is memory mapped and single
+ * byte data is exposed directly from the mapping (zero-copy). Multibyte data is converted to the native byte order in
+ * one pass into a single buffer (or also used directly on big endian systems).
+ */
 class idx_file {
 
-    std::vector<uint8_t>    u8_data;
-    std::vector<int8_t>     i8_data;
-    std::vector<int16_t>    i16_data;
-    std::vector<int32_t>    i32_data;
-    std::vector<float>      f32_data;
-    std::vector<double>     f64_data;
+public:
+    enum class data_type_t : uint8_t {
+        none = 0x00,
+        u8   = 0x08,
+        i8   = 0x09,
+        i16  = 0x0B,
+        i32  = 0x0C,
+        f32  = 0x0D,
+        f64  = 0x0E
+    };
+
+private:
+    mapped_file                    file;
+    sim::aligned_vector<std::byte> swapped;  // multibyte data in native byte order
+    std::span<const std::byte>     payload;  // points into the mapping or into swapped
+    data_type_t                    data_type;
 
     std::vector<std::size_t> dimensions;
     std::size_t              element_size;
     std::size_t              num_elements;
 
-    uint8_t bswap(uint8_t x);
-    int16_t bswab(int16_t x);
-    int32_t bswab(int32_t x);
+    template<typename T>
+    static constexpr data_type_t type_of();
 
     template<typename T>
-    void read_data(std::FILE *file, std::vector<T> &data);
+    void map_data(std::span<const std::byte> src);
 public:
     explicit idx_file(const std::string &filename);
 
     [[nodiscard]] std::size_t get_num_elements()   const { return num_elements;      }
     [[nodiscard]] std::size_t get_num_dimensions() const { return dimensions.size(); }
     [[nodiscard]] std::size_t get_element_size()   const { return element_size;      }
+    [[nodiscard]] data_type_t get_data_type()      const { return data_type;         }
 
     [[nodiscard]] const std::vector<std::size_t>& get_dimensions() const { return dimensions; }
 
-    [[nodiscard]] const std::vector<uint8_t>& get_u8()  const { return u8_data;  }
-    [[nodiscard]] const std::vector<int8_t>&  get_i8()  const { return i8_data;  }
-    [[nodiscard]] const std::vector<int16_t>& get_i16() const { return i16_data; }
-    [[nodiscard]] const std::vector<int32_t>& get_i32() const { return i32_data; }
-    [[nodiscard]] const std::vector<float>&   get_f32() const { return f32_data; }
-    [[nodiscard]] const std::vector<double>&  get_f64() const { return f64_data; }
+    // all elements, empty if the file holds another data type
+    template<typename T>
+    [[nodiscard]] std::span<const T> get_data() const;
+
+    [[nodiscard]] std::span<const uint8_t> get_u8()  const { return get_data<uint8_t>(); }
+    [[nodiscard]] std::span<const int8_t>  get_i8()  const { return get_data<int8_t>();  }
+    [[nodiscard]] std::span<const int16_t> get_i16() const { return get_data<int16_t>(); }
+    [[nodiscard]] std::span<const int32_t> get_i32() const { return get_data<int32_t>(); }
+    [[nodiscard]] std::span<const float>   get_f32() const { return get_data<float>();   }
+    [[nodiscard]] std::span<const double>  get_f64() const { return get_data<double>();  }
 
     template<typename T>
     [[nodiscard]] std::span<const T> get_element(std::size_t idx) const;
 };
 
 template<typename T>
-void idx_file::read_data(std::FILE *file, std::vector<T> &data)
+constexpr idx_file::data_type_t idx_file::type_of()
 {
-    T tmp;
-    while (true) {
-        int elements_read = std::fread(&tmp,sizeof(T),1,file);
-        if (elements_read != 1) break;
-        if constexpr (std::is_integral_v<T>) {
-            data.push_back(bswap(tmp));
-        } else {
-            data.push_back(tmp);
-        }
-    }
+    if constexpr (std::is_same_v<T, uint8_t>) return data_type_t::u8;
+    if constexpr (std::is_same_v<T, int8_t>)  return data_type_t::i8;
+    if constexpr (std::is_same_v<T, int16_t>) return data_type_t::i16;
+    if constexpr (std::is_same_v<T, int32_t>) return data_type_t::i32;
+    if constexpr (std::is_same_v<T, float>)   return data_type_t::f32;
+    if constexpr (std::is_same_v<T, double>)  return data_type_t::f64;
+    return data_type_t::none;
 }
 
+/*
+ * exposes the data of the mapping, multibyte values are byte swapped in a single (vectorizable) pass unless the system
+ * is big endian and the data is suitably aligned within the mapping
+ */
 template<typename T>
-std::span<const T> idx_file::get_element(std::size_t idx) const
+void idx_file::map_data(std::span<const std::byte> src)
 {
-    if (idx >= num_elements) idx = num_elements - 1;
-    if constexpr (std::is_same_v<T, uint8_t>) {
-        return std::span(&u8_data[idx * element_size], element_size);
-    }
-    if constexpr (std::is_same_v<T, int8_t>) {
-        return std::span(&i8_data[idx * element_size], element_size);
-    }
-    if constexpr (std::is_same_v<T, int16_t>) {
-        return std::span(&i16_data[idx * element_size], element_size);
-    }
-    if constexpr (std::is_same_v<T, int32_t>) {
-        return std::span(&i32_data[idx * element_size], element_size);
-    }
-    if constexpr (std::is_same_v<T, float>) {
-        return std::span(&f32_data[idx * element_size], element_size);
+    const bool aligned = reinterpret_cast<std::uintptr_t>(src.data()) % alignof(T) == 0;
+    if (sizeof(T) == 1 || (std::endian::native == std::endian::big && aligned)) {
+        payload = src;
+        return;
     }
-    if constexpr (std::is_same_v<T, double>) {
-        return std::span(&f64_data[idx * element_size], element_size);
+    using U = std::conditional_t<sizeof(T) == 2, uint16_t, std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>;
+    swapped.resize(src.size());
+    const std::size_t cnt = src.size() / sizeof(T);
+    const std::byte *in   = src.data();
+    std::byte       *out  = swapped.data();
+    for (std::size_t i = 0; i < cnt; ++i) {
+        U val;
+        std::memcpy(&val, in + i * sizeof(T), sizeof(T));
+        if constexpr (std::endian::native == std::endian::little)
+            val = std::byteswap(val);
+        std::memcpy(out + i * sizeof(T), &val, sizeof(T));
     }
+    payload = swapped;
+}
+
+template<typename T>
+std::span<const T> idx_file::get_data() const
+{
+    if (data_type != type_of<T>())
+        return {};
+    return { reinterpret_cast<const T*>(payload.data()), payload.size() / sizeof(T) };
+}
 
+template<typename T>
+std::span<const T> idx_file::get_element(std::size_t idx) const
+{
+    const auto data = get_data<T>();
+    if (data.empty() || num_elements == 0)
+        return {};
+    if (idx >= num_elements) idx = num_elements - 1;
+    return data.subspan(idx * element_size, element_size);
 }
 
+/*
+ * header of an idx file, the data of element i starts at data_offset + i * element_size * type_size
+ */
+struct idx_header_t {
+    idx_file::data_type_t    data_type;
+    std::vector<std::size_t> dimensions;
+    std::size_t              element_size;  // values per element
+    std::size_t              num_elements;
+    std::size_t              type_size;     // bytes per value
+    std::size_t              data_offset;
+};
+
+// parses the header at the beginning of the given bytes (at most max_idx_header_size bytes are needed)
+[[nodiscard]] std::optional<idx_header_t> parse_idx_header(std::span<const std::byte> bytes);
+
+constexpr std::size_t max_idx_header_size = 4 + 4 * 255;
+
+/*
+ * normalizes an image (see mnist_db::norm_pixel) into outp and overlays noise drawn from rgen, clamped to [0..1].
+ * An empty image renders only the noise. The noise is drawn block-wise (the generator is inherently sequential), such
+ * that the conversion of each block vectorizes.
+ */
+void render_image(
+    std::span<const uint8_t>              img,
+    std::span<float>                      outp,
+    std::uniform_real_distribution<float> noise,
+    std::mt19937                         &rgen
+);
+
 class mnist_db {
     idx_file img_data;
     idx_file label_data;
 
-    std::vector<float> norm_img_data;
 public:
     explicit mnist_db(const std::string &img_file, const std::string &label_file);
 
     void print_info() const;
 
     [[nodiscard]] std::span<const uint8_t> get_image(std::size_t idx) const;
-    [[nodiscard]] std::span<const float> get_norm_image(std::size_t idx) const;
+
+    // normalized pixel intensity in [eps..1-eps], the epsilon offset is a ROOT thing and just needed for easier
+    // visualization. the images are converted on the fly (see mnist_io), i.e., there is no float copy of the data set
+    [[nodiscard]] static constexpr float norm_pixel(uint8_t val)
+    {
+        return std::numeric_limits<float>::epsilon() +
+               static_cast<float>(val) / (255.0f + std::numeric_limits<float>::epsilon() * 2);
+    }
+
     [[nodiscard]] uint8_t get_label(std::size_t idx) const;
     [[nodiscard]] std::size_t get_image_cnt() const;
     [[nodiscard]] std::size_t get_image_size() const;
+
+    // image resolution from the idx dimensions (count, rows, columns), a single row for other layouts
+    [[nodiscard]] std::size_t get_image_width() const;
+    [[nodiscard]] std::size_t get_image_height() const;
 };
 
 } // mdb
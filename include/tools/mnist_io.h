@@ -6,12 +6,18 @@
 #define MNIST_IO_H
 
 #include <functional>
+#include <memory>
+#include <optional>
 #include <span>
 #include <string>
 #include <random>
+#include <vector>
 
+#include "augment.h"
 #include "io_entity.h"
 #include "mnist_db.h"
+#include "ordered_pool.h"
+#include "run_ahead.h"
 
 namespace sim {
 
@@ -19,36 +25,116 @@ class mnist_io : public io_entity, public mdb::mnist_db {
 
     std::function<std::span<float>()> output_mem {};
     std::size_t id;
+    io_elem_t   outp_elem;
 
-    std::size_t cur_epoch;
-    std::size_t cur_idx;
+    // everything that determines the next output (besides the change interval)
+    struct gen_state_t {
+        std::size_t  cur_epoch;
+        std::size_t  cur_idx;
+        std::size_t  ci_cnt;
+        std::mt19937 rgen;
+    };
+    gen_state_t state;
 
-    std::size_t ci_cnt;
     int change_interval;
 
-    std::mt19937 rgen;
     std::uniform_real_distribution<float> dis;
 
+    // optional run-ahead generation (see set_run_ahead), every frame carries the generator state after the frame
+    struct frame_t {
+        std::vector<float> data;
+        gen_state_t        state;
+    };
+    std::size_t                         run_ahead_depth;
+    int                                 run_ahead_interval;
+    gen_state_t                         ahead_state;       // only accessed by the producer thread while running
+    std::unique_ptr<run_ahead<frame_t>> producer;
+
+    // optional augmentation by a worker pool (see set_augmentation), image k of the pool is the augmented image of the
+    // k-th presentation after aug_base (without noise), aug_image holds the one of the current presentation. The
+    // random values are derived from the seed and the position of the presentation (see frame_seed and noise_seed)
+    using aug_pool_t = ordered_pool<std::vector<float>>;
+    mdb::augment_params_t       aug_params;
+    std::size_t                 aug_workers;
+    std::size_t                 aug_depth;
+    uint32_t                    seed;
+    gen_state_t                 aug_base;
+    std::vector<float>          aug_image;
+    bool                        aug_valid;
+    std::unique_ptr<aug_pool_t> aug_pool;
+
+    // optional noise variants (see set_noise_variants) and the sample key of the last output
+    std::size_t             noise_variants;
+    std::optional<uint64_t> last_key;
+
+    [[nodiscard]] uint64_t frame_seed(uint64_t epoch, uint64_t idx) const;
+    [[nodiscard]] uint64_t noise_seed(uint64_t epoch, uint64_t idx, uint64_t ci) const;
+
+    void generate(std::span<float> outp, gen_state_t &st, int interval) const;
+    static void advance(gen_state_t &st, int interval, std::size_t image_cnt);
+    void generate_augmented(std::span<float> outp, uint64_t seq) const;
+
+    // state that belongs to the last output (the producer may be ahead of it)
+    [[nodiscard]] const gen_state_t& cur_state() const;
+    void restart_producer();
+    void restart_aug_pool();
+
 public:
+    static constexpr std::string_view checkpoint_tag = "mnist_io";
+
     explicit mnist_io(
         std::size_t _id,
         int _change_interval,
         const std::string &img_file,
         const std::string &label_file,
-        int rnd_seed = 0
+        int rnd_seed = 0,
+        io_elem_t _outp_elem = io_elem_t::f32
     );
 
     void set_outp_func(std::function<std::span<float>()>) override;
 
+    /*
+     * generates up to depth frames ahead of the simulation on a background thread (0 generates the frames inline).
+     * The output sequence is identical to the inline generation, changes of the change interval and loaded checkpoints
+     * discard the frames generated ahead. The producer is started on the first process() call, i.e., after the
+     * entity reached its final place in the simulation environment.
+     */
+    void set_run_ahead(std::size_t depth);
+
+    /*
+     * augments every image by random shifts, rotations, elastic deformations, contrast jitter and occlusions (see
+     * mdb::augment_image) on a pool of worker threads that stay up to depth presentations ahead of the simulation (0
+     * workers disables the augmentation). The augmentation is computed once per presentation and only depends on the
+     * seed, the epoch and the image, the pixel noise is drawn for every step (seeded by the step within the change
+     * interval as well), i.e., the output is reproducible for any number of workers and continues exactly after
+     * loading a checkpoint. Takes precedence over set_run_ahead.
+     */
+    void set_augmentation(const mdb::augment_params_t &params, std::size_t workers = 4, std::size_t depth = 64);
+
+    /*
+     * restricts the noise (and augmentation) of every image to n variants, i.e., the random values of a presentation
+     * are derived from the seed, the image and the epoch modulo n instead of the sequential generator, and all steps
+     * of a presentation emit the same frame. Every output is then identified by a sample key of (image, variant) (see
+     * get_sample_key), which allows to cache the responses of frozen groups (see sim::env::freeze) in at most
+     * images * n entries. 0 restores the sequential noise.
+     */
+    void set_noise_variants(std::size_t n);
+
     void process() override;
 
     [[nodiscard]] std::size_t get_outp_id() const override;
     [[nodiscard]] std::size_t get_outp_size() const override;
+    [[nodiscard]] io_elem_t get_outp_elem_type() const override { return outp_elem; }
 
     [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return {}; };
 
+    [[nodiscard]] std::optional<uint64_t> get_sample_key() const override { return last_key; }
+
     [[nodiscard]] std::string status_str() const override;
 
+    void save_state(checkpoint_writer &cw) const override;
+    bool load_state(checkpoint_reader &cr) override;
+
     [[nodiscard]] int& get_change_interval() { return change_interval; }
 };
 
@@ -0,0 +1,68 @@
+#ifndef SIM_READOUT_H
+#define SIM_READOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace sim {
+
+/*
+ * Readouts measure how well the outputs of neuron groups separate the classes of a labeled data set. They are fitted on
+ * the feature vectors of a training set (row-major, one row of feature_cnt values per sample, e.g., the averaged
+ * activities of the neurons) and predict one label per row.
+ */
+
+// every feature (neuron) votes for the label it responds to most on average, a row is assigned to the label with the
+// highest mean activity of its voters
+class vote_readout {
+
+    std::size_t              feature_cnt {0};
+    std::size_t              label_cnt   {0};
+    std::vector<uint8_t>     assignment;     // label per feature
+    std::vector<float>       voter_weight;   // 1 / number of voters per label (0 if none)
+
+public:
+    void fit(std::span<const float> features, std::span<const uint8_t> labels, std::size_t _feature_cnt, std::size_t _label_cnt);
+
+    [[nodiscard]] uint8_t predict(std::span<const float> row) const;
+};
+
+// ridge regression onto the one-hot encoded labels (closed form, solved by a Cholesky decomposition), a row is
+// assigned to the label with the highest regression output
+class linear_readout {
+
+    std::size_t         feature_cnt {0};
+    std::size_t         label_cnt   {0};
+    std::vector<double> weights;     // (feature_cnt + 1) x label_cnt, the last row holds the bias
+
+public:
+    // the ridge penalty is relative to the mean feature energy, false if the system could not be solved
+    bool fit(
+        std::span<const float>   features,
+        std::span<const uint8_t> labels,
+        std::size_t              _feature_cnt,
+        std::size_t              _label_cnt,
+        double                   ridge = 1e-3
+    );
+
+    [[nodiscard]] uint8_t predict(std::span<const float> row) const;
+};
+
+// fraction of the rows whose prediction matches the label
+template<class R>
+[[nodiscard]] double accuracy(const R &readout, std::span<const float> features, std::span<const uint8_t> labels)
+{
+    if (labels.empty())
+        return 0.0;
+    const std::size_t feature_cnt = features.size() / labels.size();
+    std::size_t       correct     = 0;
+    for (std::size_t i = 0; i < labels.size(); ++i)
+        correct += readout.predict(features.subspan(i * feature_cnt, feature_cnt)) == labels[i];
+    return static_cast<double>(correct) / static_cast<double>(labels.size());
+}
+
+} // sim
+
+#endif //SIM_READOUT_H
@@ -0,0 +1,117 @@
+#ifndef SYNTHETIC_IO_H
+#define SYNTHETIC_IO_H
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "io_entity.h"
+
+namespace sim {
+
+struct synthetic_params_t {
+    enum class kind_t : uint8_t {
+        sparse_random,  // a new random sparse binary pattern per change interval
+        prototypes,     // one of pattern_cnt fixed sparse patterns, distorted by noise
+        moving_bars,    // a bar moving across a width x (size / width) image, random orientation and direction per sweep
+        sequences       // fixed sequences of sparse patterns, sequence k is picked with a probability ~ 1 / (k + 1)
+    };
+
+    kind_t      kind         = kind_t::prototypes;
+    std::size_t size         = 1024;   // output dimension
+    float       sparsity     = 0.05f;  // fraction of active elements per pattern (at most 0.5)
+    std::size_t pattern_cnt  = 10;     // number of prototypes or sequences
+    std::size_t sequence_len = 8;      // patterns per sequence
+    float       noise        = 0.05f;  // fraction of the active elements of a prototype moved to random positions
+    std::size_t width        = 0;      // moving bars: image width, 0 for a square image
+    std::size_t bar_width    = 2;      // moving bars: thickness of the bar
+};
+
+/*
+ * Synthetic binary input for benchmarks and soak tests that runs without any data files and scales to arbitrary input
+ * sizes. The current pattern changes every change interval (like mnist_io), the ground truth of the current output is
+ * provided by get_cur_label:
+ *     sparse_random: number of the pattern (counts up)
+ *     prototypes:    index of the prototype
+ *     moving_bars:   orientation (0 horizontal, 1 vertical)
+ *     sequences:     sequence * sequence_len + position within the sequence
+ * The fixed patterns are derived from the seed, the position and the generator are part of checkpoints. The output is
+ * binary and sparse (see get_outp_sparsity), i.e., consumers may read it as a sparse view.
+ */
+class synthetic_io : public io_entity {
+
+public:
+    using params_t = synthetic_params_t;
+    using kind_t   = synthetic_params_t::kind_t;
+
+private:
+    std::function<std::span<float>()> output_mem {};
+    std::size_t id;
+    io_elem_t   outp_elem;
+    params_t    params;
+    int         change_interval;
+
+    std::size_t                        active_cnt;
+    std::size_t                        height;
+    std::vector<std::vector<uint32_t>> patterns;   // prototypes, or the patterns of all sequences one after the other
+    std::discrete_distribution<std::size_t> seq_dist;
+
+    // current position, everything below is part of checkpoints
+    std::size_t           ci_cnt {0};
+    std::size_t           pattern_nr {0};
+    std::size_t           cur_label {0};
+    std::size_t           seq_pos {0};
+    std::size_t           bar_pos {0};
+    uint8_t               bar_vertical {0};
+    uint8_t               bar_reverse {0};
+    std::vector<uint32_t> active;                 // active elements of the current output (not used by moving bars)
+    std::mt19937          rgen;
+
+    std::vector<uint8_t>  marks;                  // scratch for the selection of distinct elements
+
+    void random_pattern(std::vector<uint32_t> &dst);
+    void distort(const std::vector<uint32_t> &src);
+    void next_pattern();
+    void render_bar(std::span<float> outp) const;
+
+public:
+    static constexpr std::string_view checkpoint_tag = "synthetic_io";
+
+    synthetic_io(
+        std::size_t _id,
+        int         _change_interval,
+        params_t    _params    = {},
+        int         rnd_seed   = 0,
+        io_elem_t   _outp_elem = io_elem_t::f32
+    );
+
+    void set_outp_func(std::function<std::span<float>()>) override;
+
+    void process() override;
+
+    [[nodiscard]] std::size_t get_outp_id() const override { return id; }
+    [[nodiscard]] std::size_t get_outp_size() const override { return params.size; }
+    [[nodiscard]] std::size_t get_outp_sparsity() const override;
+    [[nodiscard]] io_elem_t get_outp_elem_type() const override { return outp_elem; }
+
+    [[nodiscard]] std::span<const std::size_t> get_inp_ids() const override { return {}; };
+
+    [[nodiscard]] std::string status_str() const override;
+
+    void save_state(checkpoint_writer &cw) const override;
+    bool load_state(checkpoint_reader &cr) override;
+
+    [[nodiscard]] std::size_t get_cur_label() const { return cur_label; }
+
+    // number of distinct labels, 0 for random patterns
+    [[nodiscard]] std::size_t get_label_cnt() const;
+
+    [[nodiscard]] int& get_change_interval() { return change_interval; }
+};
+
+} // sim
+
+#endif //SYNTHETIC_IO_H
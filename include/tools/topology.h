@@ -0,0 +1,178 @@
+#ifndef SIM_TOPOLOGY_H
+#define SIM_TOPOLOGY_H
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "augment.h"
+#include "external_input.h"
+#include "hd_ngm2_neuron_group.h"
+#include "idx_stream_io.h"
+#include "output_tap.h"
+#include "recorder.h"
+#include "replay.h"
+#include "sim_env.h"
+#include "synthetic_io.h"
+
+namespace sim {
+
+/*
+ * Declarative description of a simulation network. A topology file (JSON) lists the entities of the simulation and
+ * their connections. Shared parameter sets ("presets") are parsed once and referenced by name, every entity may
+ * override single values of its preset. Neuron group parameters start from the defaults of ngm2::basic_cng, i.e., a
+ * group without any overrides is identical to the respective basic_cng call.
+ *
+ *     {
+ *       "threads": 2,
+ *       "presets": {
+ *         "cortical": { "branch_interval": 5000, "dendrite": { "max_branch_level": 2 } }
+ *       },
+ *       "entities": [
+ *         { "type": "mnist_io",     "id": 0, "change_interval": 15, "run_ahead": 64,
+ *           "image_file": "$mnist_images", "label_file": "$mnist_labels" },
+ *         { "type": "neuron_group", "id": 1, "preset": "cortical", "neurons": 50, "input_size": 784, "inputs": [0], "seed": 1025 },
+ *         { "type": "neuron_group", "id": 2, "preset": "cortical", "neurons": 50, "input_size": 100, "inputs": [1, 3],
+ *           "input_delays": { "3": 1 }, "seed": 2025 }
+ *       ]
+ *     }
+ *
+ * Entities that do not need to run at the input rate may declare "clock_divider" and "clock_phase" (see
+ * env::set_clock). Every entity may declare "output_precision" ("f32" (default), "f16" or "u8") to store its output buffer with reduced
+ * precision (see io_elem.h).
+ * Neuron groups with "k_winners" only publish their k most active neurons. Groups that declare "sparse_inputs": true
+ * compute their responses from the sparse views of such inputs, which is faster and equal to the dense response up
+ * to rounding (see ngm2::dendrite_t::get_sparse_segment_activity).
+ * mnist_io entities may declare an "augment" object ("shift", "rotation", "elastic_alpha", "elastic_sigma", "contrast",
+ * "occlusion", "occlusion_size", "workers", "depth") to augment the images on a worker pool (see mnist_io.h).
+ * Data sets that do not fit into memory are read by "idx_stream" entities (like mnist_io plus "chunk_size", "window"
+ * and "shuffle", see idx_stream_io.h).
+ * Benchmarks and soak tests run without data files on "synthetic" entities ("kind": "random" | "prototypes" | "bars" |
+ * "sequences", "size", "sparsity", "patterns", "sequence_len", "noise", "width", "bar_width", see synthetic_io.h).
+ * Host applications that embed the simulation feed it through "external_input" entities ("size", "queue_depth",
+ * "on_empty": "block" | "zero" | "repeat") and read it through "output_tap" entities ("inputs", "input_size",
+ * "queue_depth", "input_delays"), see external_input.h and output_tap.h.
+ * "recorder" entities ("inputs", "file", "precision": "native" | "f32" | "f16" | "u8", "compress", "keyframe_interval",
+ * "queue_depth") append the outputs of their inputs to an activity log (see recorder.h and activity_log.h).
+ * "replay" entities ("file", "stream", "loop") serve a recorded stream under their id (see replay.h), e.g., to train upper
+ * groups without the entities below them.
+ * mnist_io entities with "noise_variants" draw the noise of every image from a fixed number of variants, which allows
+ * the layer-wise training of upper groups: "freeze": { "source", "entities", "precision": "native" | "f32" | "f16" | "u8",
+ * "max_mb" } freezes the given entities and caches their outputs per sample of the source (see env::freeze).
+ * "huge_pages": true backs the large model arrays with transparent huge pages, the arrays of the entities are taken
+ * from an arena of the env (see env::use_huge_page_arena and sim_alloc.h).
+ * String values starting with '$' are replaced by the variables handed to compile_topology (e.g., file names given on
+ * the command line). The topology is compiled into a plan before any entity is constructed: entities are ordered by
+ * id, connections are validated, the storage for the entities is reserved and the entities are partitioned onto
+ * "threads" partitions (longest processing time first, based on the estimated number of synapses).
+ */
+struct topology_plan_t {
+
+    struct mnist_io_cfg_t {
+        std::size_t id;
+        int         change_interval;
+        std::string image_file;
+        std::string label_file;
+        int         random_seed;
+        io_elem_t   outp_elem;
+        std::size_t run_ahead;   // frames generated ahead on a background thread (see mnist_io::set_run_ahead)
+        mdb::augment_params_t augment;
+        std::size_t           augment_workers; // 0 disables the augmentation (see mnist_io::set_augmentation)
+        std::size_t           augment_depth;
+        std::size_t           noise_variants;  // 0 keeps the sequential noise (see mnist_io::set_noise_variants)
+    };
+
+    struct idx_stream_cfg_t {
+        std::size_t         id;
+        int                 change_interval;
+        std::string         image_file;
+        std::string         label_file;
+        int                 random_seed;
+        io_elem_t           outp_elem;
+        idx_stream_params_t params;
+    };
+
+    struct synthetic_cfg_t {
+        std::size_t        id;
+        int                change_interval;
+        synthetic_params_t params;
+        int                random_seed;
+        io_elem_t          outp_elem;
+    };
+
+    struct external_input_cfg_t {
+        std::size_t                    id;
+        std::size_t                    size;
+        std::size_t                    queue_depth;
+        external_input::empty_policy_t on_empty;
+        io_elem_t                      outp_elem;
+    };
+
+    struct output_tap_cfg_t {
+        std::size_t                       id;
+        std::vector<std::size_t>          inp_ids;
+        std::size_t                       input_size;
+        std::size_t                       queue_depth;
+        std::map<std::size_t,std::size_t> inp_delays;
+    };
+
+    struct recorder_cfg_t {
+        std::size_t              id;
+        std::vector<std::size_t> inp_ids;
+        std::string              file_name;
+        recorder_params_t        params;
+    };
+
+    struct replay_cfg_t {
+        std::size_t                id;
+        std::string                file_name;
+        bool                       loop;
+        std::optional<std::size_t> stream_id;
+    };
+
+    struct freeze_cfg_t {
+        std::size_t              source;
+        std::vector<std::size_t> ids;
+        freeze_params_t          params;
+    };
+
+    struct entity_info_t {
+        std::size_t              id;
+        std::vector<std::size_t> inp_ids;
+        std::size_t              input_size; // 0 if unknown before construction
+        double                   cost;       // estimated cost per step (amortized over the clock divider)
+        std::size_t              clock_divider;
+        std::size_t              clock_phase;
+    };
+
+    // deterministic order, sorted by id
+    std::vector<mnist_io_cfg_t>                    mnist_ios;
+    std::vector<idx_stream_cfg_t>                  idx_streams;
+    std::vector<synthetic_cfg_t>                   synthetics;
+    std::vector<external_input_cfg_t>              external_inputs;
+    std::vector<output_tap_cfg_t>                  output_taps;
+    std::vector<recorder_cfg_t>                    recorders;
+    std::vector<replay_cfg_t>                      replays;
+    std::vector<ngm2::neuron_group_t::params_t>    neuron_groups;
+    std::vector<entity_info_t>                     entities;
+    std::vector<std::vector<std::size_t>>          partitions;
+    bool                                           huge_pages {false};
+    std::optional<freeze_cfg_t>                    freeze;
+};
+
+[[nodiscard]] std::optional<topology_plan_t> compile_topology(
+    const std::string                        &file_name,
+    const std::map<std::string,std::string>  &vars = {}
+);
+
+/*
+ * constructs all entities of the plan in the given (empty) environment, validates the input sizes against the actual
+ * output sizes, initializes the io buffers and sets the schedule. The plan is consumed, i.e., parameters are moved.
+ */
+[[nodiscard]] bool instantiate_topology(env &sim_env, topology_plan_t &&plan);
+
+} // sim
+
+#endif //SIM_TOPOLOGY_H
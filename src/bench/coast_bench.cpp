@@ -0,0 +1,753 @@
+/*
+ * Micro benchmarks of the hot paths of the hd_ngm2 model and the simulation core.
+ * All inputs are synthetic and seeded, hence results are comparable across runs and can be tracked over time
+ * via the JSON output.
+ *
+ * usage: coast_bench [--json <file>] [--filter <substring>] [--min-time <seconds>] [--quick] [--huge-pages]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define COAST_BENCH_PERF
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "hd_ngm2.h"
+#include "io_buffer.h"
+#include "sim_alloc.h"
+#include "synthetic_io.h"
+
+using namespace ngm2;
+
+namespace {
+
+// sink that keeps the compiler from optimizing away the benchmarked computations
+volatile float bench_sink = 0.0f;
+
+struct bench_cfg_t {
+    std::string filter;
+    std::string json_file;
+    double      min_time = 0.25; // seconds per benchmark
+    bool        quick    = false;
+};
+
+struct bench_result_t {
+    std::string                                  name;
+    std::vector<std::pair<std::string,double>>  params;
+    double                                       ns_per_call       = 0.0;
+    std::size_t                                  synapses          = 0;
+    double                                       bytes_per_synapse = 0.0;
+    double                                       dtlb_misses       = -1.0; // per call, negative if not measured
+
+    [[nodiscard]] double calls_per_sec()  const { return 1e9 / ns_per_call; }
+    [[nodiscard]] double ns_per_synapse() const { return synapses > 0 ? ns_per_call / static_cast<double>(synapses) : 0.0; }
+};
+
+/*
+ * runs func in batches of growing size until the accumulated run time exceeds the configured minimum time and
+ * returns the average time per call in nanoseconds
+ */
+double measure(const bench_cfg_t &cfg, const std::function<void()> &func)
+{
+    using clock = std::chrono::steady_clock;
+    func(); // warm up caches and lazily allocated memory
+
+    std::size_t batch   = 1;
+    std::size_t calls   = 0;
+    double      elapsed = 0.0;
+    while (elapsed < cfg.min_time) {
+        const auto start = clock::now();
+        for (std::size_t i = 0; i < batch; ++i)
+            func();
+        elapsed += std::chrono::duration<double>(clock::now() - start).count();
+        calls   += batch;
+        batch   *= 2;
+    }
+    return elapsed * 1e9 / static_cast<double>(calls);
+}
+
+/*
+ * Counts the data TLB read misses of the calling thread via perf_event_open. Not available on non Linux systems or if
+ * the kernel does not allow it (e.g., perf_event_paranoid > 2 or in containers), in which case read_misses returns a
+ * negative value.
+ */
+class dtlb_counter {
+    int fd = -1;
+public:
+    dtlb_counter()
+    {
+#if defined(COAST_BENCH_PERF)
+        perf_event_attr attr {};
+        attr.type           = PERF_TYPE_HW_CACHE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_DTLB
+                            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+
+    ~dtlb_counter()
+    {
+#if defined(COAST_BENCH_PERF)
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    dtlb_counter(const dtlb_counter&)            = delete;
+    dtlb_counter& operator=(const dtlb_counter&) = delete;
+
+    [[nodiscard]] bool available() const { return fd >= 0; }
+
+    // average misses per call of func over the given number of calls
+    double read_misses([[maybe_unused]] const std::function<void()> &func, [[maybe_unused]] std::size_t calls)
+    {
+#if defined(COAST_BENCH_PERF)
+        if (fd < 0)
+            return -1.0;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        for (std::size_t i = 0; i < calls; ++i)
+            func();
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t cnt = 0;
+        if (read(fd, &cnt, sizeof(cnt)) != sizeof(cnt))
+            return -1.0;
+        return static_cast<double>(cnt) / static_cast<double>(calls);
+#else
+        return -1.0;
+#endif
+    }
+};
+
+/*
+ * fills an input vector with an MNIST-like signal: a minority of strong components on top of a 5% noise floor
+ */
+void fill_input(std::span<float> inp, std::mt19937 &rgen)
+{
+    std::uniform_real_distribution<float> noise(0.0f, 0.05f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (auto &val : inp) {
+        val = unit(rgen) < 0.2f ? std::clamp(unit(rgen) + noise(rgen), 0.0f, 1.0f) : noise(rgen);
+    }
+}
+
+/*
+ * fills an input vector with a k-winners like signal: a fraction of active components, all others exactly zero
+ */
+void fill_sparse_input(std::span<float> inp, std::mt19937 &rgen, float active_fraction)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (auto &val : inp) {
+        val = unit(rgen) < active_fraction ? 0.1f + 0.9f * unit(rgen) : 0.0f;
+    }
+}
+
+/*
+ * fills the write slot of an io_buffer with a synthetic input and publishes it
+ */
+void publish_input(sim::io_buffer &buf, std::mt19937 &rgen)
+{
+    fill_input(buf.cur_write_buffer(), rgen);
+    buf.swap_buffer();
+}
+
+// parameterization of a dendrite that matches the defaults of basic_cng (see hd_ngm2_cfg.h)
+dendrite_t::params_t dendrite_params(std::size_t input_size, uint8_t max_branch_level, int rnd_seed)
+{
+    dendrite_t::params_t dp {};
+    dp.type                            = dendrite_t::type_t::proximal;
+    dp.input_size                      = input_size;
+    dp.input_ids                       = {0};
+    dp.permanence_threshold            = 0.3f;
+    dp.max_branch_level                = max_branch_level;
+    dp.rnd_seed                        = rnd_seed;
+    dp.default_primary_learning_rate   = 0.01f;
+    dp.default_secondary_learning_rate = 0.0001f;
+    dp.default_mismatch_act_thres      = 0.8f;
+    dp.default_mismatch_smoothing      = 0.001f;
+    dp.default_accumulated_theta_thres = 2.0f;
+    dp.default_min_mismatch_deviation  = 1.0f;
+    dp.default_min_mismatch_percentage = 0.002f;
+    return dp;
+}
+
+/*
+ * Forces a dendrite to grow to the given branch level. Mismatch values are collected aggressively and the branching
+ * thresholds are lowered such that every synapse splits, i.e., a dendrite with N inputs ends up with N * 2^level
+ * synapses. The runtime parameters are restored afterward.
+ */
+void grow_to_level(dendrite_t &dendrite, sim::io_buffer &inp, std::mt19937 &rgen, uint8_t level)
+{
+    const float smoothing = dendrite.get_mismatch_smoothing();
+    const float theta     = dendrite.get_accumulated_theta_thres();
+    const float deviation = dendrite.get_min_mismatch_deviation();
+    const float percent   = dendrite.get_min_mismatch_percentage();
+
+    dendrite.set_mismatch_smoothing(0.5f);
+    dendrite.set_accumulated_theta_thres(0.0f);
+    dendrite.set_min_mismatch_deviation(-1e6f);
+    dendrite.set_min_mismatch_percentage(0.0f);
+
+    for (uint8_t l = 0; l < level; ++l) {
+        for (int i = 0; i < 4; ++i) {
+            publish_input(inp, rgen);
+            dendrite.adapt_synapses(dendrite.get_response(), 1.0f);
+        }
+        dendrite.adapt_branches();
+    }
+
+    dendrite.set_mismatch_smoothing(smoothing);
+    dendrite.set_accumulated_theta_thres(theta);
+    dendrite.set_min_mismatch_deviation(deviation);
+    dendrite.set_min_mismatch_percentage(percent);
+}
+
+// memory held by the synapse SOA and segment arrays of a dendrite, including unused capacity
+std::size_t dendrite_bytes(const dendrite_t &dendrite)
+{
+    const auto &syn = dendrite.get_synapses();
+    return syn.permanence.capacity()    * sizeof(float)                +
+           syn.mismatch.capacity()      * sizeof(float)                +
+           syn.adapt_history.capacity() * sizeof(float)                +
+           syn.segment_idx.capacity()   * sizeof(dendrite_t::seg_id_t) +
+           syn.input_inc.capacity()     * sizeof(uint8_t)              +
+           2 * (dendrite.get_max_segment_idx() + 1) * sizeof(float);
+}
+
+/*
+ * benchmark bodies
+ */
+void bench_dendrite(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    const std::vector<std::size_t> input_sizes   = cfg.quick ? std::vector<std::size_t>{100, 784, 4096} : std::vector<std::size_t>{100, 256, 784, 2048, 4096};
+    const std::vector<uint8_t>     branch_levels = cfg.quick ? std::vector<uint8_t>{0, 2, 4}            : std::vector<uint8_t>{0, 1, 2, 3, 4};
+
+    for (const std::size_t input_size : input_sizes) {
+        for (const uint8_t level : branch_levels) {
+            std::mt19937   rgen(static_cast<int>(input_size * 10 + level));
+            sim::io_buffer inp(input_size);
+            dendrite_t     dendrite(dendrite_params(input_size, level, 42));
+            dendrite.set_inp_func(0, inp.inp_buffer_func());
+            grow_to_level(dendrite, inp, rgen, level);
+            publish_input(inp, rgen);
+
+            const std::size_t syn_cnt   = dendrite.get_synapse_count();
+            const double      syn_bytes = static_cast<double>(dendrite_bytes(dendrite)) / static_cast<double>(syn_cnt);
+            const std::vector<std::pair<std::string,double>> params {
+                {"input_size", static_cast<double>(input_size)}, {"branch_level", static_cast<double>(level)}
+            };
+
+            if (std::string name = "dendrite.get_response"; name.contains(cfg.filter)) {
+                const double ns = measure(cfg, [&] { bench_sink = dendrite.get_response(); });
+                results.push_back({name, params, ns, syn_cnt, syn_bytes});
+            }
+
+            if (std::string name = "dendrite.adapt_synapses"; name.contains(cfg.filter)) {
+                const float max_act = std::max(dendrite.get_response(), 0.1f);
+                const double ns = measure(cfg, [&] { dendrite.adapt_synapses(max_act, 0.01f); });
+                results.push_back({name, params, ns, syn_cnt, syn_bytes});
+            }
+
+            // with default thresholds the branch check rarely triggers an actual split, i.e., this measures the
+            // regular check that each neuron performs every branch interval
+            if (std::string name = "dendrite.adapt_branches.check"; name.contains(cfg.filter)) {
+                const double ns = measure(cfg, [&] { dendrite.adapt_branches(); });
+                results.push_back({name, params, ns, dendrite.get_synapse_count(), syn_bytes});
+            }
+
+            // response to a k-winners like input (2% active) consumed densely vs. as sparse list
+            for (const bool sparse : {false, true}) {
+                const std::string name = sparse ? "dendrite.get_response.sparse_input" : "dendrite.get_response.sparse_input_dense";
+                if (!name.contains(cfg.filter))
+                    continue;
+                sim::io_buffer sp_inp(input_size);
+                fill_sparse_input(sp_inp.cur_write_buffer(), rgen, 0.02f);
+                sp_inp.swap_buffer();
+                dendrite_t sp_dendrite = dendrite;
+                sp_dendrite.set_inp_func(0, sp_inp.inp_buffer_func());
+                if (sparse)
+                    sp_dendrite.set_sparse_inp_func(0, sp_inp.sparse_inp_func());
+                const double ns = measure(cfg, [&] { bench_sink = sp_dendrite.get_response(); });
+                results.push_back({name, params, ns, sp_dendrite.get_synapse_count(), syn_bytes});
+            }
+
+            // response to an input buffer stored with reduced precision (see io_elem.h)
+            for (const auto elem : {sim::io_elem_t::f16, sim::io_elem_t::u8}) {
+                const std::string name = elem == sim::io_elem_t::f16 ? "dendrite.get_response.f16_input" : "dendrite.get_response.u8_input";
+                if (!name.contains(cfg.filter))
+                    continue;
+                sim::io_buffer q_inp(input_size, 2, elem);
+                publish_input(q_inp, rgen);
+                dendrite_t q_dendrite = dendrite;
+                q_dendrite.set_inp_func(0, q_inp.inp_buffer_func());
+                const double ns = measure(cfg, [&] { bench_sink = q_dendrite.get_response(); });
+                results.push_back({name, params, ns, q_dendrite.get_synapse_count(), syn_bytes});
+            }
+        }
+    }
+
+    // cost of an actual split of every synapse of an unbranched dendrite
+    if (std::string name = "dendrite.adapt_branches.split"; name.contains(cfg.filter)) {
+        for (const std::size_t input_size : input_sizes) {
+            std::mt19937   rgen(static_cast<int>(input_size));
+            sim::io_buffer inp(input_size);
+            dendrite_t     proto(dendrite_params(input_size, 1, 42));
+            proto.set_inp_func(0, inp.inp_buffer_func());
+            for (int i = 0; i < 4; ++i) {
+                publish_input(inp, rgen);
+                proto.adapt_synapses(proto.get_response(), 1.0f);
+            }
+            proto.set_accumulated_theta_thres(0.0f);
+            proto.set_min_mismatch_deviation(-1e6f);
+            proto.set_min_mismatch_percentage(0.0f);
+
+            // the prototype is copied outside the timed region for every split
+            using clock = std::chrono::steady_clock;
+            double      elapsed = 0.0;
+            std::size_t calls   = 0;
+            std::size_t syn_cnt = 0;
+            while (elapsed < cfg.min_time) {
+                dendrite_t dendrite = proto;
+                const auto start = clock::now();
+                dendrite.adapt_branches();
+                elapsed += std::chrono::duration<double>(clock::now() - start).count();
+                syn_cnt  = dendrite.get_synapse_count();
+                ++calls;
+            }
+            results.push_back({
+                name,
+                {{"input_size", static_cast<double>(input_size)}, {"branch_level", 1.0}},
+                elapsed * 1e9 / static_cast<double>(calls),
+                syn_cnt,
+                0.0
+            });
+        }
+    }
+}
+
+void bench_neuron_group(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    const std::string name = "neuron_group.process";
+    if (!name.contains(cfg.filter))
+        return;
+
+    constexpr std::size_t input_size = 100;
+    const std::vector<std::size_t> neuron_counts = cfg.quick ? std::vector<std::size_t>{10, 100, 1000} : std::vector<std::size_t>{10, 100, 1000, 10000};
+
+    for (const std::size_t neuron_cnt : neuron_counts) {
+        std::mt19937   rgen(static_cast<int>(neuron_cnt));
+        sim::io_buffer inp(input_size);
+        sim::io_buffer outp(neuron_cnt);
+
+        neuron_group_t group(basic_cng(1, neuron_cnt, input_size, {0}, 1025));
+        group.set_outp_func(outp.outp_buffer_func());
+        group.set_inp_func(0, inp.inp_buffer_func());
+        publish_input(inp, rgen);
+
+        std::size_t syn_cnt = 0;
+        std::size_t bytes   = 0;
+        for (std::size_t ni = 0; ni < group.get_neuron_count(); ++ni) {
+            const auto &neuron = group.get_neuron(ni);
+            for (std::size_t di = 0; di < neuron.get_dendrite_count(); ++di) {
+                syn_cnt += neuron.get_dendrite(di).get_synapse_count();
+                bytes   += dendrite_bytes(neuron.get_dendrite(di));
+            }
+        }
+
+        // the input is not changed between steps to keep input generation out of the measurement
+        const double ns = measure(cfg, [&] { group.process(); outp.swap_buffer(); });
+        results.push_back({
+            name,
+            {{"neurons", static_cast<double>(neuron_cnt)}, {"input_size", static_cast<double>(input_size)}},
+            ns,
+            syn_cnt,
+            static_cast<double>(bytes) / static_cast<double>(syn_cnt)
+        });
+    }
+}
+
+/*
+ * many small groups processed one after another (virtual process()) vs. as one batch (neuron_group_t::process_all)
+ */
+void bench_neuron_group_batch(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    constexpr std::size_t input_size = 100;
+    constexpr std::size_t neuron_cnt = 10;
+    const std::vector<std::size_t> group_counts = cfg.quick ? std::vector<std::size_t>{10, 100} : std::vector<std::size_t>{10, 100, 1000};
+
+    for (const bool batched : {false, true}) {
+        const std::string name = batched ? "neuron_group.process_all" : "neuron_group.process_each";
+        if (!name.contains(cfg.filter))
+            continue;
+
+        for (const std::size_t group_cnt : group_counts) {
+            std::mt19937                rgen(static_cast<int>(group_cnt));
+            sim::io_buffer              inp(input_size);
+            std::vector<sim::io_buffer> outps;
+            std::vector<neuron_group_t> groups;
+            outps.reserve(group_cnt);
+            groups.reserve(group_cnt);
+            for (std::size_t gi = 0; gi < group_cnt; ++gi) {
+                auto &group = groups.emplace_back(basic_cng(gi + 1, neuron_cnt, input_size, {0}, static_cast<int>(1025 + gi)));
+                group.set_outp_func(outps.emplace_back(neuron_cnt).outp_buffer_func());
+                group.set_inp_func(0, inp.inp_buffer_func());
+            }
+            publish_input(inp, rgen);
+
+            std::size_t syn_cnt = 0;
+            for (const auto &group : groups)
+                syn_cnt += group.get_synapse_count();
+
+            const double ns = measure(cfg, [&] {
+                if (batched) {
+                    neuron_group_t::process_all(groups);
+                } else {
+                    for (sim::io_entity &group : groups)
+                        group.process();
+                }
+                for (auto &outp : outps)
+                    outp.swap_buffer();
+            });
+            results.push_back({
+                name,
+                {{"groups", static_cast<double>(group_cnt)}, {"neurons", static_cast<double>(neuron_cnt)}},
+                ns,
+                syn_cnt,
+                0.0
+            });
+        }
+    }
+}
+
+void bench_local_inhibition(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    const std::string name = "local_inhibition";
+    if (!name.contains(cfg.filter))
+        return;
+
+    for (const std::size_t size : {10, 100, 1000, 10000}) {
+        std::mt19937       rgen(static_cast<int>(size));
+        std::vector<float> proto(size);
+        std::vector<float> vec(size);
+        fill_input(proto, rgen);
+
+        // local inhibition operates in place, hence we restore the input before every call
+        const double ns = measure(cfg, [&] {
+            std::ranges::copy(proto, vec.begin());
+            local_inhibition(vec, 5.0f);
+            bench_sink = vec[0];
+        });
+        results.push_back({name, {{"size", static_cast<double>(size)}}, ns, 0, 0.0});
+    }
+}
+
+void bench_io_buffer(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    const std::string name = "io_buffer.swap_buffer";
+    if (!name.contains(cfg.filter))
+        return;
+
+    // elem: 0 = f32, 1 = f16, 2 = u8 (see io_elem.h), reduced precision buffers encode the staging slot on swap
+    for (const std::size_t size : {100, 784, 4096, 16384}) {
+        for (const auto elem : {sim::io_elem_t::f32, sim::io_elem_t::f16, sim::io_elem_t::u8}) {
+            std::mt19937   rgen(static_cast<int>(size));
+            sim::io_buffer buf(size, 2, elem);
+            fill_input(buf.cur_write_buffer(), rgen);
+            buf.swap_buffer();
+            fill_input(buf.cur_write_buffer(), rgen);
+
+            const double ns = measure(cfg, [&] { buf.swap_buffer(); });
+            results.push_back({name, {{"size", static_cast<double>(size)}, {"elem", static_cast<double>(elem)}}, ns, 0, 0.0});
+        }
+    }
+}
+
+void bench_synthetic_io(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    const std::string name = "synthetic_io.process";
+    if (!name.contains(cfg.filter))
+        return;
+
+    // kind: 0 = sparse_random, 1 = prototypes, 2 = moving_bars, 3 = sequences, a new pattern in every step
+    using kind_t = sim::synthetic_params_t::kind_t;
+    for (const std::size_t size : {1024, 16384, 65536}) {
+        for (const auto kind : {kind_t::sparse_random, kind_t::prototypes, kind_t::moving_bars, kind_t::sequences}) {
+            sim::synthetic_params_t params;
+            params.kind = kind;
+            params.size = size;
+            sim::synthetic_io  io(0, 1, params, 42);
+            std::vector<float> outp(size);
+            io.set_outp_func([&outp] { return std::span<float>(outp); });
+
+            const double ns = measure(cfg, [&] {
+                io.process();
+                bench_sink = outp[0];
+            });
+            results.push_back({name, {{"size", static_cast<double>(size)}, {"kind", static_cast<double>(kind)}}, ns, 0, 0.0});
+        }
+    }
+}
+
+/*
+ * Sweeps over synapse-like SOA arrays of a large model with the different allocation schemes of sim_alloc.h:
+ * alloc 0 = std::allocator, 1 = aligned_allocator, 2 = aligned_allocator with transparent huge pages, 3 = arena with
+ * hugetlbfs backing (falls back to transparent huge pages without a hugetlbfs pool). The sweep is the memory access
+ * pattern of dendrite_t::get_response (sequential permanences and segment indices, input gathered by index), the
+ * gather reads one random element per 4 kB page of the permanences, i.e., it is bound by TLB misses.
+ */
+template<class Vec>
+struct alloc_arrays_t {
+    Vec permanence;
+    Vec mismatch;
+    std::vector<uint32_t, typename std::allocator_traits<typename Vec::allocator_type>::template rebind_alloc<uint32_t>> input_idx;
+
+    explicit alloc_arrays_t(std::size_t syn_cnt, std::size_t input_size, std::mt19937 &rgen) :
+        permanence(syn_cnt), mismatch(syn_cnt), input_idx(syn_cnt)
+    {
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::uniform_int_distribution<uint32_t> inp_dist(0, static_cast<uint32_t>(input_size - 1));
+        for (std::size_t i = 0; i < syn_cnt; ++i) {
+            permanence[i] = unit(rgen);
+            mismatch[i]   = unit(rgen);
+            input_idx[i]  = inp_dist(rgen);
+        }
+    }
+};
+
+template<class Vec>
+void bench_alloc_arrays(
+    const bench_cfg_t &cfg, std::vector<bench_result_t> &results, dtlb_counter &tlb,
+    std::size_t syn_cnt, double alloc
+){
+    constexpr std::size_t input_size = 4096;
+    std::mt19937       rgen(static_cast<int>(syn_cnt));
+    std::vector<float> inp(input_size);
+    fill_input(inp, rgen);
+    alloc_arrays_t<Vec> arrays(syn_cnt, input_size, rgen);
+
+    // page-strided random offsets, the same for all allocation schemes
+    constexpr std::size_t page_floats = 4096 / sizeof(float);
+    std::vector<std::size_t> offsets(syn_cnt / page_floats);
+    std::uniform_int_distribution<std::size_t> off_dist(0, syn_cnt - 1);
+    std::ranges::generate(offsets, [&] { return off_dist(rgen); });
+
+    const std::vector<std::pair<std::string,double>> params {
+        {"synapses", static_cast<double>(syn_cnt)}, {"alloc", alloc}
+    };
+    const double bytes = static_cast<double>(sizeof(float) * 2 + sizeof(uint32_t));
+
+    if (std::string name = "alloc.sweep"; name.contains(cfg.filter)) {
+        const auto sweep = [&] {
+            float sum = 0.0f;
+            for (std::size_t i = 0; i < syn_cnt; ++i)
+                sum += (arrays.permanence[i] > 0.3f ? inp[arrays.input_idx[i]] : 0.0f) * arrays.mismatch[i];
+            bench_sink = sum;
+        };
+        bench_result_t res {name, params, measure(cfg, sweep), syn_cnt, bytes};
+        res.dtlb_misses = tlb.read_misses(sweep, 4);
+        results.push_back(std::move(res));
+    }
+
+    if (std::string name = "alloc.gather"; name.contains(cfg.filter)) {
+        const auto gather = [&] {
+            float sum = 0.0f;
+            for (const auto off : offsets)
+                sum += arrays.permanence[off];
+            bench_sink = sum;
+        };
+        bench_result_t res {name, params, measure(cfg, gather), offsets.size(), bytes};
+        res.dtlb_misses = tlb.read_misses(gather, 4);
+        results.push_back(std::move(res));
+    }
+}
+
+/*
+ * Sweeps over the arrays of many dendrite sized models (784 inputs, 4 synapses per input), each far below
+ * huge_page_size: alloc 2 = aligned_allocator with transparent huge pages enabled (which does not apply to arrays of
+ * this size), 4 = arena with transparent huge pages as used by env::use_huge_page_arena.
+ */
+template<class Vec>
+void bench_alloc_dendrites(
+    const bench_cfg_t &cfg, std::vector<bench_result_t> &results, dtlb_counter &tlb,
+    std::size_t dendrite_cnt, double alloc
+){
+    constexpr std::size_t input_size = 784;
+    constexpr std::size_t syn_cnt    = input_size * 4;
+    std::mt19937       rgen(static_cast<int>(dendrite_cnt));
+    std::vector<float> inp(input_size);
+    fill_input(inp, rgen);
+    std::vector<alloc_arrays_t<Vec>> dendrites;
+    dendrites.reserve(dendrite_cnt);
+    for (std::size_t d = 0; d < dendrite_cnt; ++d)
+        dendrites.emplace_back(syn_cnt, input_size, rgen);
+
+    if (std::string name = "alloc.dendrite_sweep"; name.contains(cfg.filter)) {
+        const auto sweep = [&] {
+            float sum = 0.0f;
+            for (const auto &arrays : dendrites)
+                for (std::size_t i = 0; i < syn_cnt; ++i)
+                    sum += (arrays.permanence[i] > 0.3f ? inp[arrays.input_idx[i]] : 0.0f) * arrays.mismatch[i];
+            bench_sink = sum;
+        };
+        const std::vector<std::pair<std::string,double>> params {
+            {"synapses", static_cast<double>(syn_cnt * dendrite_cnt)}, {"dendrites", static_cast<double>(dendrite_cnt)},
+            {"alloc", alloc}
+        };
+        bench_result_t res {name, params, measure(cfg, sweep), syn_cnt * dendrite_cnt,
+                            static_cast<double>(sizeof(float) * 2 + sizeof(uint32_t))};
+        res.dtlb_misses = tlb.read_misses(sweep, 4);
+        results.push_back(std::move(res));
+    }
+}
+
+void bench_alloc(const bench_cfg_t &cfg, std::vector<bench_result_t> &results)
+{
+    if (!std::string{"alloc.sweep"}.contains(cfg.filter) && !std::string{"alloc.gather"}.contains(cfg.filter) &&
+        !std::string{"alloc.dendrite_sweep"}.contains(cfg.filter))
+        return;
+
+    dtlb_counter tlb;
+    if (!tlb.available())
+        std::fprintf(stderr, "dTLB miss counter not available (perf_event_open failed), only timings are reported\n");
+
+    const bool huge_pages = sim::huge_pages_enabled();
+    // 16M synapses ~ 192 MB of SOA arrays, i.e., far beyond the reach of the 4 kB TLB entries
+    const std::vector<std::size_t> syn_counts = cfg.quick ? std::vector<std::size_t>{std::size_t{1} << 24}
+                                                          : std::vector<std::size_t>{std::size_t{1} << 22, std::size_t{1} << 24};
+    for (const std::size_t syn_cnt : syn_counts) {
+        bench_alloc_arrays<std::vector<float>>(cfg, results, tlb, syn_cnt, 0);
+
+        sim::set_huge_pages(false);
+        bench_alloc_arrays<sim::aligned_vector<float>>(cfg, results, tlb, syn_cnt, 1);
+
+        sim::set_huge_pages(true);
+        bench_alloc_arrays<sim::aligned_vector<float>>(cfg, results, tlb, syn_cnt, 2);
+
+        sim::arena       arena(std::size_t{64} << 20, true);
+        sim::arena_scope scope(arena);
+        bench_alloc_arrays<sim::aligned_vector<float>>(cfg, results, tlb, syn_cnt, 3);
+    }
+
+    // 4096 dendrites ~ 12.8M synapses
+    const std::size_t dendrite_cnt = cfg.quick ? 1024 : 4096;
+    sim::set_huge_pages(true);
+    bench_alloc_dendrites<sim::aligned_vector<float>>(cfg, results, tlb, dendrite_cnt, 2);
+    {
+        sim::arena       arena;
+        sim::arena_scope scope(arena);
+        bench_alloc_dendrites<sim::aligned_vector<float>>(cfg, results, tlb, dendrite_cnt, 4);
+    }
+    sim::set_huge_pages(huge_pages);
+}
+
+/*
+ * reporting
+ */
+std::string params_str(const bench_result_t &res)
+{
+    std::string str;
+    for (const auto &[key, val] : res.params) {
+        str += (str.empty() ? "" : " ") + key + "=" + std::to_string(static_cast<long long>(val));
+    }
+    return str;
+}
+
+void print_results(const std::vector<bench_result_t> &results)
+{
+    std::printf("%-32s %-34s %14s %14s %10s %12s %10s %12s\n",
+        "benchmark", "params", "ns/call", "calls/s", "synapses", "ns/synapse", "B/synapse", "dTLB/call");
+    for (const auto &res : results) {
+        std::printf("%-32s %-34s %14.1f %14.1f %10zu %12.3f %10.2f ",
+            res.name.c_str(), params_str(res).c_str(),
+            res.ns_per_call, res.calls_per_sec(), res.synapses, res.ns_per_synapse(), res.bytes_per_synapse);
+        if (res.dtlb_misses >= 0.0)
+            std::printf("%12.1f\n", res.dtlb_misses);
+        else
+            std::printf("%12s\n", "-");
+    }
+}
+
+bool write_json(const std::string &file_name, const std::vector<bench_result_t> &results)
+{
+    std::FILE *file = std::fopen(file_name.c_str(), "w");
+    if (!file) {
+        std::fprintf(stderr, "could not open %s for writing\n", file_name.c_str());
+        return false;
+    }
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+    std::fprintf(file, "{\n  \"timestamp\": %lld,\n  \"benchmarks\": [\n", static_cast<long long>(now.count()));
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto &res = results[i];
+        std::fprintf(file, "    {\"name\": \"%s\", \"params\": {", res.name.c_str());
+        for (std::size_t pi = 0; pi < res.params.size(); ++pi) {
+            std::fprintf(file, "%s\"%s\": %g", pi > 0 ? ", " : "", res.params[pi].first.c_str(), res.params[pi].second);
+        }
+        std::fprintf(file,
+            "}, \"ns_per_call\": %.3f, \"calls_per_sec\": %.3f, \"synapses\": %zu, \"ns_per_synapse\": %.5f, \"bytes_per_synapse\": %.3f",
+            res.ns_per_call, res.calls_per_sec(), res.synapses, res.ns_per_synapse(), res.bytes_per_synapse);
+        if (res.dtlb_misses >= 0.0)
+            std::fprintf(file, ", \"dtlb_misses_per_call\": %.1f", res.dtlb_misses);
+        std::fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    std::fclose(file);
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    bench_cfg_t cfg;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg { argv[i] };
+        if (arg == "--json" && i + 1 < argc) {
+            cfg.json_file = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            cfg.filter = argv[++i];
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            cfg.min_time = std::stod(argv[++i]);
+        } else if (arg == "--quick") {
+            cfg.quick = true;
+        } else if (arg == "--huge-pages") {
+            sim::set_huge_pages(true);
+        } else {
+            std::printf("usage: %s [--json <file>] [--filter <substring>] [--min-time <seconds>] [--quick] [--huge-pages]\n", argv[0]);
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+
+    std::vector<bench_result_t> results;
+    bench_dendrite(cfg, results);
+    bench_neuron_group(cfg, results);
+    bench_neuron_group_batch(cfg, results);
+    bench_local_inhibition(cfg, results);
+    bench_io_buffer(cfg, results);
+    bench_synthetic_io(cfg, results);
+    bench_alloc(cfg, results);
+
+    print_results(results);
+
+    if (!cfg.json_file.empty() && !write_json(cfg.json_file, results))
+        return -1;
+
+    return 0;
+}
@@ -0,0 +1,307 @@
+/*
+ * Consistency checks of the model and the simulation core that are too slow or too stateful for assertions. All
+ * inputs are synthetic and seeded. Every check prints one line, the exit code is non-zero if any check failed.
+ *
+ * usage: coast_check [--filter <substring>]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <oneapi/tbb/global_control.h>
+#include <oneapi/tbb/task_arena.h>
+
+#include "hd_ngm2.h"
+#include "io_buffer.h"
+#include "sim_env.h"
+#include "synthetic_io.h"
+
+using namespace ngm2;
+
+namespace {
+
+struct check_t {
+    std::string           name;
+    std::function<bool()> func;
+};
+
+void run_steps(sim::env &env, std::size_t steps)
+{
+    for (std::size_t i = 0; i < steps; ++i) {
+        env.process();
+        env.swap_io();
+    }
+}
+
+/*
+ * A delta checkpoint only contains the synapse arrays of dendrites whose synapses changed. After a full checkpoint,
+ * steps of frozen (non-learning) groups must not mark any synapses as changed, i.e., the delta has to be smaller than
+ * the full checkpoint by at least the permanence, mismatch and history arrays, while a delta after learning steps is
+ * not.
+ */
+bool check_delta_checkpoint_without_learning()
+{
+    constexpr std::size_t input_size = 256;
+
+    sim::synthetic_params_t sp;
+    sp.size = input_size;
+
+    sim::env env;
+    env.emplace_back<sim::synthetic_io>(0, 5, sp, 7);
+    env.emplace_back<neuron_group_t>(basic_cng(1, 10, input_size, {0}, 1025));
+    env.init_io_buffers();
+    auto &group = env.get_entities<neuron_group_t>().value()->at(0);
+
+    run_steps(env, 50);
+
+    const auto dir       = std::filesystem::temp_directory_path();
+    const auto full_file = (dir / "coast_check_full.ckpt").string();
+    const auto frz_file  = (dir / "coast_check_frozen.ckpt").string();
+    const auto lrn_file  = (dir / "coast_check_learning.ckpt").string();
+
+    bool ok = env.save_checkpoint(full_file);
+
+    group.set_frozen(true);
+    run_steps(env, 20);
+    ok = ok && env.save_delta_checkpoint(frz_file);
+
+    group.set_frozen(false);
+    run_steps(env, 20);
+    ok = ok && env.save_delta_checkpoint(lrn_file);
+
+    if (ok) {
+        const auto syn_bytes  = group.get_synapse_count() * 3 * sizeof(float);
+        const auto full_size  = std::filesystem::file_size(full_file);
+        const auto frz_size   = std::filesystem::file_size(frz_file);
+        const auto lrn_size   = std::filesystem::file_size(lrn_file);
+        std::printf("    full %zu bytes, delta after frozen steps %zu bytes, delta after learning steps %zu bytes\n",
+            static_cast<std::size_t>(full_size), static_cast<std::size_t>(frz_size), static_cast<std::size_t>(lrn_size));
+        ok = frz_size + syn_bytes <= full_size && lrn_size + syn_bytes > full_size;
+    }
+
+    std::filesystem::remove(full_file);
+    std::filesystem::remove(frz_file);
+    std::filesystem::remove(lrn_file);
+    return ok;
+}
+
+/*
+ * A truncated checkpoint has to be rejected before any state is restored: the state written after the failed load has
+ * to equal the state written before it (apart from the random chain IDs in front of the records).
+ */
+bool check_truncated_checkpoint_rejected()
+{
+    constexpr std::size_t input_size = 256;
+
+    sim::synthetic_params_t sp;
+    sp.size = input_size;
+
+    sim::env env;
+    env.emplace_back<sim::synthetic_io>(0, 5, sp, 7);
+    env.emplace_back<neuron_group_t>(basic_cng(1, 10, input_size, {0}, 1025));
+    env.init_io_buffers();
+
+    const auto dir        = std::filesystem::temp_directory_path();
+    const auto old_file   = (dir / "coast_check_old.ckpt").string();
+    const auto trunc_file = (dir / "coast_check_truncated.ckpt").string();
+    const auto pre_file   = (dir / "coast_check_pre.ckpt").string();
+    const auto post_file  = (dir / "coast_check_post.ckpt").string();
+
+    run_steps(env, 20);
+    bool ok = env.save_checkpoint(old_file);
+    run_steps(env, 20);
+    ok = ok && env.save_checkpoint(pre_file);
+
+    // cut the old checkpoint within its last record
+    if (ok) {
+        std::filesystem::copy_file(old_file, trunc_file, std::filesystem::copy_options::overwrite_existing);
+        std::filesystem::resize_file(trunc_file, std::filesystem::file_size(old_file) - 16);
+        ok = !env.load_checkpoint(trunc_file);
+    }
+    ok = ok && env.save_checkpoint(post_file);
+
+    if (ok) {
+        const auto read_records = [](const std::string &file_name) {
+            std::ifstream is(file_name, std::ios::binary);
+            std::string data { std::istreambuf_iterator<char>(is), {} };
+            return data.substr(std::min(data.size(), sizeof(sim::checkpoint_header_t) + sizeof(sim::checkpoint_chain_t)));
+        };
+        ok = read_records(pre_file) == read_records(post_file);
+    }
+
+    for (const auto &file : {old_file, trunc_file, pre_file, post_file})
+        std::filesystem::remove(file);
+    return ok;
+}
+
+/*
+ * The sparse response kernel (opt-in, see neuron_group_t::params_t::sparse_inputs) has to produce the same segment
+ * activities as the dense sweep (up to rounding), for inputs with and without zeros. Both kernels start from copies of
+ * the same trained and branched dendrite and keep learning and branching on the same inputs, i.e., the penalties
+ * tracked during adaptation and the random draws have to stay in step as well.
+ */
+bool check_sparse_segment_activity()
+{
+    constexpr std::size_t input_size = 256;
+    constexpr int         steps      = 300;
+
+    auto dp = basic_cng(1, 1, input_size, {0}, 42).neuron_params[0].dendrite_params[0];
+    dp.input_ids = {0};
+
+    std::mt19937                          rgen(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    sim::io_buffer                        inp(input_size);
+    // inactive elements are exactly zero without a noise floor, otherwise strictly positive
+    const auto fill = [&](float active_fraction, float floor) {
+        for (auto &val : inp.cur_write_buffer())
+            val = unit(rgen) < active_fraction ? 0.1f + 0.9f * unit(rgen) : floor * (0.02f + unit(rgen));
+        inp.swap_buffer();
+    };
+    const auto setup = [&](dendrite_t &d) {
+        d.set_inp_func(0, inp.inp_buffer_func());
+        d.set_accumulated_theta_thres(0.0f);
+        d.set_min_mismatch_deviation(-1e6f);
+        d.set_min_mismatch_percentage(0.0f);
+    };
+
+    // train and branch the dendrite such that the segments have differing synapses and permanences
+    dendrite_t proto(dp);
+    setup(proto);
+    for (int i = 0; i < 200; ++i) {
+        fill(0.2f, 0.05f);
+        proto.adapt_synapses(proto.get_response(), 1.0f);
+        if (i % 50 == 49)
+            proto.adapt_branches();
+    }
+
+    dendrite_t dense  = proto;
+    dendrite_t sparse = proto;
+    setup(dense);
+    setup(sparse);
+    sparse.set_sparse_inp_func(0, inp.sparse_inp_func());
+
+    // largest segment deviation, alternating inputs with and without zeros
+    float  max_dev = 0.0f;
+    double act_sum = 0.0;
+    for (int i = 0; i < steps; ++i) {
+        const bool no_zeros = i % 2 == 0;
+        fill(no_zeros ? 0.2f : 0.05f, no_zeros ? 0.05f : 0.0f);
+
+        const float dense_max  = dense.get_response();
+        const float sparse_max = sparse.get_response();
+        const auto  dense_act  = dense.get_segment_activity();
+        const auto  sparse_act = sparse.get_segment_activity();
+        for (std::size_t si = 0; si < dense_act.size(); ++si) {
+            max_dev  = std::max(max_dev, std::abs(dense_act[si] - sparse_act[si]));
+            act_sum += dense_act[si];
+        }
+        dense.adapt_synapses(dense_max, 1.0f);
+        sparse.adapt_synapses(sparse_max, 1.0f);
+        if (i == steps / 2) {
+            dense.adapt_branches();
+            sparse.adapt_branches();
+        }
+    }
+    std::printf("    %zu segments, %zu vs %zu synapses, mean activity %.4f, max deviation %g\n",
+        static_cast<std::size_t>(dense.get_max_segment_idx()), dense.get_synapse_count(), sparse.get_synapse_count(),
+        act_sum / (steps * static_cast<double>(dense.get_max_segment_idx() + 1)), static_cast<double>(max_dev));
+    return max_dev < 1e-4f && dense.get_synapse_count() == sparse.get_synapse_count();
+}
+
+/*
+ * Without a schedule, all neuron groups of an environment are processed as one batch (neuron_group_t::process_all).
+ * The batch has to produce the same outputs as processing each group on its own (single partition schedule), also if
+ * the parallel loops of the batch run on several worker threads.
+ */
+bool check_batch_matches_single()
+{
+    constexpr std::size_t input_size = 128;
+    constexpr std::size_t group_cnt  = 4;
+    constexpr int         steps      = 40;
+
+    sim::synthetic_params_t sp;
+    sp.size = input_size;
+
+    const auto build = [&](sim::env &env) {
+        env.emplace_back<sim::synthetic_io>(0, 5, sp, 11);
+        for (std::size_t gi = 0; gi < group_cnt; ++gi)
+            env.emplace_back<neuron_group_t>(basic_cng(gi + 1, 8 + gi, input_size, {0}, static_cast<int>(100 + gi)));
+        env.init_io_buffers();
+    };
+    sim::env batch;
+    sim::env single;
+    build(batch);
+    build(single);
+    single.set_schedule({ { 0, 1, 2, 3, 4 } });
+
+    std::vector<float> batch_out;
+    std::vector<float> single_out;
+    float max_dev = 0.0f;
+    // more workers than cores on small machines, the batch has to be split across threads
+    const tbb::global_control workers(tbb::global_control::max_allowed_parallelism, 4);
+    tbb::task_arena           arena(4);
+    arena.execute([&] {
+        for (int i = 0; i < steps; ++i) {
+            run_steps(batch, 1);
+            run_steps(single, 1);
+            for (std::size_t id = 1; id <= group_cnt; ++id) {
+                const auto batch_view  = batch.get_io_buffer(id).value()->cur_read_buffer();
+                const auto single_view = single.get_io_buffer(id).value()->cur_read_buffer();
+                batch_out.resize(sim::io_span_size(batch_view));
+                single_out.resize(sim::io_span_size(single_view));
+                sim::decode_into(batch_view, batch_out);
+                sim::decode_into(single_view, single_out);
+                if (batch_out.size() != single_out.size()) {
+                    max_dev = std::numeric_limits<float>::infinity();
+                    continue;
+                }
+                for (std::size_t ni = 0; ni < batch_out.size(); ++ni)
+                    max_dev = std::max(max_dev, std::abs(batch_out[ni] - single_out[ni]));
+            }
+        }
+    });
+    std::printf("    %zu groups, %d steps, max deviation %g\n", group_cnt, steps, static_cast<double>(max_dev));
+    return max_dev == 0.0f;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg { argv[i] };
+        if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::printf("usage: %s [--filter <substring>]\n", argv[0]);
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+
+    const std::vector<check_t> checks {
+        { "checkpoint.delta_without_learning", check_delta_checkpoint_without_learning },
+        { "checkpoint.truncated_rejected",     check_truncated_checkpoint_rejected     },
+        { "dendrite.sparse_segment_activity",  check_sparse_segment_activity           },
+        { "neuron_group.batch_matches_single", check_batch_matches_single              }
+    };
+
+    std::size_t failed = 0;
+    for (const auto &[name, func] : checks) {
+        if (!name.contains(filter))
+            continue;
+        const bool ok = func();
+        std::printf("%s %s\n", ok ? "PASS" : "FAIL", name.c_str());
+        failed += ok ? 0 : 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+/*
+ * Headless evaluation of a trained network. The network (the built-in one of coast or a topology file) is restored
+ * from a checkpoint (optionally followed by its delta checkpoints) into one simulation environment per thread, all
+ * neuron groups are frozen (see ngm2::neuron_group_t::set_frozen) and the mnist input is replaced by an
+ * external_input. Every sample of the training and the test set is presented for a number of steps, the outputs of the
+ * selected groups are averaged over the steps after the network settled and form the feature vector of the sample. The
+ * samples are split into one contiguous range per environment, i.e., the feature extraction runs in parallel across
+ * cores. A voting and a linear readout (see readout.h) are fitted on the training features and the accuracy on both
+ * sets is reported per group and for all selected groups together.
+ *
+ * usage: coast_eval <train images> <train labels> <test images> <test labels> <checkpoint> [<delta checkpoint> ...]
+ *                   [--topology <file>] [--groups <id,id,...>] [--threads <n>] [--train-samples <n>]
+ *                   [--test-samples <n>] [--present <steps>] [--settle <steps>] [--noise <amplitude>]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <latch>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "external_input.h"
+#include "hd_ngm2.h"
+#include "mnist_db.h"
+#include "readout.h"
+#include "sim_env.h"
+#include "topology.h"
+
+using namespace ngm2;
+
+namespace {
+
+struct eval_cfg_t {
+    std::string              train_images;
+    std::string              train_labels;
+    std::string              test_images;
+    std::string              test_labels;
+    std::vector<std::string> checkpoint_files; // snapshot followed by its deltas (see sim::env::load_checkpoints)
+    std::string              topology_file;
+    std::vector<std::size_t> group_ids;      // all neuron groups if empty
+    std::size_t              threads       = std::max(std::thread::hardware_concurrency(), 1u);
+    std::size_t              train_samples = 10000;
+    std::size_t              test_samples  = 0;   // 0 evaluates the full test set
+    std::size_t              present       = 15;  // steps per sample (the change interval of the training)
+    std::size_t              settle        = 5;   // steps at the beginning of a presentation that are not averaged
+    float                    noise         = 0.05f;
+};
+
+/*
+ * sets up the network in the given (empty) environment and restores it from the checkpoints. The mnist inputs of a
+ * topology are replaced by external inputs of the same id, recorders and the layer freezing of the topology are dropped.
+ */
+bool build_network(sim::env &env, const eval_cfg_t &cfg, std::size_t image_size)
+{
+    if (cfg.topology_file.empty()) {
+        env.emplace_back<sim::external_input>(0, image_size, 1, sim::external_input::empty_policy_t::zero);
+        env.emplace_back<neuron_group_t>( basic_cng(1, 50, 28*28,  {0}, 1025) );
+        env.emplace_back<neuron_group_t>( basic_cng(2, 50, 100,{1,3}, 2025) );
+        env.emplace_back<neuron_group_t>( basic_cng(3, 50, 100,{1,2}, 3025) );
+        env.init_io_buffers();
+    } else {
+        auto plan = sim::compile_topology(
+            cfg.topology_file,
+            { {"mnist_images", cfg.train_images}, {"mnist_labels", cfg.train_labels} }
+        );
+        if (!plan)
+            return false;
+        for (const auto &io_cfg : plan->mnist_ios)
+            plan->external_inputs.push_back({ io_cfg.id, image_size, 1, sim::external_input::empty_policy_t::zero, io_cfg.outp_elem });
+        plan->mnist_ios.clear();
+        std::ranges::sort(plan->external_inputs, {}, [](const auto &ext) { return ext.id; });
+        for (const auto &rec : plan->recorders)
+            std::erase_if(plan->entities, [&](const auto &ent) { return ent.id == rec.id; });
+        plan->recorders.clear();
+        plan->partitions.clear(); // the environments already run in parallel
+        plan->freeze.reset();
+        if (!sim::instantiate_topology(env, std::move(*plan)))
+            return false;
+    }
+
+    if (!env.load_checkpoints(cfg.checkpoint_files))
+        return false;
+
+    const auto groups = env.get_entities<neuron_group_t>();
+    if (!groups || !env.get_entities<sim::external_input>()) {
+        std::fprintf(stderr, "the network needs an mnist input and at least one neuron group\n");
+        return false;
+    }
+    for (auto &group : *groups.value())
+        group.set_frozen(true);
+    return true;
+}
+
+// ids of the evaluated groups and the offsets of their outputs within a feature vector (one more than groups)
+struct feature_layout_t {
+    std::vector<std::size_t> ids;
+    std::vector<std::size_t> offsets;
+
+    [[nodiscard]] std::size_t size() const { return offsets.back(); }
+};
+
+/*
+ * presents the first sample_cnt images of the data set to the environments (one contiguous range each) and writes the
+ * averaged group outputs into features, returns the samples per second
+ */
+double extract_features(
+    std::vector<std::unique_ptr<sim::env>> &envs,
+    const eval_cfg_t                       &cfg,
+    const feature_layout_t                 &layout,
+    const mdb::mnist_db                    &db,
+    std::size_t                            sample_cnt,
+    std::span<float>                       features
+){
+    const std::size_t feature_cnt = layout.size();
+    const std::size_t chunk       = (sample_cnt + envs.size() - 1) / envs.size();
+    const float       avg_weight  = 1.0f / static_cast<float>(cfg.present - cfg.settle);
+
+    std::latch ready(static_cast<std::ptrdiff_t>(envs.size()) + 1);
+    std::vector<std::jthread> workers;
+    for (std::size_t w = 0; w < envs.size(); ++w) {
+        workers.emplace_back([&, w] {
+            sim::env &env = *envs[w];
+            auto     &inp = env.get_entities<sim::external_input>().value()->front();
+            std::vector<sim::io_buffer*> buffers;
+            for (const auto id : layout.ids)
+                buffers.push_back(env.get_io_buffer(id).value());
+            std::vector<float> outp;
+            ready.arrive_and_wait();
+
+            const std::size_t end = std::min(sample_cnt, (w + 1) * chunk);
+            for (std::size_t sample = w * chunk; sample < end; ++sample) {
+                // the noise of a sample does not depend on the number of threads
+                std::mt19937 rgen(static_cast<uint32_t>(sample * 2654435761u + 1));
+                const std::uniform_real_distribution<float> noise(0.0f, cfg.noise);
+                auto row = features.subspan(sample * feature_cnt, feature_cnt);
+                std::ranges::fill(row, 0.0f);
+
+                for (std::size_t step = 0; step < cfg.present; ++step) {
+                    mdb::render_image(db.get_image(sample), inp.write_span(), noise, rgen);
+                    env.process();
+                    env.swap_io();
+                    if (step < cfg.settle)
+                        continue;
+                    for (std::size_t g = 0; g < buffers.size(); ++g) {
+                        const auto view = buffers[g]->cur_read_buffer();
+                        outp.resize(sim::io_span_size(view));
+                        sim::decode_into(view, outp);
+                        for (std::size_t i = 0; i < outp.size(); ++i)
+                            row[layout.offsets[g] + i] += outp[i] * avg_weight;
+                    }
+                }
+            }
+        });
+    }
+
+    ready.arrive_and_wait();
+    const auto start = std::chrono::steady_clock::now();
+    workers.clear(); // joins
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(sample_cnt) / elapsed;
+}
+
+// columns [begin, end) of a row-major feature matrix
+std::vector<float> select_columns(std::span<const float> features, std::size_t feature_cnt, std::size_t begin, std::size_t end)
+{
+    const std::size_t rows = features.size() / feature_cnt;
+    std::vector<float> result(rows * (end - begin));
+    for (std::size_t r = 0; r < rows; ++r)
+        std::copy(features.begin() + r * feature_cnt + begin, features.begin() + r * feature_cnt + end, result.begin() + r * (end - begin));
+    return result;
+}
+
+std::vector<std::size_t> parse_ids(const std::string &list)
+{
+    std::vector<std::size_t> ids;
+    for (std::size_t pos = 0; pos < list.size(); ) {
+        const std::size_t next = std::min(list.find(',', pos), list.size());
+        ids.push_back(std::stoul(list.substr(pos, next - pos)));
+        pos = next + 1;
+    }
+    return ids;
+}
+
+void print_usage(const char *name)
+{
+    std::printf("usage: %s <train images> <train labels> <test images> <test labels> <checkpoint> [<delta checkpoint> ...]\n", name);
+    std::printf("       [--topology <file>] [--groups <id,id,...>] [--threads <n>] [--train-samples <n>]\n");
+    std::printf("       [--test-samples <n>] [--present <steps>] [--settle <steps>] [--noise <amplitude>]\n");
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 6) {
+        print_usage(argv[0]);
+        return -1;
+    }
+    eval_cfg_t cfg;
+    cfg.train_images    = argv[1];
+    cfg.train_labels    = argv[2];
+    cfg.test_images     = argv[3];
+    cfg.test_labels     = argv[4];
+    cfg.checkpoint_files.emplace_back(argv[5]);
+    for (int i = 6; i < argc; ++i) {
+        const std::string arg { argv[i] };
+        if (!arg.starts_with("--")) {
+            cfg.checkpoint_files.push_back(arg);
+        } else if (arg == "--topology" && i + 1 < argc) {
+            cfg.topology_file = argv[++i];
+        } else if (arg == "--groups" && i + 1 < argc) {
+            cfg.group_ids = parse_ids(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            cfg.threads = std::max<std::size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--train-samples" && i + 1 < argc) {
+            cfg.train_samples = std::stoul(argv[++i]);
+        } else if (arg == "--test-samples" && i + 1 < argc) {
+            cfg.test_samples = std::stoul(argv[++i]);
+        } else if (arg == "--present" && i + 1 < argc) {
+            cfg.present = std::stoul(argv[++i]);
+        } else if (arg == "--settle" && i + 1 < argc) {
+            cfg.settle = std::stoul(argv[++i]);
+        } else if (arg == "--noise" && i + 1 < argc) {
+            cfg.noise = std::stof(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" ? 0 : -1;
+        }
+    }
+    if (cfg.settle >= cfg.present) {
+        std::fprintf(stderr, "the presentation has to be longer than the settling time\n");
+        return -1;
+    }
+
+    const mdb::mnist_db train_db(cfg.train_images, cfg.train_labels);
+    const mdb::mnist_db test_db(cfg.test_images, cfg.test_labels);
+    if (train_db.get_image_size() != test_db.get_image_size()) {
+        std::fprintf(stderr, "training and test images differ in size\n");
+        return -1;
+    }
+    const std::size_t train_cnt = std::min(cfg.train_samples, train_db.get_image_cnt());
+    const std::size_t test_cnt  = cfg.test_samples > 0 ? std::min(cfg.test_samples, test_db.get_image_cnt()) : test_db.get_image_cnt();
+    if (train_cnt == 0 || test_cnt == 0) {
+        std::fprintf(stderr, "the training and the test set must not be empty\n");
+        return -1;
+    }
+
+    // one environment per thread, restored in parallel
+    std::vector<std::unique_ptr<sim::env>> envs(std::min(cfg.threads, std::max(train_cnt, test_cnt)));
+    std::atomic<bool> failed {false};
+    {
+        std::vector<std::jthread> builders;
+        for (auto &env : envs)
+            builders.emplace_back([&] {
+                env = std::make_unique<sim::env>();
+                if (!build_network(*env, cfg, train_db.get_image_size()))
+                    failed = true;
+            });
+    }
+    if (failed || envs.empty()) {
+        std::fprintf(stderr, "could not restore the network from %s\n", cfg.checkpoint_files.back().c_str());
+        return -1;
+    }
+
+    feature_layout_t layout { {}, {0} };
+    if (cfg.group_ids.empty())
+        for (const auto &group : *envs.front()->get_entities<neuron_group_t>().value())
+            cfg.group_ids.push_back(group.get_outp_id());
+    for (const auto id : cfg.group_ids) {
+        const auto buf = envs.front()->get_io_buffer(id);
+        if (!buf) {
+            std::fprintf(stderr, "unknown group %zu\n", id);
+            return -1;
+        }
+        layout.ids.push_back(id);
+        layout.offsets.push_back(layout.offsets.back() + buf.value()->size());
+    }
+
+    const std::size_t feature_cnt = layout.size();
+    std::vector<float> train_features(train_cnt * feature_cnt);
+    std::vector<float> test_features(test_cnt * feature_cnt);
+    std::vector<uint8_t> train_labels(train_cnt);
+    std::vector<uint8_t> test_labels(test_cnt);
+    for (std::size_t i = 0; i < train_cnt; ++i)
+        train_labels[i] = train_db.get_label(i);
+    for (std::size_t i = 0; i < test_cnt; ++i)
+        test_labels[i] = test_db.get_label(i);
+    const std::size_t label_cnt = std::max(*std::ranges::max_element(train_labels), *std::ranges::max_element(test_labels)) + 1u;
+
+    const double train_rate = extract_features(envs, cfg, layout, train_db, train_cnt, train_features);
+    const double test_rate  = extract_features(envs, cfg, layout, test_db, test_cnt, test_features);
+    std::printf("%zu training and %zu test samples, %zu threads, %zu steps per sample\n", train_cnt, test_cnt, envs.size(), cfg.present);
+    std::printf("feature extraction: %.1f samples/s (training), %.1f samples/s (test)\n\n", train_rate, test_rate);
+
+    // readouts per group and for all groups together
+    std::printf("%-12s %10s %12s %12s %14s %14s\n", "groups", "features", "vote train", "vote test", "linear train", "linear test");
+    for (std::size_t g = 0; g <= layout.ids.size(); ++g) {
+        const bool        all   = g == layout.ids.size();
+        const std::size_t begin = all ? 0 : layout.offsets[g];
+        const std::size_t end   = all ? feature_cnt : layout.offsets[g + 1];
+        if (all && layout.ids.size() == 1)
+            break;
+        const auto train = select_columns(train_features, feature_cnt, begin, end);
+        const auto test  = select_columns(test_features, feature_cnt, begin, end);
+
+        sim::vote_readout vote;
+        vote.fit(train, train_labels, end - begin, label_cnt);
+        sim::linear_readout linear;
+        const bool linear_ok = linear.fit(train, train_labels, end - begin, label_cnt);
+
+        const std::string name = all ? "all" : std::to_string(layout.ids[g]);
+        std::printf("%-12s %10zu %12.4f %12.4f %14.4f %14.4f\n",
+            name.c_str(), end - begin,
+            sim::accuracy(vote, train, train_labels), sim::accuracy(vote, test, test_labels),
+            linear_ok ? sim::accuracy(linear, train, train_labels) : 0.0,
+            linear_ok ? sim::accuracy(linear, test, test_labels) : 0.0);
+    }
+    return 0;
+}
@@ -3,119 +3,265 @@
 //
 #include <cmath>
 #include <algorithm>
-#include <iterator>
+#include <execution>
+#include <limits>
+#include <numeric>
 
 #include "fbgd.h"
 
 namespace coast {
 
-constexpr fbgd::cell_id_t fbgd::pos_to_cell(const std::array<float, 2> &pos)
+constexpr fbgd::cell_id_t fbgd::pos_to_cell(float x, float y)
 {
     //constexpr float cell_cnt = std::ceil(region_size / cell_size);
     const float cell_cnt = std::ceil(region_size / cell_size);
+    // nodes outside of the region are assigned to the closest border cell
     const float cell_id =
-        std::floor(pos[0] / cell_size) +
-        std::floor(pos[1] / cell_size) * cell_cnt;
-    return static_cast<cell_id_t>(std::clamp(cell_id,0.0f,cell_cnt*cell_cnt));
+        std::clamp(std::floor(x / cell_size), 0.0f, cell_cnt - 1.0f) +
+        std::clamp(std::floor(y / cell_size), 0.0f, cell_cnt - 1.0f) * cell_cnt;
+    return static_cast<cell_id_t>(cell_id);
 }
 
-void fbgd::rebuild_cell_and_node_look_up()
+void fbgd::rebuild_grid()
 {
-    if (!nodes_dirty) return;
-
-    if (nodes.empty()) {
-        nodes_dirty = false;
-        return;
-    }
-
-    std::ranges::sort(
-        nodes,
-        [](const auto &a, const auto &b) {
-            return a.cell_id < b.cell_id;
-        }
-    );
-
     //constexpr auto cell_cnt = static_cast<uint32_t>(std::ceil(region_size / cell_size));
     const auto cell_cnt = static_cast<uint32_t>(std::ceil(region_size / cell_size));
-    cell_look_up.resize( cell_cnt * cell_cnt);
-    std::ranges::fill(cell_look_up, std::make_pair(nodes.end(), nodes.end()) );
-    cell_id_t cur_id = nodes[0].cell_id;
-    auto cur_start = nodes.begin();
-    for (std::size_t idx = 1; idx < nodes.size(); ++idx) {
-        if (nodes[idx].cell_id != cur_id) {
-            auto cur_end = nodes.begin();
-            std::advance(cur_end, idx);
-            cell_look_up[cur_id] = std::make_pair(cur_start,cur_end);
-            cur_start = cur_end;
-            cur_id = nodes[idx].cell_id;
-        }
-    }
-    cell_look_up[cur_id] = std::make_pair(cur_start,nodes.end());
-    nodes_dirty = false;
+    const std::size_t node_cnt = pos_x.size();
 
-    node_look_up.resize( next_node_id );
-    std::size_t node_cnt = nodes.size();
+    // counting sort of the positions by cell
+    node_cell.resize(node_cnt);
+    cell_start.assign(cell_cnt * cell_cnt + 1, 0);
     for (std::size_t idx = 0; idx < node_cnt; ++idx) {
-        node_look_up[nodes[idx].node_id] = idx;
+        node_cell[idx] = pos_to_cell(pos_x[idx], pos_y[idx]);
+        ++cell_start[node_cell[idx] + 1];
     }
+    std::partial_sum(cell_start.begin(), cell_start.end(), cell_start.begin());
 
+    cell_fill.assign(cell_start.begin(), cell_start.end() - 1);
+    cell_x.resize(node_cnt);
+    cell_y.resize(node_cnt);
+    for (std::size_t idx = 0; idx < node_cnt; ++idx) {
+        const uint32_t slot = cell_fill[node_cell[idx]]++;
+        cell_x[slot] = pos_x[idx];
+        cell_y[slot] = pos_y[idx];
+    }
 }
 
 void fbgd::rebuild_edge_look_up()
 {
     if (!edges_dirty) return;
 
-    if (edges.empty()) {
-        edges_dirty = false;
+    const std::size_t node_cnt = pos_x.size();
+
+    // adjacency in compressed rows, sorted per node
+    adj_start.assign(node_cnt + 1, 0);
+    for (const auto &e : edges)
+        ++adj_start[e.from + 1];
+    std::partial_sum(adj_start.begin(), adj_start.end(), adj_start.begin());
+    adj.resize(edges.size());
+    std::vector<uint32_t> fill(adj_start.begin(), adj_start.end() - 1);
+    for (const auto &e : edges)
+        adj[fill[e.from]++] = e.to;
+    for (std::size_t idx = 0; idx < node_cnt; ++idx)
+        std::sort(adj.begin() + adj_start[idx], adj.begin() + adj_start[idx + 1]);
+
+    // siblings: neighbors of all neighbors without the node itself and its direct neighbors
+    sib_start.assign(node_cnt + 1, 0);
+    sib.clear();
+    std::vector<node_id_t> cand;
+    for (std::size_t idx = 0; idx < node_cnt; ++idx) {
+        const auto nb_begin = adj.begin() + adj_start[idx];
+        const auto nb_end   = adj.begin() + adj_start[idx + 1];
+        cand.clear();
+        for (auto nb = nb_begin; nb != nb_end; ++nb)
+            for (uint32_t k = adj_start[*nb]; k < adj_start[*nb + 1]; ++k)
+                if (adj[k] != idx && !std::binary_search(nb_begin, nb_end, adj[k]))
+                    cand.push_back(adj[k]);
+        std::ranges::sort(cand);
+        const auto last = std::unique(cand.begin(), cand.end());
+        sib.insert(sib.end(), cand.begin(), last);
+        sib_start[idx + 1] = static_cast<uint32_t>(sib.size());
+    }
+
+    edges_dirty = false;
+}
+
+float fbgd::local_push(float dist)
+{
+    // nodes closer than local_size push each other away much stronger
+    return dist < local_size ? 5000.0f * (1.0f - (dist / local_size)) : 1.0f;
+}
+
+/*
+ * pushes of cnt contiguous positions on the point (px,py). The loop is branch free so that the compiler can vectorize
+ * it, a node at the point itself (e.g., the node whose forces are computed) contributes a zero delta and thus no force.
+ */
+void fbgd::accumulate_push(const float *xs, const float *ys, std::size_t cnt, float px, float py, float c2,
+                           std::array<float,2> &force)
+{
+    constexpr float min_dist = 0.0000001f;
+
+    float fx = 0.0f;
+    float fy = 0.0f;
+    for (std::size_t i = 0; i < cnt; ++i) {
+        const float dx   = px - xs[i];
+        const float dy   = py - ys[i];
+        const float dist = std::sqrt(std::max(min_dist, dx * dx + dy * dy));
+        const float f    = c2 * local_push(dist) / dist;
+        fx += dx * f;
+        fy += dy * f;
+    }
+    force[0] += fx;
+    force[1] += fy;
+}
+
+std::array<float,2> fbgd::grid_repulsion(node_id_t id, float c2) const
+{
+    //constexpr auto cell_cnt = static_cast<int>(std::ceil(region_size / cell_size));
+    const auto cell_cnt = static_cast<int>(std::ceil(region_size / cell_size));
+
+    std::array<float,2> force {0.0f, 0.0f};
+    const int center_x = static_cast<int>(node_cell[id]) % cell_cnt;
+    const int center_y = static_cast<int>(node_cell[id]) / cell_cnt;
+    for (int nb_y = std::max(center_y - 1, 0); nb_y <= std::min(center_y + 1, cell_cnt - 1); ++nb_y) {
+        // the cells of a row of the neighborhood are one contiguous range of the sorted positions
+        const int      row   = nb_y * cell_cnt;
+        const uint32_t begin = cell_start[row + std::max(center_x - 1, 0)];
+        const uint32_t end   = cell_start[row + std::min(center_x + 1, cell_cnt - 1) + 1];
+        accumulate_push(cell_x.data() + begin, cell_y.data() + begin, end - begin, pos_x[id], pos_y[id], c2, force);
+    }
+    return force;
+}
+
+void fbgd::build_quadtree()
+{
+    quads.clear();
+    quad_order.resize(pos_x.size());
+    std::iota(quad_order.begin(), quad_order.end(), 0u);
+    if (pos_x.empty())
         return;
+
+    // square bounding box of all nodes (nodes may leave the region)
+    const auto [min_x, max_x] = std::ranges::minmax(pos_x);
+    const auto [min_y, max_y] = std::ranges::minmax(pos_y);
+    const float size = std::max(max_x - min_x, max_y - min_y) * 1.0001f + std::numeric_limits<float>::min();
+    build_quad(0, static_cast<uint32_t>(pos_x.size()), {min_x, min_y}, size, 0);
+
+    quad_x.resize(quad_order.size());
+    quad_y.resize(quad_order.size());
+    for (std::size_t i = 0; i < quad_order.size(); ++i) {
+        quad_x[i] = pos_x[quad_order[i]];
+        quad_y[i] = pos_y[quad_order[i]];
     }
+}
 
-    std::ranges::sort(
-        edges,
-        [](const auto &a, const auto &b) {
-            if (a.from < b.from)
-                return true;
-            if (a.from > b.from)
-                return false;
-            return a.to < b.to;
+void fbgd::build_quad(uint32_t begin, uint32_t end, std::array<float,2> lo, float size, std::size_t depth)
+{
+    const auto q = static_cast<uint32_t>(quads.size());
+    std::array<float,2> com {0.0f, 0.0f};
+    for (uint32_t i = begin; i < end; ++i) {
+        com[0] += pos_x[quad_order[i]];
+        com[1] += pos_y[quad_order[i]];
+    }
+    const float mass = static_cast<float>(end - begin);
+    quads.push_back({ {com[0] / mass, com[1] / mass}, lo, size, begin, end, 0, true });
+
+    if (end - begin > quad_leaf_size && depth < quad_max_depth) {
+        quads[q].leaf = false;
+
+        // split the nodes into the four quadrants (lower half in y first, each half split in x)
+        const float half = size / 2.0f;
+        const std::array<float,2> mid { lo[0] + half, lo[1] + half };
+        const auto first = quad_order.begin() + begin;
+        const auto last  = quad_order.begin() + end;
+        const auto split_y  = std::partition(first,   last,    [&](node_id_t i) { return pos_y[i] < mid[1]; });
+        const auto split_lo = std::partition(first,   split_y, [&](node_id_t i) { return pos_x[i] < mid[0]; });
+        const auto split_hi = std::partition(split_y, last,    [&](node_id_t i) { return pos_x[i] < mid[0]; });
+
+        const std::array<std::pair<std::vector<node_id_t>::iterator,std::array<float,2>>,5> bounds {{
+            { first,    lo                },
+            { split_lo, { mid[0], lo[1] } },
+            { split_y,  { lo[0], mid[1] } },
+            { split_hi, mid               },
+            { last,     {}                }
+        }};
+        for (std::size_t c = 0; c < 4; ++c) {
+            const auto c_begin = static_cast<uint32_t>(bounds[c].first     - quad_order.begin());
+            const auto c_end   = static_cast<uint32_t>(bounds[c + 1].first - quad_order.begin());
+            if (c_begin < c_end)
+                build_quad(c_begin, c_end, bounds[c].second, half, depth + 1);
         }
-    );
-
-    edge_look_up.resize( next_node_id );
-    std::ranges::fill(edge_look_up, std::make_pair(edges.end(),edges.end()));
-    node_id_t cur_id = edges[0].from;
-    auto cur_start = edges.begin();
-    for (std::size_t idx = 1; idx < edges.size(); ++idx) {
-        if (edges[idx].from != cur_id) {
-            auto cur_end = edges.begin();
-            std::advance(cur_end, idx);
-            edge_look_up[cur_id] = std::make_pair( cur_start, cur_end );
-            cur_start = cur_end;
-            cur_id = edges[idx].from;
+    }
+    quads[q].next = static_cast<uint32_t>(quads.size());
+}
+
+/*
+ * repulsion of all other nodes on the node id. The quadtree is traversed depth first without a stack: approximated
+ * quadrants and leaves are skipped by their next index, opened quadrants continue with their first child.
+ */
+std::array<float,2> fbgd::quadtree_repulsion(node_id_t id, float c2) const
+{
+    constexpr float min_dist = 0.0000001f;
+
+    const std::array<float,2> pos {pos_x[id], pos_y[id]};
+    std::array<float,2> force {0.0f, 0.0f};
+
+    for (uint32_t q = 0; q < quads.size(); ) {
+        const quad_t &quad = quads[q];
+        if (quad.leaf) {
+            accumulate_push(quad_x.data() + quad.begin, quad_y.data() + quad.begin, quad.end - quad.begin,
+                            pos[0], pos[1], c2, force);
+            q = quad.next;
+            continue;
+        }
+        // quadrants within the range of the local push (and those that contain the node) are always opened, as the
+        // strong local push of their nearby nodes cannot be approximated by the center of mass
+        const float bx = std::max({quad.lo[0] - pos[0], 0.0f, pos[0] - quad.lo[0] - quad.size});
+        const float by = std::max({quad.lo[1] - pos[1], 0.0f, pos[1] - quad.lo[1] - quad.size});
+        const float dx = pos[0] - quad.com[0];
+        const float dy = pos[1] - quad.com[1];
+        const float d2 = dx * dx + dy * dy;
+        if (bx * bx + by * by >= local_size * local_size && quad.size * quad.size < theta * theta * d2) {
+            const float dist = std::sqrt(std::max(min_dist, d2));
+            const float f    = c2 * static_cast<float>(quad.end - quad.begin) * local_push(dist) / dist;
+            force[0] += dx * f;
+            force[1] += dy * f;
+            q = quad.next;
+        } else {
+            ++q;
         }
     }
-    edge_look_up[cur_id] = std::make_pair( cur_start, edges.end() );
-    edges_dirty = false;
+    return force;
 }
 
-fbgd::node_id_t fbgd::add_node(std::any payload)
+void fbgd::set_repulsion(repulsion_t mode, float _theta)
 {
-    return add_node( {rnd_dis(rgen),rnd_dis(rgen)}, false, std::move(payload));
+    repulsion = mode;
+    theta     = std::max(_theta, 0.0f);
 }
 
-fbgd::node_id_t fbgd::add_node(const std::array<float, 2> &pos, bool fixed, std::any payload)
+fbgd::node_id_t fbgd::add_node(payload_t payload)
 {
-    node new_node {};
-    new_node.node_id = next_node_id++;
-    new_node.pos     = pos;
-    new_node.cell_id = pos_to_cell(new_node.pos);
-    new_node.fixed   = fixed;
-    new_node.payload = std::move(payload);
+    const float x = rnd_dis(rgen);
+    const float y = rnd_dis(rgen);
+    return add_node({x, y}, false, payload);
+}
 
-    nodes.push_back(new_node);
-    nodes_dirty = true;
+fbgd::node_id_t fbgd::add_node(const std::array<float, 2> &pos, bool _fixed, payload_t payload)
+{
+    const auto node_id = static_cast<node_id_t>(pos_x.size());
+    pos_x.push_back(pos[0]);
+    pos_y.push_back(pos[1]);
+    vel_x.push_back(0.0f);
+    vel_y.push_back(0.0f);
+    fixed.push_back(_fixed ? 1 : 0);
+    payloads.push_back(payload);
+    node_order.push_back(node_id);
+
+    // the compressed rows cover all nodes
+    edges_dirty = true;
 
-    return new_node.node_id;
+    return node_id;
 }
 
 void fbgd::add_edge(node_id_t node_a, node_id_t node_b)
@@ -128,11 +274,14 @@ void fbgd::add_edge(node_id_t node_a, node_id_t node_b)
 void fbgd::update()
 {
 
-    const auto node_cnt = nodes.size();
+    const auto node_cnt = pos_x.size();
     //constexpr auto cell_cnt = static_cast<int>(std::ceil(region_size / cell_size));
     const auto cell_cnt = static_cast<int>(std::ceil(region_size / cell_size));
 
-    const float cnt_normalizer = static_cast<float>(node_cnt*3) / static_cast<float>(cell_cnt);
+    // the grid mode sums the pushes of the nodes in the 3x3 neighborhood, the Barnes-Hut mode those of all nodes
+    const float cnt_normalizer = repulsion == repulsion_t::barnes_hut
+                               ? static_cast<float>(std::max<std::size_t>(node_cnt, 1))
+                               : static_cast<float>(node_cnt*3) / static_cast<float>(cell_cnt);
 
     const float w    = region_size;
     const float area = w*w;
@@ -144,158 +293,95 @@ void fbgd::update()
 
     float temperature = 1.0f;
 
-    std::array<float,2> node_update {0.0f, 0.0f};
     for (std::size_t iter = 0; iter < iterations; ++iter) {
-        rebuild_cell_and_node_look_up();
         rebuild_edge_look_up();
-        int cur_cell = std::numeric_limits<int>::max();
-        for (std::size_t idx = 0; idx < node_cnt; ++idx) {
-            node &cur_node = nodes[idx];
-            if (cur_node.fixed)
-                continue;
-            node_update = {0.0f, 0.0f};
-            // get starting indices of all cells we want to look at
-            if (cur_cell != static_cast<int>(cur_node.cell_id)) {
-                cur_cell = static_cast<int>(cur_node.cell_id);
-                nb_tmp.clear();
-                int center_x = cur_cell % cell_cnt;
-                int center_y = cur_cell / cell_cnt;
-                for (int dx = -1; dx <= 1; ++dx)
-                    for (int dy = -1; dy <= 1; ++dy) {
-                        int nb_x = center_x + dx;
-                        int nb_y = center_y + dy;
-
-                        if ((nb_x < 0) || (nb_x >= cell_cnt) || (nb_y < 0) || (nb_y >= cell_cnt))
-                            continue;
-
-                        nb_tmp.push_back( cell_look_up[nb_x + nb_y * cell_cnt] );
-                    }
-            }
-            // go through all cells to determined repellent forces
-            for (const auto &nb_cell : nb_tmp) {
-                for (auto nb_it = nb_cell.first; nb_it != nb_cell.second; ++nb_it) {
-                    const node &other_node = *nb_it;
-
-                    if (cur_node.node_id == other_node.node_id)
-                        continue;
-
+        if (repulsion == repulsion_t::barnes_hut)
+            build_quadtree();
+        else
+            rebuild_grid();
+
+        // displacements of all nodes from the current positions (nodes are independent, i.e., updated in parallel)
+        std::for_each(
+            std::execution::par,
+            node_order.begin(), node_order.end(),
+            [&](const node_id_t id) {
+                vel_x[id] = 0.0f;
+                vel_y[id] = 0.0f;
+                if (fixed[id])
+                    return;
+
+                const std::array<float,2> pos {pos_x[id], pos_y[id]};
+                std::array<float,2> node_update = repulsion == repulsion_t::barnes_hut
+                                                ? quadtree_repulsion(id, c2)
+                                                : grid_repulsion(id, c2);
+
+                // go through all edges of node to determine attractive forces
+                for (uint32_t k = adj_start[id]; k < adj_start[id + 1]; ++k) {
                     const std::array<float,2> delta {
-                        cur_node.pos[0] - other_node.pos[0],
-                        cur_node.pos[1] - other_node.pos[1]
+                        pos[0] - pos_x[adj[k]],
+                        pos[1] - pos_y[adj[k]]
                     };
+
                     const float dist = std::sqrt(std::max(min_dist,
                             delta[0] * delta[0] +
                             delta[1] * delta[1]
                         ));
 
-                    float local_push = 1.0f;
+                    node_update[0] -= delta[0] * c1 / dist;
+                    node_update[1] -= delta[1] * c1 / dist;
+                }
 
-                    if (dist < local_size) {
-                        local_push = 5000.0f * (1.0f - (dist / local_size));
-                    }
+                // repellent forces of close "indirect siblings"
+                if (sib_rep_force > 0.0f) {
+                    for (uint32_t k = sib_start[id]; k < sib_start[id + 1]; ++k) {
+                        const std::array<float,2> sib_delta {
+                            pos[0] - pos_x[sib[k]],
+                            pos[1] - pos_y[sib[k]]
+                        };
+                        const float sib_dist = std::sqrt(std::max(min_dist,
+                                sib_delta[0] * sib_delta[0] +
+                                sib_delta[1] * sib_delta[1]
+                            ));
+
+                        if (sib_dist > local_size)
+                            continue;
 
-                    /*
-                    if (dist < region_size / 1000.0f) {
-                        node_update[0] += rnd_dis(rgen) * 0.01; //border_wiggle;
-                        node_update[1] += rnd_dis(rgen) * 0.01; //border_wiggle;
+                        node_update[0] += sib_delta[0] * c3 / sib_dist;
+                        node_update[1] += sib_delta[1] * c3 / sib_dist;
                     }
-                    */
-
-
-                    node_update[0] += delta[0] * c2 * local_push / dist ;
-                    node_update[1] += delta[1] * c2 * local_push / dist ;
                 }
-            }
-            // go through all edges of node to determine attractive forces
-            // also create repellent forces of "indirect siblings"
-            auto cur_edges = edge_look_up[cur_node.node_id];
-            for (auto edge_it = cur_edges.first; edge_it != cur_edges.second; ++edge_it)
-            {
-                const node &other_node = nodes[node_look_up[edge_it->to]];
 
+                // add center pull
                 const std::array<float,2> delta {
-                    cur_node.pos[0] - other_node.pos[0],
-                    cur_node.pos[1] - other_node.pos[1]
+                    pos[0] - w / 2.0f,
+                    pos[1] - w / 2.0f
                 };
 
-                const float dist = std::sqrt(std::max(min_dist,
+                const float dist_sq = std::max(min_dist,
                         delta[0] * delta[0] +
                         delta[1] * delta[1]
-                    ));
+                    );
 
-                node_update[0] -= delta[0] * c1 / dist;
-                node_update[1] -= delta[1] * c1 / dist;
+                node_update[0] -= delta[0] * dist_sq * center_pull;
+                node_update[1] -= delta[1] * dist_sq * center_pull;
 
-                // get sibling repellents
+                const float nd_length = std::sqrt(node_update[0] * node_update[0] +
+                                                  node_update[1] * node_update[1]);
 
-                sib_tmp.clear();
-                auto other_edges = edge_look_up[other_node.node_id];
-                std::set_difference(
-                    other_edges.first,other_edges.second,
-                    cur_edges.first, cur_edges.second,
-                    std::back_inserter(sib_tmp),
-                    [](const auto &a, const auto &b) {
-                        return a.to < b.to;
-                    }
-                );
-
-                for (auto &sib : sib_tmp) {
-                    auto node_from = nodes[node_look_up[sib.from]];
-                    auto node_to   = nodes[node_look_up[sib.to]];
-                    const std::array<float,2> sib_delta {
-                        node_from.pos[0] - node_to.pos[0],
-                        node_from.pos[1] - node_to.pos[1]
-                    };
-                    const float sib_dist = std::sqrt(std::max(min_dist,
-                            delta[0] * delta[0] +
-                            delta[1] * delta[1]
-                        ));
+                if (!std::isnormal(nd_length))
+                    return;
 
-                    if (sib_dist > local_size)
-                        continue;
+                const float upd_factor = std::min(c1, nd_length * temperature * it_step) / nd_length;
 
-                    node_update[0] += sib_delta[0] * c3 / sib_dist ;
-                    node_update[1] += sib_delta[1] * c3 / sib_dist ;
-                }
+                vel_x[id] = node_update[0] * upd_factor;
+                vel_y[id] = node_update[1] * upd_factor;
             }
-            // add center pull
-            const std::array<float,2> delta {
-                cur_node.pos[0] - w / 2.0f,
-                cur_node.pos[1] - w / 2.0f
-            };
-
-            const float dist_sq = std::max(min_dist,
-                    delta[0] * delta[0] +
-                    delta[1] * delta[1]
-                );
-
-            node_update[0] -= delta[0] * dist_sq * center_pull;
-            node_update[1] -= delta[1] * dist_sq * center_pull;
-
-
-            // update node pos
-            const float nd_length = std::sqrt(node_update[0] * node_update[0] +
-                                              node_update[1] * node_update[1]);
+        );
 
-            if (!std::isnormal(nd_length))
-                continue;
-
-            const float upd_factor = std::min(c1, nd_length * temperature * it_step) / nd_length;
-
-            cur_node.pos[0] += node_update[0] * upd_factor;
-            cur_node.pos[1] += node_update[1] * upd_factor;
-
-/*
-            if (cur_node.pos[0] < 0.0f) cur_node.pos[0] = 0;//    rnd_dis(rgen) * border_wiggle;
-            if (cur_node.pos[0] > w)    cur_node.pos[0] = w;// - rnd_dis(rgen) * border_wiggle;
-            if (cur_node.pos[1] < 0.0f) cur_node.pos[1] = 0;//    rnd_dis(rgen) * border_wiggle;
-            if (cur_node.pos[1] > w)    cur_node.pos[1] = w;// - rnd_dis(rgen) * border_wiggle;
-*/
-
-            cur_node.cell_id = pos_to_cell(cur_node.pos);
-
-            // nodes have moved
-            nodes_dirty = true;
+        // update node pos
+        for (std::size_t idx = 0; idx < node_cnt; ++idx) {
+            pos_x[idx] += vel_x[idx];
+            pos_y[idx] += vel_y[idx];
         }
         temperature = std::min(temp_cf * temperature, temp_min);
     }
@@ -310,12 +396,7 @@ void fbgd::set_draw_func(draw_func_t df)
 void fbgd::draw() const
 {
     if (draw_func)
-        draw_func(nodes,edges,node_look_up);
-}
-
-const std::array<float, 2> & fbgd::get_node_pos(node_id_t node_id)
-{
-    return nodes[node_look_up[node_id]].pos;
+        draw_func(*this);
 }
 
 }
@@ -98,7 +98,7 @@ void ngm_vis::create_model(fbgd &vis, const ngm2::neuron_group_t &ng)
             neuron_idx,     //std::size_t neuron_idx
             0,              //std::size_t branch_idx
             0,              //uint16_t    segment_idx
-            vis.add_node({xp,yp}, true, root_node_idx), //fbgd::node_id_t node_id
+            vis.add_node({xp,yp}, true, static_cast<fbgd::payload_t>(root_node_idx)), //fbgd::node_id_t node_id
             1,               //uint8_t used
             {},
             std::vector<Color>(),
@@ -126,7 +126,7 @@ void ngm_vis::create_model(fbgd &vis, const ngm2::neuron_group_t &ng)
                         neuron_idx,          //std::size_t neuron_idx
                         branch_idx,          //std::size_t branch_idx
                         synapses.segment_idx[i], //uint16_t    segment_idx
-                        vis.add_node({xp + rdis(rgen) * (grid_spacing / 3), yp + rdis(rgen) * (grid_spacing / 3)},false,segment_base + synapses.segment_idx[i]),      //fbgd::node_id_t node_id
+                        vis.add_node({xp + rdis(rgen) * (grid_spacing / 3), yp + rdis(rgen) * (grid_spacing / 3)},false,static_cast<fbgd::payload_t>(segment_base + synapses.segment_idx[i])),      //fbgd::node_id_t node_id
                         1,                    //uint8_t used
                         tex,
                         pdata,
@@ -192,7 +192,7 @@ void ngm_vis::update_model(fbgd &vis, const ngm2::neuron_group_t &ng)
 
                     }
                 } else if (cur_node.used == 0) {
-                    auto &vis_pos = vis.get_node_pos(nodes[segment_base + synapses.segment_idx[i]/2].node_id);
+                    const auto vis_pos = vis.get_node_pos(nodes[segment_base + synapses.segment_idx[i]/2].node_id);
                     float vx = vis_pos[0] + rdis(rgen) * 0.0001f;
                     float vy = vis_pos[1] + rdis(rgen) * 0.0001f;
                     Texture2D tex;
@@ -205,7 +205,7 @@ void ngm_vis::update_model(fbgd &vis, const ngm2::neuron_group_t &ng)
                         neuron_idx,          //std::size_t neuron_idx
                         branch_idx,          //std::size_t branch_idx
                         synapses.segment_idx[i], //uint16_t    segment_idx
-                        vis.add_node({vx,vy},false, segment_base + synapses.segment_idx[i]),      //fbgd::node_id_t node_id
+                        vis.add_node({vx,vy},false, static_cast<fbgd::payload_t>(segment_base + synapses.segment_idx[i])),      //fbgd::node_id_t node_id
                         2,                    //uint8_t used
                         tex,
                         pdata,
@@ -276,40 +276,38 @@ void ngm_vis::free_resources()
 
 }
 
-void ngm_vis::paint(const std::vector<fbgd::node> &vis_nodes, const std::vector<fbgd::edge> &vis_edges,
-                    const std::vector<uint32_t> &vis_node_lu)
+void ngm_vis::paint(const fbgd &vis)
 {
     // perform basic rendering
     constexpr float draw_scale_y = 1000.0f;
     constexpr float draw_scale_x = 1500.0f;
-    for (auto &edge : vis_edges) {
-        const auto &vnode1 = vis_nodes[vis_node_lu[edge.from]];
-        const auto &vnode2 = vis_nodes[vis_node_lu[edge.to]];
-        if (vnode1.node_id > vnode2.node_id)
+    for (auto &edge : vis.get_edges()) {
+        if (edge.from > edge.to)
             continue;
+        const auto vpos1 = vis.get_node_pos(edge.from);
+        const auto vpos2 = vis.get_node_pos(edge.to);
         const Vector2 pos1 {
-            vnode1.pos[0] * draw_scale_x,
-            vnode1.pos[1] * draw_scale_y
+            vpos1[0] * draw_scale_x,
+            vpos1[1] * draw_scale_y
         };
         const Vector2 pos2 {
-            vnode2.pos[0] * draw_scale_x,
-            vnode2.pos[1] * draw_scale_y
+            vpos2[0] * draw_scale_x,
+            vpos2[1] * draw_scale_y
         };
-        auto node_idx = std::any_cast<std::size_t>(vnode2.payload);
-        auto &node2 = nodes[node_idx];
+        auto &node2 = nodes[vis.get_node_payload(edge.to)];
         float sc_ratio = static_cast<float>(node2.synapse_count) / (28.0f * 28.0f);
 
         DrawLineEx(pos1, pos2, 2.f + 8.f * sc_ratio, BLUE);
     }
 
-    for (auto &vis_node : vis_nodes) {
-        auto node_idx = std::any_cast<std::size_t>(vis_node.payload);
-        auto &node = nodes[node_idx];
+    for (fbgd::node_id_t id = 0; id < vis.get_node_cnt(); ++id) {
+        const auto vis_pos = vis.get_node_pos(id);
+        auto &node = nodes[vis.get_node_payload(id)];
         if (node.pixel_data.empty() == false) {
             float scale = 1.0f;
             Vector2 pos = {
-                vis_node.pos[0] * draw_scale_x - static_cast<float>(node.texture.width) * scale / 2,
-                vis_node.pos[1] * draw_scale_y - static_cast<float>(node.texture.height) * scale / 2,
+                vis_pos[0] * draw_scale_x - static_cast<float>(node.texture.width) * scale / 2,
+                vis_pos[1] * draw_scale_y - static_cast<float>(node.texture.height) * scale / 2,
             };
             DrawTextureEx(
                 node.texture,
@@ -320,8 +318,8 @@ void ngm_vis::paint(const std::vector<fbgd::node> &vis_nodes, const std::vector<
             );
         } else {
             DrawCircle(
-                static_cast<int>(vis_node.pos[0] * draw_scale_x),
-                static_cast<int>(vis_node.pos[1] * draw_scale_y),
+                static_cast<int>(vis_pos[0] * draw_scale_x),
+                static_cast<int>(vis_pos[1] * draw_scale_y),
                 node.segment_idx == 0 ? 6.0f : 3.0f,
                 node.segment_idx == 0 ? ORANGE : BLACK
             );
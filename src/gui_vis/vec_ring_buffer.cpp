@@ -27,7 +27,7 @@ vec_ring_buffer::vec_ring_buffer(uint16_t _vec_size, uint16_t _ring_size) :
     texture = LoadTextureFromImage(texture_img);
 }
 
-void vec_ring_buffer::update(const std::span<float> &data, bool auto_norm, float min_val, float max_val)
+void vec_ring_buffer::write_column(std::span<const float> data, bool auto_norm, float min_val, float max_val)
 {
     assert(data.size() == vec_size);
     if (auto_norm) {
@@ -46,10 +46,27 @@ void vec_ring_buffer::update(const std::span<float> &data, bool auto_norm, float
         cur_pixel.g = scaled_data;
         cur_pixel.b = scaled_data / 4;
     }
-    UpdateTexture(texture,pixel_data.data());
     ring_pos = (ring_pos + 1) % ring_size;
 }
 
+void vec_ring_buffer::update(const std::span<float> &data, bool auto_norm, float min_val, float max_val)
+{
+    write_column(data, auto_norm, min_val, max_val);
+    UpdateTexture(texture,pixel_data.data());
+}
+
+void vec_ring_buffer::update_batch(std::span<const float> data, std::size_t vec_cnt, bool auto_norm, float min_val, float max_val)
+{
+    assert(data.size() >= vec_cnt * vec_size);
+    // vectors that would be overwritten within the same batch are skipped
+    const std::size_t first = vec_cnt > ring_size ? vec_cnt - ring_size : 0;
+    for (std::size_t vec_idx = first; vec_idx < vec_cnt; ++vec_idx) {
+        write_column(data.subspan(vec_idx * vec_size, vec_size), auto_norm, min_val, max_val);
+    }
+    if (vec_cnt > 0)
+        UpdateTexture(texture,pixel_data.data());
+}
+
 void vec_ring_buffer::paint(Vector2 pos, float rot, float scale)
 {
     DrawTextureEx(texture, pos, rot, scale, WHITE );
@@ -6,9 +6,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <numeric>
 #include <ranges>
 #include <utility>
+#include <variant>
 
 #include "hd_ngm2_tools.h"
 
@@ -78,6 +80,9 @@ dendrite_t::dendrite_t(params_t _params) :
     min_mismatch_percentage ( params.default_min_mismatch_percentage        ),
     mismatch_act_thres      ( params.default_mismatch_act_thres             ),
     last_max_inp            ( 0.0f                                          ),
+    synapse_version         ( 0                                             ),
+    saved_synapse_version   ( std::numeric_limits<uint64_t>::max()          ),
+    sparse_cache_valid      ( false                                         ),
     rgen                    ( params.rnd_seed                               )
 {
     // initializing random synapses
@@ -113,6 +118,14 @@ void dendrite_t::set_inp_func(partial_id_t id, std::function<sim::io_buffer::inp
         input_mem[id] = std::move(inp_func);
 }
 
+void dendrite_t::set_sparse_inp_func(partial_id_t id, std::function<sim::io_buffer::sparse_inp_t()> inp_func)
+{
+    if (params.input_ids.contains(id)) {
+        sparse_input_mem[id] = std::move(inp_func);
+        sparse_cache_valid   = false;
+    }
+}
+
 
 /*
  * main function that models the response of a dendritic branch to the current input of its input space(s)
@@ -193,37 +206,66 @@ float dendrite_t::get_response()
      * and control over the input reference is facilitated by the input_inc array. Together, determining
      * the activity of all dendritic segments is achieved by a single sweep through the synapses SOA
      */
-    const std::size_t syn_cnt = synapses.size();
 
-    // getting first partial input from hashmap
-    // and getting cur_input array and statistics for the first partial input
-    auto pi = input_mem.begin();
-    auto [cur_input,cur_stats] = pi->second();
+    // normalized shannon entropy statistic (minimum over all partial inputs)
+    float nse = 1.0f;
+
+    if (sparse_input_mem.size() == input_mem.size()) {
+        // all partial inputs are sparse, hence only the synapses of the non-zero inputs need to be visited
+        nse = get_sparse_segment_activity();
+    } else {
+        // sweep through the synapses of all partial inputs (in the order of input_mem), each partial input is processed
+        // by the kernel for its element type (see io_elem.h)
+        std::size_t syn_idx = 0;
+        for (const auto &partial_input_func : input_mem | std::views::values) {
+            const auto [partial_input, pi_stats] = partial_input_func();
+
+            // normalized shannon entropy statistic of the partial input
+            nse = std::min(pi_stats.nse, nse);
+
+            syn_idx = std::visit(
+                [&](const auto &inp) { return accumulate_partial(inp, pi_stats, syn_idx); },
+                partial_input
+            );
+        }
+    }
 
-    // set up start and end of current input
-    auto cur_inp_it    = cur_input.begin();
-    auto cur_inp_end   = cur_input.end();
+    // 2) push activities to the leafs
+    const std::size_t leaf_begin = (max_segment_idx + 1) / 2;
+    for (std::size_t si = 1; si < leaf_begin; ++si) {
+        segment_activity[si * 2 + 0] += segment_activity[si];
+        segment_activity[si * 2 + 1] += segment_activity[si];
+    }
 
-    // getting the normalized shannon entropy statistic for first partial input
-    float nse = cur_stats.nse;
+    // determine the maximum activity among the leafs of the dendritic branch
+    // and attenuate the activity if the normalized shannon entropy (NSE) indicates that the input is basically noise.
+    // For inputs that carry information the NSE ranges mostly between 0.8 and 0.9. From there on (0.9 to 1.0) inputs
+    // are likely to be predominantly noise.
+    // Please note that the segment_activity is used below in the adapt_synapses function. Hence the attenuation needs
+    // to be applied to every element and not just the max_activity
+    float attenuation = 1.0f - sigmoid((nse - 0.8f) / 0.2f, {0.25f,0.5f});
+    float max_activity = 0.0f;
+    for (std::size_t si = leaf_begin; si <= max_segment_idx; ++si) {
+        segment_activity[si] = std::clamp( segment_activity[si] * attenuation / inp_sum , 0.0f, 1.0f );
+        max_activity = std::max(max_activity, segment_activity[si]);
+    }
+
+    return max_activity;
+}
 
+/*
+ * step 1) of get_response for a single partial input, i.e., the synapses starting at syn_idx up to the last synapse
+ * of the partial input. Returns the index of the first synapse of the next partial input.
+ */
+template<class E>
+std::size_t dendrite_t::accumulate_partial(std::span<const E> inp, const sim::io_buffer::stats &inp_stats, std::size_t syn_idx)
+{
     // setting up a uniform random distribution that will be used to stochastically determine if an input is "low"
-    std::uniform_real_distribution<float> dis1 { 0.0f, cur_stats.max_val / 2.0f };
-
-    // linear sweep through all synapses
-    for (std::size_t i = 0; i < syn_cnt; ++i) {
-
-        // if the current partial input has ended, we continue with the next one and update our variables accordingly
-        if (cur_inp_it == cur_inp_end) {
-            ++pi;
-            auto [new_input,new_stats] = pi->second();
-            cur_input = new_input;
-            cur_stats = new_stats;
-            cur_inp_it  = cur_input.begin();
-            cur_inp_end = cur_input.end();
-            nse = std::min(cur_stats.nse,nse);
-            dis1 = std::uniform_real_distribution<float> {0.0f, cur_stats.max_val / 2.0f};
-        }
+    std::uniform_real_distribution<float> dis1 { 0.0f, inp_stats.max_val / 2.0f };
+
+    const std::size_t syn_cnt = synapses.size();
+    for (std::size_t pos = 0; syn_idx < syn_cnt && pos < inp.size(); ++syn_idx) {
+        const float cur_inp = sim::to_float(inp[pos]);
 
         /* we only process an input if the "permanence" [0..1] of the corresponding synapse is above a given
         *  permanence threshold (e.g., 0.3). The concept of "permanence" stems from Hawkins et al. (Numenta) and
@@ -237,47 +279,163 @@ float dendrite_t::get_response()
         *  that is not used properly. As it is diffcult to state when an input is actually "low", we follow a stochastic
         *  approach and decide if the input was low via a uniform distribution between 0 and max_input_value / 2. (see 1.2)
         */
-        if (synapses.permanence[i] > params.permanence_threshold) {
+        if (synapses.permanence[syn_idx] > params.permanence_threshold) {
+            const seg_id_t si = synapses.segment_idx[syn_idx];
             // 1.1
-            segment_activity[synapses.segment_idx[i]] += *cur_inp_it;
+            segment_activity[si] += cur_inp;
 
             // 1.2
-            if (dis1(rgen) > *cur_inp_it) {
-                const float inp_contrib   = *cur_inp_it / cur_stats.sum;
-                const float perm_strength = (synapses.permanence[i] - params.permanence_threshold) / (1.0f - params.permanence_threshold);
-                segment_activity[synapses.segment_idx[i]] -= perm_strength * (1.0f - inp_contrib);
-                if (segment_activity[synapses.segment_idx[i]] < 0.0f)
-                    segment_activity[synapses.segment_idx[i]] = 0.0f;
+            if (dis1(rgen) > cur_inp) {
+                const float inp_contrib = cur_inp / inp_stats.sum;
+                segment_activity[si] -= perm_strength(synapses.permanence[syn_idx]) * (1.0f - inp_contrib);
+                if (segment_activity[si] < 0.0f)
+                    segment_activity[si] = 0.0f;
             }
 
         }
-        // we advance the current input iterator only if the respective input signal is not needed by further
+        // we advance the current input position only if the respective input signal is not needed by further
         // synapses, i.e., the values in input_inc are either 0 or 1. For a group of synapses that all receive input
         // from a given input dimension, all input_inc values are 0 except from the last synapse of the group.
-        cur_inp_it += synapses.input_inc[i];
+        pos += synapses.input_inc[syn_idx];
     }
+    return syn_idx;
+}
 
-    // 2) push activities to the leafs
-    const std::size_t leaf_begin = (max_segment_idx + 1) / 2;
-    for (std::size_t si = 1; si < leaf_begin; ++si) {
-        segment_activity[si * 2 + 0] += segment_activity[si];
-        segment_activity[si * 2 + 1] += segment_activity[si];
+/*
+ * rebuilds the mapping from input positions to synapses and the per segment penalties (see dendrite_t members)
+ */
+void dendrite_t::rebuild_sparse_cache()
+{
+    input_syn_offsets.clear();
+    input_syn_offsets.push_back(0);
+    const std::size_t syn_cnt = synapses.size();
+    for (std::size_t i = 0; i < syn_cnt; ++i)
+        if (synapses.input_inc[i])
+            input_syn_offsets.push_back(static_cast<uint32_t>(i + 1));
+
+    segment_penalty.resize(max_segment_idx + 1);
+    connected_before.resize(input_syn_offsets.size());
+    reset_penalties();
+    for (std::size_t pos = 0; pos + 1 < input_syn_offsets.size(); ++pos)
+        for (uint32_t i = input_syn_offsets[pos]; i < input_syn_offsets[pos + 1]; ++i)
+            if (synapses.permanence[i] > params.permanence_threshold)
+                add_penalty(pos, i);
+    finish_penalties();
+    sparse_cache_valid = true;
+}
+
+void dendrite_t::reset_penalties()
+{
+    for (auto &pen : segment_penalty)
+        pen.clear();
+    std::ranges::fill(connected_before, 0u);
+}
+
+/*
+ * records the connected synapse syn_idx at input position pos, synapses have to be added in the order of the dense sweep
+ */
+void dendrite_t::add_penalty(const std::size_t pos, const std::size_t syn_idx)
+{
+    auto &pen = segment_penalty[synapses.segment_idx[syn_idx]];
+    const float cum = pen.empty() ? 0.0f : pen.back().second;
+    pen.emplace_back(static_cast<uint32_t>(pos), cum + perm_strength(synapses.permanence[syn_idx]));
+    ++connected_before[pos + 1];
+}
+
+void dendrite_t::finish_penalties()
+{
+    std::partial_sum(connected_before.begin(), connected_before.end(), connected_before.begin());
+}
+
+/*
+ * Sparse variant of step 1) of get_response, returns the minimum NSE of the partial inputs.
+ * In the dense sweep every connected synapse of a zero input reduces the activity of its segment by its permanence
+ * strength (the stochastic threshold is drawn from [0, max/2), i.e., it is above zero) and the activity is clamped at
+ * zero. As all of these penalties are positive, a run of them equals a single penalty of their sum clamped at zero.
+ * Hence, we only visit the synapses of the non-zero inputs and, whenever a segment is visited, apply the penalty of its
+ * connected synapses since its last visit in bulk, which is given by the cumulative penalties of the segment (see
+ * dendrite_t members). The synapses of the non-zero inputs are processed exactly like in the dense sweep, the random
+ * draws of the skipped connected synapses are discarded to keep the generator in step with the dense sweep.
+ * Thus, both kernels produce the same activities up to rounding of the summed penalties. The only other difference is
+ * a threshold drawn as exactly zero (probability 2^-24 per draw) for a zero input, which spares the synapse in the
+ * dense sweep but not here. As the rounding may still change learning results over time, the sparse kernel is only
+ * used if a group opts in (see neuron_group_t::params_t::sparse_inputs).
+ */
+float dendrite_t::get_sparse_segment_activity()
+{
+    if (!sparse_cache_valid)
+        rebuild_sparse_cache();
+
+    const std::size_t pos_cnt = input_syn_offsets.size() - 1;
+
+    // gather the sparse partial inputs (in the order of the dense sweep)
+    static thread_local std::vector<sim::io_buffer::sparse_inp_t> sparse_inputs;
+    sparse_inputs.clear();
+    for (const auto id : input_mem | std::views::keys)
+        sparse_inputs.push_back(sparse_input_mem.at(id)());
+
+    // per segment: cumulative penalty up to its last visit, the first entry of its penalty list at or after the last
+    // queried position and the position after its last visit (0 if not visited yet)
+    static thread_local std::vector<float>       last_penalty;
+    static thread_local std::vector<std::size_t> pen_cursor;
+    static thread_local std::vector<std::size_t> visited_end;
+    last_penalty.assign(max_segment_idx + 1, 0.0f);
+    pen_cursor.assign(max_segment_idx + 1, 0);
+    visited_end.assign(max_segment_idx + 1, 0);
+
+    // cumulative penalty of all connected synapses of segment si before input position pos (pos must not decrease)
+    auto penalty_before = [&](const seg_id_t si, const std::size_t pos) {
+        const auto &pen = segment_penalty[si];
+        const auto  it  = std::lower_bound(pen.begin() + static_cast<std::ptrdiff_t>(pen_cursor[si]), pen.end(), pos,
+            [](const auto &entry, const std::size_t p) { return entry.first < p; });
+        pen_cursor[si] = static_cast<std::size_t>(it - pen.begin());
+        return it == pen.begin() ? 0.0f : std::prev(it)->second;
+    };
+
+    float       nse      = 1.0f;
+    std::size_t inp_base = 0;
+    std::size_t next_pos = 0;  // first input position whose random draws have not been consumed yet
+    for (const auto &[idx, val, size, inp_stats] : sparse_inputs) {
+        nse = std::min(inp_stats.nse, nse);
+        std::uniform_real_distribution<float> dis1 { 0.0f, inp_stats.max_val / 2.0f };
+
+        for (std::size_t k = 0; k < idx.size(); ++k) {
+            const std::size_t pos = inp_base + idx[k];
+            const float       inp = val[k];
+            rgen.discard(connected_before[pos] - connected_before[next_pos]);
+            next_pos = pos + 1;
+
+            for (uint32_t i = input_syn_offsets[pos]; i < input_syn_offsets[pos + 1]; ++i) {
+                if (synapses.permanence[i] <= params.permanence_threshold)
+                    continue;
+                const seg_id_t si = synapses.segment_idx[i];
+                // penalties of the zero inputs since the last visit of the segment
+                if (visited_end[si] != next_pos) {
+                    segment_activity[si] = std::max(segment_activity[si] - (penalty_before(si, pos) - last_penalty[si]), 0.0f);
+                    last_penalty[si] = penalty_before(si, next_pos);
+                    visited_end[si]  = next_pos;
+                }
+                // same as 1.1 and 1.2 of the dense sweep
+                segment_activity[si] += inp;
+                if (dis1(rgen) > inp) {
+                    segment_activity[si] -= perm_strength(synapses.permanence[i]) * (1.0f - inp / inp_stats.sum);
+                    if (segment_activity[si] < 0.0f)
+                        segment_activity[si] = 0.0f;
+                }
+            }
+        }
+        inp_base += size;
     }
+    rgen.discard(connected_before[pos_cnt] - connected_before[std::min(next_pos, pos_cnt)]);
 
-    // determine the maximum activity among the leafs of the dendritic branch
-    // and attenuate the activity if the normalized shannon entropy (NSE) indicates that the input is basically noise.
-    // For inputs that carry information the NSE ranges mostly between 0.8 and 0.9. From there on (0.9 to 1.0) inputs
-    // are likely to be predominantly noise.
-    // Please note that the segment_activity is used below in the adapt_synapses function. Hence the attenuation needs
-    // to be applied to every element and not just the max_activity
-    float attenuation = 1.0f - sigmoid((nse - 0.8f) / 0.2f, {0.25f,0.5f});
-    float max_activity = 0.0f;
-    for (std::size_t si = leaf_begin; si <= max_segment_idx; ++si) {
-        segment_activity[si] = std::clamp( segment_activity[si] * attenuation / inp_sum , 0.0f, 1.0f );
-        max_activity = std::max(max_activity, segment_activity[si]);
+    // penalties of the remaining zero inputs
+    for (std::size_t si = 0; si <= max_segment_idx; ++si) {
+        const auto &pen = segment_penalty[si];
+        if (!pen.empty())
+            segment_activity[si] = std::max(segment_activity[si] - (pen.back().second - last_penalty[si]), 0.0f);
     }
 
-    return max_activity;
+    return nse;
 }
 
 /*
@@ -336,44 +494,73 @@ void dendrite_t::adapt_synapses(const float max_activity, const float weight)
      * Lastly, we collect some statistical information to (later) decide if a synapse should be "cloned" and moved
      * from a lower dendritic segment towards a higher one (see 4.1 & 4.2)
      */
-    const std::size_t syn_cnt = synapses.size();
 
-    // getting first partial input from hashmap
-    // and getting cur_input array and statistics for the first partial input
-    auto pi = input_mem.begin();
-    auto [cur_input,cur_stats] = pi->second();
+    // the penalties used by the sparse response are updated along with the permanences
+    const bool track_penalty = sparse_cache_valid;
+    if (track_penalty)
+        reset_penalties();
 
-    // set up start and end of current input
-    auto cur_inp_it    = cur_input.begin();
-    auto cur_inp_end   = cur_input.end();
+    // sweep through the synapses of all partial inputs, each partial input is processed by the kernel for its element
+    // type (see io_elem.h)
+    std::size_t syn_idx  = 0;
+    std::size_t pos_base = 0;
+    bool        modified = false;
+    for (const auto &partial_input_func : input_mem | std::views::values) {
+        const auto [partial_input, pi_stats] = partial_input_func();
+        syn_idx = std::visit(
+            [&](const auto &inp) {
+                const std::size_t next = adapt_partial(inp, pi_stats, syn_idx, pos_base, max_activity, track_penalty, modified);
+                pos_base += inp.size();
+                return next;
+            },
+            partial_input
+        );
+    }
+    if (track_penalty)
+        finish_penalties();
+
+    // only actual changes make the synapses part of the next delta checkpoint, e.g., a zero weight leaves the
+    // permanences and histories untouched
+    if (modified)
+        ++synapse_version;
+}
 
+/*
+ * adaptation of the synapses of a single partial input (see adapt_synapses), starting at syn_idx. Returns the index of
+ * the first synapse of the next partial input.
+ */
+template<class E>
+std::size_t dendrite_t::adapt_partial(
+    std::span<const E>           inp,
+    const sim::io_buffer::stats &inp_stats,
+    std::size_t                  syn_idx,
+    const std::size_t            pos_base,
+    const float                  max_activity,
+    const bool                   track_penalty,
+    bool                        &modified
+){
     // calculate an attenuation factor depending on the normalized shannon entropy of this partial input
     // (see also description of the attenuation in the get_response method)
-    float attenuation = 1.0f - sigmoid((cur_stats.nse - 0.8f) / 0.2f);
-
-    // linear sweep through all synapses
-    for (std::size_t i = 0; i < syn_cnt; ++i) {
-
-        // if the current partial input has ended, we continue with the next one and update our variables accordingly
-        if (cur_inp_it == cur_inp_end) {
-            ++pi;
-            auto [new_input,new_stats] = pi->second();
-            cur_input = new_input;
-            cur_stats = new_stats;
-            cur_inp_it    = cur_input.begin();
-            cur_inp_end   = cur_input.end();
-            attenuation = 1.0f - sigmoid((cur_stats.nse - 0.8f) / 0.2f);
-        }
+    const float attenuation = 1.0f - sigmoid((inp_stats.nse - 0.8f) / 0.2f);
+
+    const std::size_t syn_cnt = synapses.size();
+    std::size_t i = syn_idx;
+    for (std::size_t pos = 0; i < syn_cnt && pos < inp.size(); ++i) {
+        const float cur_inp = sim::to_float(inp[pos]);
 
         // 3 we want to learn strongly when the particular input is either near 1 or near 0 and
         // if the partial input is not noise
-        const float high_thres = ((cur_stats.avg) / 2.0f) + std::numeric_limits<float>::epsilon();
-        const float theta = std::clamp( segment_weights[ synapses.segment_idx[i] ] * ( *cur_inp_it > high_thres ?
-                                (*cur_inp_it - high_thres) / (1.0f - high_thres) :
-                                (high_thres - *cur_inp_it) / high_thres
+        const float high_thres = ((inp_stats.avg) / 2.0f) + std::numeric_limits<float>::epsilon();
+        const float theta = std::clamp( segment_weights[ synapses.segment_idx[i] ] * ( cur_inp > high_thres ?
+                                (cur_inp - high_thres) / (1.0f - high_thres) :
+                                (high_thres - cur_inp) / high_thres
                             ) * attenuation, 0.0f, 1.0f);
 
-        synapses.permanence[i] = std::clamp(synapses.permanence[i] * (1.0f - theta) + (*cur_inp_it > high_thres ? theta : 0.0f), 0.0f, 1.0f);
+        const float perm = std::clamp(synapses.permanence[i] * (1.0f - theta) + (cur_inp > high_thres ? theta : 0.0f), 0.0f, 1.0f);
+        modified |= perm != synapses.permanence[i] || theta != 0.0f;
+        synapses.permanence[i] = perm;
+        if (track_penalty && synapses.permanence[i] > params.permanence_threshold)
+            add_penalty(pos_base + pos, i);
 
         // 4.1 we collect some statistical information on the strength of our permanence adaptation. We need this information
         // below in the adapt branches function to decide whether or not to move the synapse to a higher dendritic segment
@@ -385,17 +572,20 @@ void dendrite_t::adapt_synapses(const float max_activity, const float weight)
         // Furthermore, the mismatch value is implemented as IIR-Filter that emphasizes more recent mismatches.
         const float act_ratio = segment_activity[ synapses.segment_idx[i] ] / max_activity;
         if (act_ratio >= mismatch_act_thres) {
-            const float inp_ratio = *cur_inp_it / last_max_inp;
+            const float inp_ratio = cur_inp / last_max_inp;
             float mismatch = synapses.permanence[i] > params.permanence_threshold ? 1.0f - inp_ratio : inp_ratio;
             mismatch *= act_ratio;
-            synapses.mismatch[i] = synapses.mismatch[i] * (1.0f - mismatch_smoothing) + mismatch * mismatch_smoothing;
+            const float smoothed = synapses.mismatch[i] * (1.0f - mismatch_smoothing) + mismatch * mismatch_smoothing;
+            modified |= smoothed != synapses.mismatch[i];
+            synapses.mismatch[i] = smoothed;
         }
 
-        // we advance the current input iterator only if the respective input signal is not needed by further
+        // we advance the current input position only if the respective input signal is not needed by further
         // synapses, i.e., the values in input_inc are either 0 or 1. For a group of synapses that all receive input
         // from a given input dimension, all input_inc values are 0 except from the last synapse of the group.
-        cur_inp_it += synapses.input_inc[i];
+        pos += synapses.input_inc[i];
     }
+    return i;
 }
 
 /*
@@ -450,6 +640,8 @@ void dendrite_t::adapt_branches()
      */
 
     // 2.1 expand and update synapse memory
+    ++synapse_version;
+    sparse_cache_valid = false;
     std::size_t last_synapse_idx = syn_cnt - 1;
     synapses.resize(syn_cnt + mm_cnt);
 
@@ -593,8 +785,95 @@ dendrite_t::seg_id_t dendrite_t::get_max_segment_idx() const
     return max_segment_idx;
 }
 
+// activities of all segments of the last response (the leaves hold the normalized activities of the dendritic paths)
+std::span<const float> dendrite_t::get_segment_activity() const
+{
+    return segment_activity;
+}
+
 std::size_t dendrite_t::get_input_size() const
 {
     return params.input_size;
 }
+
+/*
+ * checkpoint support. The parameters are not stored as they are given by the network topology. We only store the
+ * input size and the maximum segment index to detect topology mismatches when loading.
+ * In delta checkpoints the synapse arrays are only written if they changed since the last checkpoint.
+ */
+void dendrite_t::save_state(sim::checkpoint_writer &cw) const
+{
+    cw.write<uint64_t>(params.input_size);
+    cw.write<seg_id_t>(max_segment_idx);
+
+    const bool write_synapses = !cw.is_delta() || synapse_version != saved_synapse_version;
+    cw.write<uint8_t>(write_synapses);
+    if (write_synapses) {
+        cw.write_array(synapses.permanence);
+        cw.write_array(synapses.mismatch);
+        cw.write_array(synapses.adapt_history);
+        cw.write_array(synapses.segment_idx);
+        cw.write_array(synapses.input_inc);
+    }
+    cw.write_array(segment_activity);
+    cw.write_array(segment_weights);
+
+    cw.write(primary_learning_rate);
+    cw.write(secondary_learning_rate);
+    cw.write(mismatch_smoothing);
+    cw.write(accumulated_theta_thres);
+    cw.write(min_mismatch_deviation);
+    cw.write(min_mismatch_percentage);
+    cw.write(mismatch_act_thres);
+    cw.write(last_max_inp);
+    cw.write_rng(rgen);
+}
+
+bool dendrite_t::load_state(sim::checkpoint_reader &cr)
+{
+    if (cr.read<uint64_t>() != params.input_size || cr.read<seg_id_t>() != max_segment_idx) {
+        std::fprintf(stderr, "dendrite topology in checkpoint does not match\n");
+        return false;
+    }
+
+    // the arrays are read straight from the memory mapped checkpoint, version 1 records always contain them and lack
+    // the flag
+    if (cr.get_version() < 2 || cr.read<uint8_t>() != 0) {
+        cr.read_array_into(synapses.permanence);
+        cr.read_array_into(synapses.mismatch);
+        cr.read_array_into(synapses.adapt_history);
+        cr.read_array_into(synapses.segment_idx);
+        cr.read_array_into(synapses.input_inc);
+        ++synapse_version;
+        sparse_cache_valid = false;
+    } else if (!cr.is_delta()) {
+        std::fprintf(stderr, "full checkpoint lacks synapse arrays\n");
+        return false;
+    }
+    cr.read_array_into(segment_activity);
+    cr.read_array_into(segment_weights);
+
+    const std::size_t syn_cnt = synapses.permanence.size();
+    if (synapses.mismatch.size()      != syn_cnt ||
+        synapses.adapt_history.size() != syn_cnt ||
+        synapses.segment_idx.size()   != syn_cnt ||
+        synapses.input_inc.size()     != syn_cnt ||
+        segment_activity.size()       != static_cast<std::size_t>(max_segment_idx + 1) ||
+        segment_weights.size()        != static_cast<std::size_t>(max_segment_idx + 1))
+    {
+        std::fprintf(stderr, "inconsistent synapse arrays in checkpoint\n");
+        return false;
+    }
+
+    cr.read_into(primary_learning_rate);
+    cr.read_into(secondary_learning_rate);
+    cr.read_into(mismatch_smoothing);
+    cr.read_into(accumulated_theta_thres);
+    cr.read_into(min_mismatch_deviation);
+    cr.read_into(min_mismatch_percentage);
+    cr.read_into(mismatch_act_thres);
+    cr.read_into(last_max_inp);
+    cr.read_rng(rgen);
+    return cr.good();
+}
 }
@@ -2,6 +2,7 @@
 // Created by jk on 26.08.25.
 //
 #include <algorithm>
+#include <cstdio>
 #include "hd_ngm2_neuron.h"
 
 namespace ngm2 {
@@ -36,6 +37,12 @@ void neuron_t::set_inp_func(partial_id_t id, const std::function<sim::io_buffer:
         dendrite.set_inp_func(id,inp_func);
 }
 
+void neuron_t::set_sparse_inp_func(partial_id_t id, const std::function<sim::io_buffer::sparse_inp_t()> &inp_func)
+{
+    for (auto &dendrite : dendrites)
+        dendrite.set_sparse_inp_func(id,inp_func);
+}
+
 
 /*
  * main function that models the response of a neuron to a current input
@@ -87,7 +94,7 @@ float neuron_t::get_response()
 /*
  * modelling the adaptation of a neuron
  */
-void neuron_t::adapt(float weight)
+void neuron_t::adapt(float weight, sim::latency_histogram *branch_timing)
 {
     // we only want to learn if our neuron activity was somewhere in the middle. If the neurons response was very low
     // or very high, we reduce the weight towards 0
@@ -107,6 +114,7 @@ void neuron_t::adapt(float weight)
         return;
 
     // if that is the case we check if the dendrites should branch
+    COAST_TIME_SCOPE(branch_timing);
     for (auto &dendrite : dendrites) {
         dendrite.adapt_branches();
     }
@@ -141,5 +149,51 @@ std::size_t neuron_t::get_synapse_count() const
     return result;
 }
 
+/*
+ * checkpoint support
+ */
+void neuron_t::save_state(sim::checkpoint_writer &cw) const
+{
+    cw.write(neuron_activity);
+    cw.write(dendrite_type_activity);
+    cw.write<uint64_t>(input_count);
+    cw.write<uint64_t>(branch_interval);
+    cw.write(activity_learning_window.first);
+    cw.write(activity_learning_window.second);
+    cw.write(energy);
+    cw.write_rng(rgen);
+
+    cw.write<uint64_t>(dendrites.size());
+    for (const auto &dendrite : dendrites)
+        dendrite.save_state(cw);
+}
+
+bool neuron_t::load_state(sim::checkpoint_reader &cr)
+{
+    cr.read_into(neuron_activity);
+    cr.read_into(dendrite_type_activity);
+    input_count     = cr.read<uint64_t>();
+    branch_interval = cr.read<uint64_t>();
+    cr.read_into(activity_learning_window.first);
+    cr.read_into(activity_learning_window.second);
+    cr.read_into(energy);
+    cr.read_rng(rgen);
+
+    if (cr.read<uint64_t>() != dendrites.size()) {
+        std::fprintf(stderr, "dendrite count in checkpoint does not match\n");
+        return false;
+    }
+    for (auto &dendrite : dendrites)
+        if (!dendrite.load_state(cr))
+            return false;
+    return cr.good();
+}
+
+void neuron_t::mark_checkpointed()
+{
+    for (auto &dendrite : dendrites)
+        dendrite.mark_checkpointed();
+}
+
 }
 
@@ -6,7 +6,9 @@
 #include <utility>
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
 #include <execution>
+#include <numeric>
 
 namespace ngm2 {
 
@@ -62,6 +64,15 @@ void neuron_group_t::set_inp_func(partial_id_t id, const std::function<sim::io_b
         neuron.set_inp_func(id,inp_func);
 }
 
+void neuron_group_t::set_sparse_inp_func(partial_id_t id, const std::function<sim::io_buffer::sparse_inp_t()> &inp_func)
+{
+    // without the opt-in the dendrites always use the dense sweep
+    if (!params.sparse_inputs)
+        return;
+    for (auto &neuron : neurons)
+        neuron.set_sparse_inp_func(id,inp_func);
+}
+
 /*
  * main function that models the neuron group's behavior for one processing step
  */
@@ -76,20 +87,153 @@ void neuron_group_t::process()
 
     // get the current activity of all neurons in parallel
     // (parallel processing might in the future move up to the level of the simulation)
+    {
+        COAST_TIME_SCOPE(&phase_timings[phase_response]);
+        std::for_each(
+            std::execution::par,
+            neurons.begin(),neurons.end(),
+            [&](auto &neuron) {
+                out[neuron.id] = neuron.get_response(); // writing into out from different threads is a performance
+                                                        // problem as it is very cache unfriendly. This problem will go
+                                                        // away as soon as the parallelization moves up to the level
+                                                        // of the simulation.
+            }
+        );
+    }
+
+    // local inhibition and adaptation of the winning neuron
+    const float act_sum = inhibit_and_adapt_winner(out);
+
+    // 4)
+    if (!frozen) {
+        COAST_TIME_SCOPE(&phase_timings[phase_secondary_adapt]);
+        std::for_each(
+            std::execution::par, // parallelization might move up to the simulation layer at some point
+            neurons.begin(), neurons.end(),
+            [&](auto &neuron) {
+                neuron.adapt(secondary_weight(out, neuron.id, act_sum), branch_timing());
+            }
+        );
+    }
+
+    sparsify_output(out);
+}
+
+/*
+ * processes a batch of neuron groups as a whole, i.e., the responses and the secondary adaptation of the neurons of
+ * all groups are computed within one parallel loop each, which balances the load better than per group loops if
+ * there are many (small) groups. The results are identical to calling process() on every group.
+ */
+void neuron_group_t::process_all(std::span<neuron_group_t> groups)
+{
+    // scratch memory shared by all batches on this thread (reused across steps). A lambda does not capture a
+    // thread_local variable, the parallel loops below would access the (empty) instances of the worker threads.
+    // Hence, all accesses go through a reference to the instance of the calling thread.
+    struct neuron_ref_t {
+        neuron_group_t *group;
+        neuron_t       *neuron;
+        std::size_t     resp_idx;
+    };
+    struct scratch_t {
+        std::vector<neuron_ref_t> neuron_refs;
+        std::vector<float>        responses;
+        std::vector<std::size_t>  offsets;
+        std::vector<float>        act_sums;
+        std::vector<std::size_t>  group_idx;
+    };
+    static thread_local scratch_t thread_scratch;
+    scratch_t &scratch = thread_scratch;
+
+    scratch.neuron_refs.clear();
+    scratch.offsets.clear();
+    for (auto &group : groups) {
+        assert(group.output_mem != nullptr);
+        scratch.offsets.push_back(scratch.neuron_refs.size());
+        for (auto &neuron : group.neurons)
+            scratch.neuron_refs.push_back({ &group, &neuron, scratch.neuron_refs.size() });
+    }
+    scratch.offsets.push_back(scratch.neuron_refs.size());
+    scratch.responses.resize(scratch.neuron_refs.size());
+    scratch.act_sums.resize(groups.size());
+    scratch.group_idx.resize(groups.size());
+    std::iota(scratch.group_idx.begin(), scratch.group_idx.end(), 0);
+
+    // responses of all neurons of all groups (written into contiguous scratch memory)
     std::for_each(
         std::execution::par,
-        neurons.begin(),neurons.end(),
-        [&](auto &neuron) {
-            out[neuron.id] = neuron.get_response(); // writing into out from different threads is a performance
-                                                    // problem as it is very cache unfriendly. This problem will go
-                                                    // away as soon as the parallelization moves up to the level
-                                                    // of the simulation.
+        scratch.neuron_refs.begin(), scratch.neuron_refs.end(),
+        [&scratch](const neuron_ref_t &ref) {
+            scratch.responses[ref.resp_idx] = ref.neuron->get_response();
         }
     );
 
+    // local inhibition and winner adaptation are independent per group
+    std::for_each(
+        std::execution::par,
+        scratch.group_idx.begin(), scratch.group_idx.end(),
+        [&scratch, groups](const std::size_t g_idx) {
+            neuron_group_t  &group = groups[g_idx];
+            std::span<float> out   = group.output_mem();
+            assert(out.size() == group.neurons.size());
+            const auto resp = scratch.responses.begin();
+            std::copy(resp + scratch.offsets[g_idx], resp + scratch.offsets[g_idx + 1], out.begin());
+            scratch.act_sums[g_idx] = group.inhibit_and_adapt_winner(out);
+        }
+    );
+
+    // secondary adaptation of all neurons of all groups
+    std::for_each(
+        std::execution::par,
+        scratch.neuron_refs.begin(), scratch.neuron_refs.end(),
+        [&scratch, groups](const neuron_ref_t &ref) {
+            neuron_group_t &group   = *ref.group;
+            if (group.frozen)
+                return;
+            const auto      g_idx   = static_cast<std::size_t>(&group - groups.data());
+            const float     act_sum = scratch.act_sums[g_idx];
+            ref.neuron->adapt(group.secondary_weight(group.output_mem(), ref.neuron->id, act_sum), group.branch_timing());
+        }
+    );
+
+    for (auto &group : groups)
+        group.sparsify_output(group.output_mem());
+}
+
+/*
+ * k-winners output mode (see params_t::k_winners), the adaptation above still uses the full activities
+ */
+void neuron_group_t::sparsify_output(std::span<float> out) const
+{
+    if (params.k_winners == 0 || params.k_winners >= out.size())
+        return;
+
+    static thread_local std::vector<std::size_t> order;
+    order.resize(out.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::nth_element(
+        order.begin(), order.begin() + static_cast<std::ptrdiff_t>(params.k_winners), order.end(),
+        [&](std::size_t a, std::size_t b) { return out[a] > out[b] || (out[a] == out[b] && a < b); }
+    );
+    for (auto it = order.begin() + static_cast<std::ptrdiff_t>(params.k_winners); it != order.end(); ++it)
+        out[*it] = 0.0f;
+}
+
+/*
+ * local inhibition and adaptation of the winning neuron (steps 1 to 3 below), returns the sum of the activities
+ * required for the secondary adaptation
+ */
+float neuron_group_t::inhibit_and_adapt_winner(std::span<float> out)
+{
     // simulate local inhibition within the neuron group
     // (defined in hd_ngm2_tools.h)
-    local_inhibition(out,local_inhibition_strength);
+    {
+        COAST_TIME_SCOPE(&phase_timings[phase_local_inhibition]);
+        local_inhibition(out,local_inhibition_strength);
+    }
+
+    // frozen groups neither adapt nor draw a winning threshold, i.e., their random state stays untouched
+    if (frozen)
+        return 0.0f;
 
     /*
      * Simulate the adaption of the neurons in the neuron group to the current input signal.
@@ -114,24 +258,22 @@ void neuron_group_t::process()
     float win_act = dis(rgen);
 
     // 3)
-    for (std::size_t idx = 0; idx < out.size(); ++idx)
-        if (out[idx] + std::numeric_limits<float>::epsilon() >= win_act) {
-            neurons[idx].adapt( sigmoid(1.0f - out[idx], weight_filter) );
-            break;
-        }
-
-    // 4)
-    const float act_sum = std::reduce(out.begin(),out.end());
-    std::for_each(
-        std::execution::par, // parallelization might move up to the simulation layer at some point
-        neurons.begin(), neurons.end(),
-        [&](auto &neuron) {
-            const float sec_weight = sigmoid(1.0f - (out[neuron.id] / act_sum), weight_filter);
-            neuron.adapt(sec_weight * common_learning_rate);
-        }
-    );
+    {
+        COAST_TIME_SCOPE(&phase_timings[phase_winner_adapt]);
+        for (std::size_t idx = 0; idx < out.size(); ++idx)
+            if (out[idx] + std::numeric_limits<float>::epsilon() >= win_act) {
+                neurons[idx].adapt( sigmoid(1.0f - out[idx], weight_filter), branch_timing() );
+                break;
+            }
+    }
 
+    return std::reduce(out.begin(),out.end());
+}
 
+// weight of the secondary adaptation (step 4) of a neuron
+float neuron_group_t::secondary_weight(std::span<const float> out, std::size_t idx, float act_sum) const
+{
+    return sigmoid(1.0f - (out[idx] / act_sum), weight_filter) * common_learning_rate;
 }
 
 // interface function that allows the simulation environment to query the output ID of this io entity
@@ -152,6 +294,13 @@ std::span<const std::size_t> neuron_group_t::get_inp_ids() const
     return { inp_ids.begin(), inp_ids.end() };
 }
 
+// interface function that allows the simulation environment to query the delay of an input
+std::size_t neuron_group_t::get_inp_delay(std::size_t id) const
+{
+    const auto it = params.input_delays.find(id);
+    return it == params.input_delays.end() ? 0 : it->second;
+}
+
 // interface function that can be used to report a status string to, e.g., the gui or a log
 std::string neuron_group_t::status_str() const
 {
@@ -167,6 +316,44 @@ std::string neuron_group_t::status_str() const
     return status;
 }
 
+// interface functions that allow the simulation environment to store and restore the state of this io entity
+void neuron_group_t::save_state(sim::checkpoint_writer &cw) const
+{
+    cw.write(local_inhibition_strength);
+    cw.write(common_learning_rate);
+    cw.write(weight_filter);
+    cw.write(stochastic_win_thres);
+    cw.write_rng(rgen);
+
+    cw.write<uint64_t>(neurons.size());
+    for (const auto &neuron : neurons)
+        neuron.save_state(cw);
+}
+
+bool neuron_group_t::load_state(sim::checkpoint_reader &cr)
+{
+    cr.read_into(local_inhibition_strength);
+    cr.read_into(common_learning_rate);
+    cr.read_into(weight_filter);
+    cr.read_into(stochastic_win_thres);
+    cr.read_rng(rgen);
+
+    if (cr.read<uint64_t>() != neurons.size()) {
+        std::fprintf(stderr, "neuron count in checkpoint does not match\n");
+        return false;
+    }
+    for (auto &neuron : neurons)
+        if (!neuron.load_state(cr))
+            return false;
+    return cr.good();
+}
+
+void neuron_group_t::mark_checkpointed()
+{
+    for (auto &neuron : neurons)
+        neuron.mark_checkpointed();
+}
+
 /*
  *  introspection functions used by, e.g., visualization components
  */
@@ -3,6 +3,7 @@
 #include <random>
 #include <string>
 #include <iostream>
+#include <filesystem>
 
 #include <raylib.h>
 
@@ -12,6 +13,7 @@
 #include "imgui.h"
 #include "mnist_io.h"
 #include "sim_env.h"
+#include "topology.h"
 #include "vec_ring_buffer.h"
 #include "ngm_flat_vis.h"
 #include "hd_ngm2_tools.h"
@@ -25,12 +27,16 @@ int main(int argc, char **argv)
     // check if program arguments were provided
     if (argc < 3) {
         std::cout << "Please provide MNIST training images and labes as 1st and 2nd parameter to the program.\n";
+        std::cout << "An optional 3rd parameter names a checkpoint file that is loaded at startup (if present) and saved on exit.\n";
+        std::cout << "An optional 4th parameter names a topology file (see cfg/mnist_3groups.json) that replaces the built-in network.\n";
         return -1;
     }
 
     // store program arguments
     const std::string mnist_image_file { argv[1] };
     const std::string mnist_label_file { argv[2] };
+    const std::string checkpoint_file  { argc > 3 ? argv[3] : "" };
+    const std::string topology_file    { argc > 4 ? argv[4] : "" };
 
     // set up simulation environment
     sim::env simulation_environment;
@@ -42,17 +48,57 @@ int main(int argc, char **argv)
      * receives the parameters that the respective entity constructor expects.
      * In case of the neuron group it is an extensive parameter structure that describes the neuron group parameterization.
      * To aid in that parameterization the service function basic_cng (see hd_ngm2/hd_ngm2_cfg.h) is used.
+     * Alternatively, the network is described by a topology file (see tools/topology.h) that is compiled into a plan
+     * and instantiated without recompiling. The visualizations below expect the mnist input (id 0) and three neuron
+     * groups (ids 1 to 3), as in cfg/mnist_3groups.json.
      */
-    simulation_environment.emplace_back<sim::mnist_io>(0, 15, mnist_image_file, mnist_label_file);
-    simulation_environment.emplace_back<neuron_group_t>( basic_cng(1, 50, 28*28,  {0}, 1025) );
-    simulation_environment.emplace_back<neuron_group_t>( basic_cng(2, 50, 100,{1,3}, 2025) );
-    simulation_environment.emplace_back<neuron_group_t>( basic_cng(3, 50, 100,{1,2}, 3025) );
+    if (topology_file.empty()) {
+        simulation_environment.emplace_back<sim::mnist_io>(0, 15, mnist_image_file, mnist_label_file);
+        simulation_environment.emplace_back<neuron_group_t>( basic_cng(1, 50, 28*28,  {0}, 1025) );
+        simulation_environment.emplace_back<neuron_group_t>( basic_cng(2, 50, 100,{1,3}, 2025) );
+        simulation_environment.emplace_back<neuron_group_t>( basic_cng(3, 50, 100,{1,2}, 3025) );
+
+        /*
+         * After setting up all entities, we ask the simulation environment to create and set up the io-buffers that
+         * facilitate the exchange between the different simulation entities
+         */
+        simulation_environment.init_io_buffers();
+
+        /*
+         * The mnist frames (image plus noise) are generated up to 64 steps ahead of the simulation on a background
+         * thread, such that the neuron groups do not have to wait for the input in each step.
+         */
+        simulation_environment.get_entities<sim::mnist_io>().value()->at(0).set_run_ahead(64);
+    } else {
+        auto plan = sim::compile_topology(
+            topology_file,
+            { {"mnist_images", mnist_image_file}, {"mnist_labels", mnist_label_file} }
+        );
+        if (!plan || !sim::instantiate_topology(simulation_environment, std::move(*plan))) {
+            std::cout << "Could not set up topology " << topology_file << "\n";
+            return -1;
+        }
+        const auto groups = simulation_environment.get_entities<neuron_group_t>();
+        if (!simulation_environment.get_entities<sim::mnist_io>() || !groups || groups.value()->size() < 3 ||
+            !simulation_environment.get_io_buffer(1) || !simulation_environment.get_io_buffer(2) ||
+            !simulation_environment.get_io_buffer(3))
+        {
+            std::cout << "The visualization requires an mnist input and three neuron groups with ids 1 to 3\n";
+            return -1;
+        }
+    }
 
     /*
-     * After setting up all entities, we ask the simulation environment to create and set up the io-buffers that
-     * facilitate the exchange between the different simulation entities
+     * If a checkpoint file was provided and exists, we restore the complete network state from it, i.e., the
+     * simulation continues exactly where the previous run stopped.
      */
-    simulation_environment.init_io_buffers();
+    if (!checkpoint_file.empty() && std::filesystem::exists(checkpoint_file)) {
+        if (!simulation_environment.load_checkpoint(checkpoint_file)) {
+            std::cout << "Could not load checkpoint " << checkpoint_file << "\n";
+            return -1;
+        }
+        std::cout << "Restored network state from " << checkpoint_file << "\n";
+    }
 
     /*
      * If we want to access the simulation entities directly, e.g., to couple them to UI-elements for visualization,
@@ -80,14 +126,19 @@ int main(int argc, char **argv)
     vec_ring_buffer vrb3 { static_cast<uint16_t>(simulation_environment.get_io_buffer(3).value()->size()), 750 };
 
     /*
-     * hooking the update functions of the three io-buffer visualizations to the post-process hook of the simulation
-     * process step. We use a lambda that captures vrb1, vrb2, ... by reference ([&])
+     * hooking the update functions of the three io-buffer visualizations to a batch hook of the simulation. The hook
+     * records the outputs of the neuron groups after every step and hands over the latest 750 steps (the width of the
+     * ring buffers) once per GUI-frame, such that each texture is uploaded only once per frame. We use a lambda that
+     * captures vrb1, vrb2, ... by reference ([&])
      */
-    simulation_environment.set_post_process_hook(
-        [&]() {
-            vrb1.update(simulation_environment.get_io_buffer(1).value()->cur_write_buffer(), false, 0.0f, 1.0f);
-            vrb2.update(simulation_environment.get_io_buffer(2).value()->cur_write_buffer(), false, 0.0f, 1.0f);
-            vrb3.update(simulation_environment.get_io_buffer(3).value()->cur_write_buffer(), false, 0.0f, 1.0f);
+    simulation_environment.set_batch_hook(
+        {1, 2, 3},
+        750,
+        sim::io_batch_recorder::mode_t::latest,
+        [&](const sim::io_batch &batch) {
+            vrb1.update_batch(batch.snapshots(0), batch.snapshot_cnt, false, 0.0f, 1.0f);
+            vrb2.update_batch(batch.snapshots(1), batch.snapshot_cnt, false, 0.0f, 1.0f);
+            vrb3.update_batch(batch.snapshots(2), batch.snapshot_cnt, false, 0.0f, 1.0f);
         }
     );
 
@@ -123,6 +174,7 @@ int main(int argc, char **argv)
                 simulation_environment.process();
                 simulation_environment.swap_io();
             }
+            simulation_environment.flush_batch_hooks();
             vis1.update();
             vis2.update();
             vis3.update();
@@ -179,14 +231,20 @@ int main(int argc, char **argv)
             ImGui::SliderFloat("1st local inhibition strength", &mnist_group.get_local_inhibition_strength(), 0.1, 20.0);
             ImGui::SliderFloat("2st local inhibition strength", &post_group.get_local_inhibition_strength(), 0.1, 20.0);
             ImGui::SliderFloat("3st local inhibition strength", &post_group2.get_local_inhibition_strength(), 0.1, 20.0);
+            if (!checkpoint_file.empty() && ImGui::Button("save checkpoint")) {
+                simulation_environment.save_checkpoint(checkpoint_file);
+            }
         }
     );
 
     /*
-     * Registering a function that performs some clean-up operations after the application window is closed.
+     * Registering a function that stores the network state (if a checkpoint file was given) and performs some
+     * clean-up operations after the application window is closed.
      */
     main_app.register_shutdown_func(
         [&]() {
+            if (!checkpoint_file.empty())
+                simulation_environment.save_checkpoint(checkpoint_file);
             vrb1.free_resources();
             vrb2.free_resources();
             vrb3.free_resources();
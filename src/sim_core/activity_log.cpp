@@ -0,0 +1,427 @@
+#include "activity_log.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <variant>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sim {
+
+namespace {
+
+constexpr std::size_t block_alignment = 8;
+constexpr std::size_t min_zero_run    = 4; // shorter zero runs are kept in the literals
+
+constexpr std::size_t align_up(std::size_t val) { return (val + block_alignment - 1) / block_alignment * block_alignment; }
+
+void put_varint(std::vector<std::byte> &dst, std::size_t val)
+{
+    while (val >= 0x80) {
+        dst.push_back(static_cast<std::byte>((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+    dst.push_back(static_cast<std::byte>(val));
+}
+
+bool get_varint(std::span<const std::byte> src, std::size_t &pos, std::size_t &val)
+{
+    val = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (pos >= src.size())
+            return false;
+        const auto byte = static_cast<uint8_t>(src[pos++]);
+        val |= static_cast<std::size_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+// converts a view into the recorded element type E
+template<class E>
+void store_as(const io_span_t &src, std::span<std::byte> dst)
+{
+    std::visit(
+        [&](const auto &sp) {
+            using src_t = std::remove_const_t<typename std::remove_cvref_t<decltype(sp)>::element_type>;
+            if constexpr (std::is_same_v<src_t, E>) {
+                std::memcpy(dst.data(), sp.data(), sp.size_bytes());
+            } else {
+                auto *out = reinterpret_cast<E*>(dst.data());
+                for (std::size_t i = 0; i < sp.size(); ++i)
+                    out[i] = from_float<E>(to_float(sp[i]));
+            }
+        },
+        src
+    );
+}
+
+void store(const io_span_t &src, io_elem_t elem, std::span<std::byte> dst)
+{
+    switch (elem) {
+        case io_elem_t::f16: store_as<half_t>(src, dst);  break;
+        case io_elem_t::u8:  store_as<uint8_t>(src, dst); break;
+        default:             store_as<float>(src, dst);   break;
+    }
+}
+
+} // namespace
+
+std::size_t rle_encode(std::span<const std::byte> src, std::span<const std::byte> prev, std::vector<std::byte> &dst)
+{
+    const std::size_t start = dst.size();
+    const std::size_t cnt   = src.size();
+    const bool        delta = !prev.empty();
+    const auto at = [&](std::size_t i) { return delta ? src[i] ^ prev[i] : src[i]; };
+
+    std::size_t i = 0;
+    while (i < cnt) {
+        const std::size_t zero_start = i;
+        while (i < cnt && at(i) == std::byte{0})
+            ++i;
+        const std::size_t lit_start = i;
+        while (i < cnt) {
+            if (at(i) != std::byte{0}) {
+                ++i;
+                continue;
+            }
+            std::size_t run_end = i;
+            while (run_end < cnt && at(run_end) == std::byte{0})
+                ++run_end;
+            if (run_end - i >= min_zero_run || run_end == cnt)
+                break;
+            i = run_end;
+        }
+        put_varint(dst, lit_start - zero_start);
+        put_varint(dst, i - lit_start);
+        for (std::size_t li = lit_start; li < i; ++li)
+            dst.push_back(at(li));
+    }
+    return dst.size() - start;
+}
+
+bool rle_decode(std::span<const std::byte> src, std::span<const std::byte> prev, std::span<std::byte> dst)
+{
+    const bool  delta = !prev.empty();
+    std::size_t pos   = 0;
+    std::size_t out   = 0;
+    while (out < dst.size()) {
+        std::size_t zeros = 0;
+        std::size_t lits  = 0;
+        if (!get_varint(src, pos, zeros) || !get_varint(src, pos, lits) ||
+            zeros + lits > dst.size() - out || lits > src.size() - pos)
+            return false;
+        for (const std::size_t end = out + zeros; out < end; ++out)
+            dst[out] = delta ? prev[out] : std::byte{0};
+        for (const std::size_t end = out + lits; out < end; ++out, ++pos)
+            dst[out] = delta ? prev[out] ^ src[pos] : src[pos];
+    }
+    return pos == src.size();
+}
+
+/*
+ * activity log writer
+ */
+bool activity_log_writer::reserve(std::size_t bytes)
+{
+    if (offset + bytes <= map_size)
+        return true;
+    const std::size_t new_size = std::max({ map_size * 2, offset + bytes, params.initial_size });
+    if (mapping != nullptr)
+        ::munmap(mapping, map_size);
+    mapping  = nullptr;
+    map_size = 0;
+    if (::ftruncate(fd, static_cast<off_t>(new_size)) == 0) {
+        void *ptr = ::mmap(nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) {
+            mapping  = static_cast<std::byte*>(ptr);
+            map_size = new_size;
+            return true;
+        }
+    }
+    std::fprintf(stderr, "could not grow the activity log to %zu bytes\n", new_size);
+    close();
+    return false;
+}
+
+void activity_log_writer::write_raw(const void *src, std::size_t bytes)
+{
+    std::memcpy(mapping + offset, src, bytes);
+    offset += bytes;
+}
+
+void activity_log_writer::pad()
+{
+    const std::size_t padded = align_up(offset);
+    std::memset(mapping + offset, 0, padded - offset);
+    offset = padded;
+}
+
+bool activity_log_writer::open(const std::string &file_name, std::span<const stream_t> stream_descs, const params_t &_params)
+{
+    close();
+    params = _params;
+    params.keyframe_interval = std::max<std::size_t>(params.keyframe_interval, 1);
+    params.initial_size      = std::max<std::size_t>(params.initial_size, 1 << 16);
+
+    fd = ::open(file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::fprintf(stderr, "could not open activity log %s for writing\n", file_name.c_str());
+        return false;
+    }
+    offset    = 0;
+    frame_cnt = 0;
+    raw_bytes = 0;
+    streams.clear();
+    for (const auto &desc : stream_descs) {
+        const std::size_t bytes = desc.size * io_elem_size(desc.elem);
+        streams.push_back({ desc, std::vector<std::byte>(bytes), std::vector<std::byte>(bytes) });
+    }
+
+    const std::size_t header_size = sizeof(activity_log_header_t) + streams.size() * sizeof(activity_log_stream_t);
+    if (!reserve(header_size))
+        return false;
+    const activity_log_header_t header {
+        activity_log_header_t::magic_value,
+        activity_log_header_t::version_value,
+        static_cast<uint32_t>(streams.size()),
+        static_cast<uint32_t>(params.keyframe_interval),
+        0
+    };
+    write_raw(&header, sizeof(header));
+    for (const auto &st : streams) {
+        const activity_log_stream_t desc { st.desc.id, st.desc.size, st.desc.elem, {} };
+        write_raw(&desc, sizeof(desc));
+    }
+    return true;
+}
+
+bool activity_log_writer::append(uint64_t step, std::span<const io_span_t> views)
+{
+    if (!is_open() || views.size() != streams.size())
+        return false;
+    for (std::size_t si = 0; si < streams.size(); ++si) {
+        if (io_span_size(views[si]) != streams[si].desc.size) {
+            std::fprintf(stderr, "activity log: size of stream %zu changed\n", streams[si].desc.id);
+            return false;
+        }
+    }
+
+    const bool        keyframe  = frame_cnt % params.keyframe_interval == 0;
+    const std::size_t frame_pos = offset;
+    if (!reserve(sizeof(activity_log_frame_t)))
+        return false;
+    offset += sizeof(activity_log_frame_t);
+
+    for (std::size_t si = 0; si < streams.size(); ++si) {
+        auto &st = streams[si];
+        store(views[si], st.desc.elem, st.cur);
+        raw_bytes += st.cur.size();
+
+        activity_log_block_t       block   { static_cast<uint32_t>(st.cur.size()), log_codec_t::raw, {} };
+        std::span<const std::byte> payload = st.cur;
+        if (params.compress) {
+            encoded.clear();
+            const std::size_t enc_size = rle_encode(st.cur, keyframe ? std::span<const std::byte>{} : std::span<const std::byte>(st.prev), encoded);
+            if (enc_size < st.cur.size()) {
+                block   = { static_cast<uint32_t>(enc_size), keyframe ? log_codec_t::rle : log_codec_t::delta_rle, {} };
+                payload = encoded;
+            }
+        }
+        if (!reserve(sizeof(block) + align_up(payload.size())))
+            return false;
+        write_raw(&block, sizeof(block));
+        write_raw(payload.data(), payload.size());
+        pad();
+        std::swap(st.prev, st.cur);
+    }
+
+    // the frame header is written last, i.e., incomplete frames are not visible to readers
+    const activity_log_frame_t frame {
+        activity_log_frame_t::magic_value,
+        static_cast<uint32_t>(offset - frame_pos - sizeof(activity_log_frame_t)),
+        step
+    };
+    std::memcpy(mapping + frame_pos, &frame, sizeof(frame));
+    ++frame_cnt;
+    return true;
+}
+
+void activity_log_writer::close()
+{
+    if (fd < 0)
+        return;
+    if (mapping != nullptr)
+        ::munmap(mapping, map_size);
+    if (::ftruncate(fd, static_cast<off_t>(offset)) != 0)
+        std::fprintf(stderr, "could not truncate the activity log\n");
+    ::close(fd);
+    fd       = -1;
+    mapping  = nullptr;
+    map_size = 0;
+}
+
+/*
+ * activity log reader
+ */
+bool activity_log_reader::open(const std::string &file_name)
+{
+    close();
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::fprintf(stderr, "could not open activity log %s\n", file_name.c_str());
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *ptr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            mapping  = static_cast<const std::byte*>(ptr);
+            map_size = static_cast<std::size_t>(st.st_size);
+        }
+    }
+    ::close(fd);
+
+    if (mapping != nullptr && map_size >= sizeof(header))
+        std::memcpy(&header, mapping, sizeof(header));
+    if (mapping == nullptr || map_size < sizeof(header) || header.magic != activity_log_header_t::magic_value ||
+        header.version != activity_log_header_t::version_value ||
+        map_size < sizeof(header) + header.stream_cnt * sizeof(activity_log_stream_t)) {
+        std::fprintf(stderr, "%s is not a valid activity log\n", file_name.c_str());
+        close();
+        return false;
+    }
+
+    std::size_t offset = sizeof(header);
+    streams.resize(header.stream_cnt);
+    for (auto &stream : streams) {
+        std::memcpy(&stream.desc, mapping + offset, sizeof(stream.desc));
+        offset += sizeof(stream.desc);
+        const std::size_t bytes = stream.desc.size * io_elem_size(stream.desc.elem);
+        stream.buf[0].resize(bytes);
+        stream.buf[1].resize(bytes);
+    }
+
+    // index of all complete frames
+    while (offset + sizeof(activity_log_frame_t) <= map_size) {
+        activity_log_frame_t frame {};
+        std::memcpy(&frame, mapping + offset, sizeof(frame));
+        if (frame.magic != activity_log_frame_t::magic_value || frame.bytes > map_size - offset - sizeof(frame))
+            break;
+        frame_offsets.push_back(offset);
+        offset += sizeof(frame) + frame.bytes;
+    }
+    return true;
+}
+
+void activity_log_reader::close()
+{
+    if (mapping != nullptr)
+        ::munmap(const_cast<std::byte*>(mapping), map_size);
+    mapping  = nullptr;
+    map_size = 0;
+    streams.clear();
+    frame_offsets.clear();
+    cur_frame = ~std::size_t{0};
+    cur_step  = 0;
+}
+
+std::size_t activity_log_reader::find_stream(std::size_t id) const
+{
+    const auto it = std::ranges::find_if(streams, [id](const stream_state_t &st) { return st.desc.id == id; });
+    return static_cast<std::size_t>(it - streams.begin());
+}
+
+// delta blocks are decoded against the current data of the streams, i.e., the previous frame has to be decoded
+bool activity_log_reader::decode_frame(std::size_t frame)
+{
+    const std::size_t frame_offset = frame_offsets[frame];
+    activity_log_frame_t frame_hdr {};
+    std::memcpy(&frame_hdr, mapping + frame_offset, sizeof(frame_hdr));
+    const std::size_t frame_end = frame_offset + sizeof(frame_hdr) + frame_hdr.bytes;
+
+    std::size_t offset = frame_offset + sizeof(frame_hdr);
+    for (auto &stream : streams) {
+        activity_log_block_t block {};
+        if (offset + sizeof(block) > frame_end)
+            return false;
+        std::memcpy(&block, mapping + offset, sizeof(block));
+        offset += sizeof(block);
+        if (offset + block.bytes > frame_end)
+            return false;
+        const std::span<const std::byte> payload { mapping + offset, block.bytes };
+        offset += align_up(block.bytes);
+
+        auto &dst = stream.buf[stream.cur_buf ^ 1];
+        switch (block.codec) {
+            case log_codec_t::raw:
+                if (payload.size() != dst.size())
+                    return false;
+                stream.data = payload;
+                continue;
+            case log_codec_t::rle:
+                if (!rle_decode(payload, {}, dst))
+                    return false;
+                break;
+            case log_codec_t::delta_rle:
+                if (stream.data.size() != dst.size() || !rle_decode(payload, stream.data, dst))
+                    return false;
+                break;
+            default:
+                return false;
+        }
+        stream.data     = dst;
+        stream.cur_buf ^= 1;
+    }
+    cur_frame = frame;
+    cur_step  = frame_hdr.step;
+    return true;
+}
+
+bool activity_log_reader::next()
+{
+    const std::size_t frame = cur_frame + 1; // wraps to 0 before the first frame
+    if (frame >= frame_offsets.size())
+        return false;
+    if (!decode_frame(frame)) {
+        std::fprintf(stderr, "corrupt frame %zu in activity log\n", frame);
+        return false;
+    }
+    return true;
+}
+
+bool activity_log_reader::seek(std::size_t frame)
+{
+    if (frame >= frame_offsets.size())
+        return false;
+    if (frame == cur_frame)
+        return true;
+    // continue from the current frame if possible, otherwise from the last keyframe
+    if (cur_frame == ~std::size_t{0} || frame < cur_frame || frame / header.keyframe_interval != cur_frame / header.keyframe_interval)
+        cur_frame = frame - frame % header.keyframe_interval - 1;
+    while (cur_frame != frame) {
+        if (!next())
+            return false;
+    }
+    return true;
+}
+
+io_span_t activity_log_reader::view(std::size_t stream) const
+{
+    const auto &st = streams[stream];
+    const auto  cnt = st.desc.size;
+    if (st.data.empty())
+        return std::span<const float>{};
+    switch (st.desc.elem) {
+        case io_elem_t::f16: return std::span<const half_t>(reinterpret_cast<const half_t*>(st.data.data()), cnt);
+        case io_elem_t::u8:  return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(st.data.data()), cnt);
+        default:             return std::span<const float>(reinterpret_cast<const float*>(st.data.data()), cnt);
+    }
+}
+
+} // sim
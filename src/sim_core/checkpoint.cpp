@@ -0,0 +1,198 @@
+#include "checkpoint.h"
+
+#include <array>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sim {
+
+/*
+ * checkpoint writer
+ */
+checkpoint_writer::checkpoint_writer(const std::string &_file_name, bool _delta) :
+    file      ( std::fopen(_file_name.c_str(), "wb") ),
+    file_name ( _file_name                           ),
+    offset    ( 0                                    ),
+    ok        ( file != nullptr                      ),
+    delta     ( _delta                               )
+{
+    if (!ok)
+        std::fprintf(stderr, "could not open checkpoint %s for writing\n", file_name.c_str());
+}
+
+checkpoint_writer::~checkpoint_writer()
+{
+    if (file)
+        std::fclose(file);
+}
+
+bool checkpoint_writer::close()
+{
+    if (file == nullptr)
+        return ok;
+
+    // buffered data is only written at the flush, hence errors like a full disk show up here
+    const bool flushed = std::fflush(file) == 0 && ::fsync(::fileno(file)) == 0;
+    const bool closed  = std::fclose(file) == 0;
+    file = nullptr;
+    if (ok && !(flushed && closed)) {
+        std::fprintf(stderr, "could not flush checkpoint %s\n", file_name.c_str());
+        ok = false;
+    }
+    return ok;
+}
+
+bool commit_checkpoint(const std::string &tmp_file_name, const std::string &file_name)
+{
+    if (std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+        std::fprintf(stderr, "could not move checkpoint to %s\n", file_name.c_str());
+        std::remove(tmp_file_name.c_str());
+        return false;
+    }
+
+    // the directory entry of the renamed file is only durable once the directory itself is synced
+    const auto        sep      = file_name.find_last_of('/');
+    const std::string dir_name = sep == std::string::npos ? "." : sep == 0 ? "/" : file_name.substr(0, sep);
+    const int         fd       = ::open(dir_name.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0 || ::fsync(fd) != 0)
+        std::fprintf(stderr, "warning: could not sync directory %s of checkpoint\n", dir_name.c_str());
+    if (fd >= 0)
+        ::close(fd);
+    return true;
+}
+
+void checkpoint_writer::write_raw(const void *data, std::size_t size)
+{
+    if (!ok || size == 0)
+        return;
+    if (std::fwrite(data, 1, size, file) != size) {
+        std::fprintf(stderr, "could not write checkpoint data\n");
+        ok = false;
+        return;
+    }
+    offset += size;
+}
+
+void checkpoint_writer::pad_to(std::size_t alignment)
+{
+    static constexpr std::array<uint8_t,array_alignment> zeros {};
+    const std::size_t padding = (alignment - offset % alignment) % alignment;
+    write_raw(zeros.data(), padding);
+}
+
+void checkpoint_writer::write_string(std::string_view str)
+{
+    write<uint64_t>(str.size());
+    write_raw(str.data(), str.size());
+}
+
+std::size_t checkpoint_writer::begin_record()
+{
+    const std::size_t record_start = offset;
+    write<uint64_t>(0);
+    return record_start;
+}
+
+void checkpoint_writer::end_record(std::size_t record_start)
+{
+    if (!ok)
+        return;
+    // the stored record size covers everything after the size field itself
+    const uint64_t record_size = offset - record_start - sizeof(uint64_t);
+    if (std::fseek(file, static_cast<long>(record_start), SEEK_SET) != 0 ||
+        std::fwrite(&record_size, sizeof(record_size), 1, file) != 1      ||
+        std::fseek(file, 0, SEEK_END) != 0)
+    {
+        std::fprintf(stderr, "could not finalize checkpoint record\n");
+        ok = false;
+    }
+}
+
+/*
+ * checkpoint reader
+ */
+checkpoint_reader::checkpoint_reader(const std::string &file_name) :
+    mapping  ( nullptr ),
+    map_size ( 0       ),
+    offset   ( 0       ),
+    ok       ( false   ),
+    delta    ( false   ),
+    version  ( checkpoint_header_t::cur_version )
+{
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::fprintf(stderr, "could not open checkpoint %s\n", file_name.c_str());
+        return;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *ptr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr != MAP_FAILED) {
+            mapping  = static_cast<const uint8_t*>(ptr);
+            map_size = static_cast<std::size_t>(st.st_size);
+            ok       = true;
+        }
+    }
+    ::close(fd);
+    if (!ok)
+        std::fprintf(stderr, "could not map checkpoint %s\n", file_name.c_str());
+}
+
+checkpoint_reader::~checkpoint_reader()
+{
+    if (mapping)
+        ::munmap(const_cast<uint8_t*>(mapping), map_size);
+}
+
+const uint8_t * checkpoint_reader::read_raw(std::size_t size)
+{
+    if (!ok || size > map_size - offset) {
+        ok = false;
+        return nullptr;
+    }
+    const uint8_t *src = mapping + offset;
+    offset += size;
+    return src;
+}
+
+void checkpoint_reader::skip_to(std::size_t alignment)
+{
+    read_raw((alignment - offset % alignment) % alignment);
+}
+
+std::string_view checkpoint_reader::read_string()
+{
+    const auto len = read<uint64_t>();
+    const uint8_t *src = read_raw(len);
+    if (src == nullptr)
+        return {};
+    return { reinterpret_cast<const char*>(src), len };
+}
+
+std::size_t checkpoint_reader::begin_record()
+{
+    const auto record_size = read<uint64_t>();
+    if (!ok || record_size > map_size - offset) {
+        ok = false;
+        return map_size;
+    }
+    return offset + record_size;
+}
+
+void checkpoint_reader::skip_record(std::size_t record_end)
+{
+    seek(record_end);
+}
+
+void checkpoint_reader::seek(std::size_t pos)
+{
+    if (!ok || pos > map_size) {
+        ok = false;
+        return;
+    }
+    offset = pos;
+}
+
+} // sim
@@ -0,0 +1,143 @@
+#include "external_input.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace sim {
+
+external_input::external_input(
+    std::size_t    _id,
+    std::size_t    _size,
+    std::size_t    queue_depth,
+    empty_policy_t _on_empty,
+    io_elem_t      _outp_elem
+) :
+    io_entity(),
+    id(_id),
+    size(_size),
+    on_empty(_on_empty),
+    outp_elem(_outp_elem),
+    last(_on_empty == empty_policy_t::repeat ? _size : 0, 0.0f),
+    port(std::make_unique<port_t>(std::max<std::size_t>(queue_depth, 1), _size))
+{}
+
+void external_input::set_outp_func(std::function<std::span<float>()> function)
+{
+    output_mem = std::move(function);
+}
+
+std::span<float> external_input::write_span()
+{
+    direct_written = true;
+    return output_mem();
+}
+
+std::span<float> external_input::try_acquire()
+{
+    if (closed())
+        return {};
+    std::vector<float> *frame = port->queue.write_slot();
+    if (frame == nullptr)
+        return {};
+    return *frame;
+}
+
+std::span<float> external_input::acquire(const std::stop_token &stoken)
+{
+    while (!stoken.stop_requested() && !closed()) {
+        if (std::vector<float> *frame = port->queue.write_slot())
+            return *frame;
+        port->queue.wait_writable(stoken);
+    }
+    return {};
+}
+
+void external_input::commit()
+{
+    port->queue.publish();
+}
+
+bool external_input::try_submit(std::span<const float> frame)
+{
+    if (frame.size() != size) {
+        std::fprintf(stderr, "frame size %zu does not match the size %zu of external input %zu\n", frame.size(), size, id);
+        return false;
+    }
+    const auto slot = try_acquire();
+    if (slot.empty())
+        return false;
+    std::ranges::copy(frame, slot.begin());
+    commit();
+    return true;
+}
+
+bool external_input::submit(std::span<const float> frame, const std::stop_token &stoken)
+{
+    if (frame.size() != size) {
+        std::fprintf(stderr, "frame size %zu does not match the size %zu of external input %zu\n", frame.size(), size, id);
+        return false;
+    }
+    const auto slot = acquire(stoken);
+    if (slot.empty())
+        return false;
+    std::ranges::copy(frame, slot.begin());
+    commit();
+    return true;
+}
+
+void external_input::close()
+{
+    port->closed.store(true, std::memory_order_release);
+    port->queue.wake();
+}
+
+void external_input::reopen()
+{
+    port->closed.store(false, std::memory_order_release);
+}
+
+void external_input::process()
+{
+    auto outp = output_mem();
+
+    // written in place by the host
+    if (direct_written) {
+        direct_written = false;
+        if (on_empty == empty_policy_t::repeat)
+            std::ranges::copy(outp, last.begin());
+        return;
+    }
+
+    const std::vector<float> *frame = port->queue.read_slot();
+    if (on_empty == empty_policy_t::block) {
+        while (frame == nullptr && !closed()) {
+            port->queue.wait_readable({});
+            frame = port->queue.read_slot();
+        }
+    }
+
+    if (frame != nullptr) {
+        std::ranges::copy(*frame, outp.begin());
+        if (on_empty == empty_policy_t::repeat)
+            std::ranges::copy(*frame, last.begin());
+        port->queue.release();
+        return;
+    }
+
+    ++missed_cnt;
+    if (on_empty == empty_policy_t::repeat)
+        std::ranges::copy(last, outp.begin());
+    else
+        std::ranges::fill(outp, 0.0f);
+}
+
+std::string external_input::status_str() const
+{
+    std::string status { "EXTERNAL INPUT" };
+    status += " | id: " + std::to_string(id);
+    status += " | pending: " + std::to_string(pending());
+    status += " | missed: " + std::to_string(missed_cnt);
+    return status;
+}
+
+} // sim
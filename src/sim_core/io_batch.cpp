@@ -0,0 +1,66 @@
+#include "io_batch.h"
+
+#include <algorithm>
+
+namespace sim {
+
+io_batch_recorder::io_batch_recorder(
+    std::vector<std::size_t>             buffer_ids,
+    std::vector<io_buffer*>              _buffers,
+    std::size_t                          _capacity,
+    mode_t                               _mode,
+    std::function<void(const io_batch&)> _func
+) :
+    mode      ( _mode                                ),
+    capacity  ( std::max<std::size_t>(_capacity, 1) ),
+    write_pos ( 0                                    ),
+    buffers   ( std::move(_buffers)                  ),
+    func      ( std::move(_func)                     )
+{
+    batch.buffer_ids = std::move(buffer_ids);
+    for (const io_buffer *buf : buffers) {
+        batch.buffer_sizes.push_back(buf->size());
+        batch.data.emplace_back(capacity * buf->size());
+    }
+}
+
+/*
+ * copies the current read slots of all observed buffers into the batch (decoded to float)
+ */
+void io_batch_recorder::record(std::size_t step)
+{
+    for (std::size_t bi = 0; bi < buffers.size(); ++bi) {
+        const std::span<float> dst { batch.data[bi].data() + write_pos * batch.buffer_sizes[bi], batch.buffer_sizes[bi] };
+        decode_into(buffers[bi]->cur_read_buffer(), dst);
+    }
+    write_pos          = (write_pos + 1) % capacity;
+    batch.snapshot_cnt = std::min(batch.snapshot_cnt + 1, capacity);
+    batch.last_step    = step;
+
+    if (mode == mode_t::on_full && batch.snapshot_cnt == capacity)
+        flush();
+}
+
+/*
+ * hands the recorded snapshots over to the observer function (oldest first) and starts a new batch
+ */
+void io_batch_recorder::flush()
+{
+    if (batch.snapshot_cnt == 0)
+        return;
+
+    // only a full ring that wrapped around needs to be brought into chronological order
+    if (batch.snapshot_cnt == capacity && write_pos != 0) {
+        for (std::size_t bi = 0; bi < buffers.size(); ++bi) {
+            auto &data = batch.data[bi];
+            std::rotate(data.begin(), data.begin() + write_pos * batch.buffer_sizes[bi], data.end());
+        }
+    }
+
+    func(batch);
+
+    write_pos          = 0;
+    batch.snapshot_cnt = 0;
+}
+
+} // sim
@@ -4,13 +4,14 @@
 
 #include <numeric>
 #include <algorithm>
+#include <cstdio>
 #include "hd_ngm2_tools.h"
 #include "io_buffer.h"
 
 namespace sim {
-void io_buffer::update_stats()
+io_buffer::stats io_buffer::compute_stats(std::span<const float> read_buf)
 {
-    std::span<const float> read_buf = cur_read_buffer();
+    stats read_buffer_stats {};
     read_buffer_stats.sum = std::reduce(read_buf.begin(),read_buf.end());
     read_buffer_stats.avg = read_buffer_stats.sum / static_cast<float>(read_buf.size());
     read_buffer_stats.min_val = std::reduce(
@@ -30,23 +31,207 @@ void io_buffer::update_stats()
         }
     );
     read_buffer_stats.nse = ngm2::normalized_shannon_entropy(read_buf);
+    return read_buffer_stats;
 }
 
-io_buffer::io_buffer(std::size_t size) :
-    buffer{ std::vector<float>(size), std::vector<float>(size) },
-    read_buffer_stats(),
+namespace {
+
+template<class E>
+std::vector<aligned_vector<E>> make_slots(std::size_t slot_cnt, std::size_t size)
+{
+    return std::vector<aligned_vector<E>>(slot_cnt, aligned_vector<E>(size));
+}
+
+} // namespace
+
+io_buffer::io_buffer(std::size_t size, std::size_t slot_cnt, io_elem_t elem) :
+    elem_cnt(size),
+    slot_count(std::clamp<std::size_t>(slot_cnt, 2, max_slot_cnt)),
+    slot_stats(slot_count),
     write_idx(0),
-    read_idx(1)
-{}
+    read_idx(static_cast<uint8_t>(slot_count - 1)),
+    sparse(false)
+{
+    if (slot_cnt > max_slot_cnt) {
+        std::fprintf(stderr,"io_buffer slot count exceeds %zu!\n", max_slot_cnt);
+        std::terminate();
+    }
+    switch (elem) {
+        case io_elem_t::f32: buffer = make_slots<float>(slot_count, size);   break;
+        case io_elem_t::f16: buffer = make_slots<half_t>(slot_count, size);  break;
+        case io_elem_t::u8:  buffer = make_slots<uint8_t>(slot_count, size); break;
+    }
+    if (elem != io_elem_t::f32)
+        staging.resize(size);
+}
+
+/*
+ * makes the write slot readable. Reduced precision slots are encoded from the staging slot, which in turn is replaced
+ * by the decoded values such that the stats and the sparse view reflect the quantized values.
+ */
+void io_buffer::swap_buffer()
+{
+    read_idx  =  write_idx;
+    write_idx = (write_idx + 1) % slot_count;
+
+    std::span<const float> values;
+    if (auto *slots = std::get_if<slots_t<float>>(&buffer)) {
+        values = (*slots)[read_idx];
+    } else {
+        std::visit(
+            [&]<class E>(slots_t<E> &slots) {
+                auto &slot = slots[read_idx];
+                for (std::size_t i = 0; i < elem_cnt; ++i) {
+                    slot[i]    = from_float<E>(staging[i]);
+                    staging[i] = to_float(slot[i]);
+                }
+            },
+            buffer
+        );
+        values = staging;
+    }
+    slot_stats[read_idx] = compute_stats(values);
+    if (sparse)
+        gather_sparse(read_idx, values);
+}
+
+io_span_t io_buffer::slot_view(std::size_t slot) const
+{
+    return std::visit(
+        [slot](const auto &slots) -> io_span_t {
+            return std::span { slots[slot].data(), slots[slot].size() };
+        },
+        buffer
+    );
+}
+
+std::vector<float> io_buffer::decoded_slot(std::size_t slot) const
+{
+    std::vector<float> values(elem_cnt);
+    decode_into(slot_view(slot), values);
+    return values;
+}
+
+std::function<io_buffer::inp_buf_t()> io_buffer::inp_buffer_func(std::size_t delay)
+{
+    if (delay > max_delay()) {
+        std::fprintf(stderr,"io_buffer delay exceeds the number of slots!\n");
+        std::terminate();
+    }
+    if (delay == 0) {
+        return [this]() -> inp_buf_t {
+            return { slot_view(read_idx), slot_stats[read_idx] };
+        };
+    }
+    return [this,delay]() -> inp_buf_t {
+        const std::size_t idx = delayed_idx(delay);
+        return { slot_view(idx), slot_stats[idx] };
+    };
+}
+
+void io_buffer::gather_sparse(std::size_t slot, std::span<const float> values)
+{
+    auto &idx = sparse_idx[slot];
+    auto &val = sparse_val[slot];
+    idx.clear();
+    val.clear();
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (values[i] != 0.0f) {
+            idx.push_back(static_cast<uint32_t>(i));
+            val.push_back(values[i]);
+        }
+    }
+}
+
+std::function<io_buffer::sparse_inp_t()> io_buffer::sparse_inp_func(std::size_t delay)
+{
+    if (delay > max_delay()) {
+        std::fprintf(stderr,"io_buffer delay exceeds the number of slots!\n");
+        std::terminate();
+    }
+    if (!sparse) {
+        sparse = true;
+        sparse_idx.resize(slot_count);
+        sparse_val.resize(slot_count);
+        for (std::size_t slot = 0; slot < slot_count; ++slot)
+            gather_sparse(slot, decoded_slot(slot));
+    }
+    return [this,delay]() -> sparse_inp_t {
+        const std::size_t idx = delayed_idx(delay);
+        return { sparse_idx[idx], sparse_val[idx], elem_cnt, slot_stats[idx] };
+    };
+}
 
 std::span<float> io_buffer::cur_write_buffer()
 {
-    return { buffer[write_idx].begin(), buffer[write_idx].end() };
+    if (auto *slots = std::get_if<slots_t<float>>(&buffer))
+        return (*slots)[write_idx];
+    return staging;
 }
 
-std::span<const float> io_buffer::cur_read_buffer()
+io_span_t io_buffer::cur_read_buffer() const
 {
-    return { buffer[read_idx].begin(), buffer[read_idx].end() };
+    return slot_view(read_idx);
+}
+
+io_span_t io_buffer::delayed_read_buffer(std::size_t delay) const
+{
+    return slot_view(delayed_idx(delay));
+}
+
+/*
+ * the slots are always stored as floats, i.e., the checkpoint format does not depend on the element type (decoded
+ * values are encoded losslessly)
+ */
+void io_buffer::save_state(checkpoint_writer &cw) const
+{
+    cw.write<uint64_t>(slot_count);
+    for (std::size_t slot = 0; slot < slot_count; ++slot) {
+        if (const auto *slots = std::get_if<slots_t<float>>(&buffer))
+            cw.write_array((*slots)[slot]);
+        else
+            cw.write_array(decoded_slot(slot));
+    }
+    cw.write(slot_stats[read_idx]);
+    cw.write(write_idx);
+    cw.write(read_idx);
+}
+
+bool io_buffer::load_state(checkpoint_reader &cr)
+{
+    if (cr.read<uint64_t>() != slot_count) {
+        std::fprintf(stderr, "io_buffer slot count in checkpoint does not match\n");
+        return false;
+    }
+    for (std::size_t slot = 0; slot < slot_count; ++slot) {
+        const auto arr = cr.read_array<float>();
+        if (arr.size() != elem_cnt) {
+            std::fprintf(stderr, "io_buffer size in checkpoint does not match\n");
+            return false;
+        }
+        std::visit(
+            [&]<class E>(slots_t<E> &slots) {
+                std::ranges::transform(arr, slots[slot].begin(), [](const float val) { return from_float<E>(val); });
+            },
+            buffer
+        );
+    }
+    const auto read_stats = cr.read<stats>();
+    cr.read_into(write_idx);
+    cr.read_into(read_idx);
+    if (write_idx >= slot_count || read_idx >= slot_count) {
+        std::fprintf(stderr, "io_buffer slot index in checkpoint is out of range\n");
+        return false;
+    }
+    // the stats of the delayed slots are a pure function of their content, only the read slot stats are stored
+    for (std::size_t idx = 0; idx < slot_count; ++idx) {
+        const auto values = decoded_slot(idx);
+        slot_stats[idx] = compute_stats(values);
+        if (sparse)
+            gather_sparse(idx, values);
+    }
+    slot_stats[read_idx] = read_stats;
+    return cr.good();
 }
 
 } // sim
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "output_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sim {
+
+namespace {
+
+// calls func with a value of the element type of elem (the value itself is not used)
+template<class F>
+void visit_elem(io_elem_t elem, F &&func)
+{
+    switch (elem) {
+        case io_elem_t::f16: func(half_t{});  break;
+        case io_elem_t::u8:  func(uint8_t{}); break;
+        default:             func(float{});   break;
+    }
+}
+
+} // namespace
+
+output_cache::output_cache(std::size_t _size, std::size_t _sparsity, io_elem_t _elem, std::size_t max_bytes) :
+    size(_size),
+    sparsity(0),
+    elem(_elem),
+    stride((_size * io_elem_size(_elem) + 7) / 8 * 8)
+{
+    // the sparse layout is only used if it actually saves memory
+    const std::size_t sparse_stride = (sizeof(uint32_t) + _sparsity * (sizeof(uint32_t) + io_elem_size(_elem)) + 7) / 8 * 8;
+    if (_sparsity > 0 && sparse_stride < stride) {
+        sparsity = _sparsity;
+        stride   = sparse_stride;
+    }
+    max_entries = stride > 0 ? max_bytes / stride : 0;
+}
+
+bool output_cache::load(uint64_t key, std::span<float> outp)
+{
+    const auto it = index.find(key);
+    if (it == index.end()) {
+        ++misses;
+        return false;
+    }
+    ++hits;
+    const std::byte *entry = arena.data() + static_cast<std::size_t>(it->second) * stride;
+    visit_elem(elem, [&]<class E>(E) {
+        if (sparsity == 0) {
+            const auto *vals = reinterpret_cast<const E*>(entry);
+            std::transform(vals, vals + size, outp.begin(), [](const E val) { return to_float(val); });
+            return;
+        }
+        uint32_t cnt;
+        std::memcpy(&cnt, entry, sizeof(cnt));
+        const auto *idx  = reinterpret_cast<const uint32_t*>(entry + sizeof(uint32_t));
+        const auto *vals = reinterpret_cast<const E*>(entry + sizeof(uint32_t) * (1 + sparsity));
+        std::ranges::fill(outp, 0.0f);
+        for (uint32_t i = 0; i < cnt; ++i)
+            outp[idx[i]] = to_float(vals[i]);
+    });
+    return true;
+}
+
+void output_cache::store(uint64_t key, std::span<const float> outp)
+{
+    if (index.size() >= max_entries || outp.size() != size || index.contains(key))
+        return;
+
+    // outputs with more non-zero elements than announced are not stored
+    if (sparsity > 0 && static_cast<std::size_t>(std::ranges::count_if(outp, [](float val) { return val != 0.0f; })) > sparsity)
+        return;
+
+    const std::size_t entry_idx = index.size();
+    arena.resize(arena.size() + stride);
+    std::byte *entry = arena.data() + entry_idx * stride;
+    visit_elem(elem, [&]<class E>(E) {
+        if (sparsity == 0) {
+            auto *vals = reinterpret_cast<E*>(entry);
+            std::ranges::transform(outp, vals, [](const float val) { return from_float<E>(val); });
+            return;
+        }
+        auto    *idx  = reinterpret_cast<uint32_t*>(entry + sizeof(uint32_t));
+        auto    *vals = reinterpret_cast<E*>(entry + sizeof(uint32_t) * (1 + sparsity));
+        uint32_t cnt  = 0;
+        for (std::size_t i = 0; i < outp.size(); ++i) {
+            if (outp[i] == 0.0f)
+                continue;
+            idx[cnt]  = static_cast<uint32_t>(i);
+            vals[cnt] = from_float<E>(outp[i]);
+            ++cnt;
+        }
+        std::memcpy(entry, &cnt, sizeof(cnt));
+    });
+    index.emplace(key, static_cast<uint32_t>(entry_idx));
+}
+
+void output_cache::clear()
+{
+    arena.clear();
+    arena.shrink_to_fit();
+    index.clear();
+    hits   = 0;
+    misses = 0;
+}
+
+} // sim
@@ -0,0 +1,133 @@
+#include "output_tap.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+
+namespace sim {
+
+output_tap::output_tap(
+    std::size_t                       _id,
+    std::vector<std::size_t>          _inp_ids,
+    std::size_t                       _input_size,
+    std::size_t                       queue_depth,
+    std::map<std::size_t,std::size_t> _inp_delays
+) :
+    io_entity(),
+    id(_id),
+    input_size(_input_size),
+    inp_ids(std::move(_inp_ids)),
+    inp_delays(std::move(_inp_delays)),
+    inp_funcs(inp_ids.size()),
+    views(inp_ids.size()),
+    port(queue_depth > 0 ? std::make_unique<port_t>(queue_depth, _input_size) : nullptr)
+{}
+
+std::size_t output_tap::inp_idx(std::size_t inp_id) const
+{
+    const auto it = std::ranges::find(inp_ids, inp_id);
+    if (it == inp_ids.end()) {
+        std::fprintf(stderr, "output tap %zu has no input %zu\n", id, inp_id);
+        std::terminate();
+    }
+    return static_cast<std::size_t>(it - inp_ids.begin());
+}
+
+void output_tap::set_inp_func(std::size_t inp_id, const std::function<io_buffer::inp_buf_t()> &func)
+{
+    inp_funcs[inp_idx(inp_id)] = func;
+}
+
+std::size_t output_tap::get_inp_delay(std::size_t inp_id) const
+{
+    const auto it = inp_delays.find(inp_id);
+    return it == inp_delays.end() ? 0 : it->second;
+}
+
+io_span_t output_tap::view(std::size_t inp_id) const
+{
+    return std::get<0>(inp_funcs[inp_idx(inp_id)]());
+}
+
+void output_tap::process()
+{
+    ++step_cnt;
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < inp_funcs.size(); ++i) {
+        views[i] = std::get<0>(inp_funcs[i]());
+        total   += io_span_size(views[i]);
+    }
+    if (total != input_size) {
+        std::fprintf(stderr, "input size %zu of output tap %zu does not match the size of its inputs (%zu)\n",
+            input_size, id, total);
+        std::terminate();
+    }
+
+    if (callback)
+        callback(step_cnt, views);
+
+    if (!port)
+        return;
+    frame_t *frame = port->queue.write_slot();
+    if (frame == nullptr) {
+        port->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::size_t offset = 0;
+    for (const auto &view : views) {
+        decode_into(view, std::span(frame->data).subspan(offset));
+        offset += io_span_size(view);
+    }
+    frame->step = step_cnt;
+    port->queue.publish();
+}
+
+bool output_tap::try_pop(std::span<float> dst, uint64_t *step)
+{
+    if (!port)
+        return false;
+    const frame_t *frame = port->queue.read_slot();
+    if (frame == nullptr)
+        return false;
+    std::ranges::copy(std::span(frame->data).first(std::min(dst.size(), input_size)), dst.begin());
+    if (step != nullptr)
+        *step = frame->step;
+    port->queue.release();
+    return true;
+}
+
+bool output_tap::pop(std::span<float> dst, const std::stop_token &stoken, uint64_t *step)
+{
+    if (!port)
+        return false;
+    while (!stoken.stop_requested()) {
+        if (try_pop(dst, step))
+            return true;
+        if (port->closed.load(std::memory_order_acquire))
+            return false;
+        port->queue.wait_readable(stoken);
+    }
+    return false;
+}
+
+void output_tap::close()
+{
+    if (!port)
+        return;
+    port->closed.store(true, std::memory_order_release);
+    port->queue.wake();
+}
+
+std::string output_tap::status_str() const
+{
+    std::string status { "OUTPUT TAP" };
+    status += " | id: " + std::to_string(id);
+    status += " | step: " + std::to_string(step_cnt);
+    if (port) {
+        status += " | queued: " + std::to_string(port->queue.size());
+        status += " | dropped: " + std::to_string(get_dropped_cnt());
+    }
+    return status;
+}
+
+} // sim
@@ -0,0 +1,169 @@
+#include "recorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+
+namespace sim {
+
+namespace {
+
+std::span<const std::byte> as_bytes(const io_span_t &view)
+{
+    return std::visit([](const auto &sp) { return std::as_bytes(sp); }, view);
+}
+
+// view of native bytes as the given element type
+io_span_t as_view(const std::byte *data, std::size_t cnt, io_elem_t elem)
+{
+    switch (elem) {
+        case io_elem_t::f16: return std::span<const half_t>(reinterpret_cast<const half_t*>(data), cnt);
+        case io_elem_t::u8:  return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(data), cnt);
+        default:             return std::span<const float>(reinterpret_cast<const float*>(data), cnt);
+    }
+}
+
+} // namespace
+
+void recorder::sink_t::write_frames(const std::stop_token &stoken)
+{
+    std::vector<io_span_t> frame_views(elems.size());
+    while (true) {
+        frame_t *frame = queue.read_slot();
+        if (frame == nullptr) {
+            // the queue is drained before the thread terminates
+            if (stoken.stop_requested())
+                return;
+            queue.wait_readable(stoken);
+            continue;
+        }
+        for (std::size_t i = 0; i < elems.size(); ++i)
+            frame_views[i] = as_view(frame->data.data() + offsets[i], sizes[i], elems[i]);
+        if (writer.append(frame->step, frame_views)) {
+            frames_written.store(writer.get_frame_cnt(), std::memory_order_relaxed);
+            bytes_written.store(writer.get_size(), std::memory_order_relaxed);
+            raw_bytes.store(writer.get_raw_size(), std::memory_order_relaxed);
+        }
+        queue.release();
+    }
+}
+
+void recorder::sink_t::finish()
+{
+    if (thread.joinable()) {
+        thread.request_stop();
+        queue.wake();
+        thread.join();
+    }
+    writer.close();
+}
+
+recorder::recorder(
+    std::size_t              _id,
+    std::vector<std::size_t> _inp_ids,
+    std::string              _file_name,
+    recorder_params_t        _params
+) :
+    io_entity(),
+    id(_id),
+    inp_ids(std::move(_inp_ids)),
+    inp_funcs(inp_ids.size()),
+    views(inp_ids.size()),
+    file_name(std::move(_file_name)),
+    params(_params)
+{}
+
+void recorder::set_inp_func(std::size_t inp_id, const std::function<io_buffer::inp_buf_t()> &func)
+{
+    const auto it = std::ranges::find(inp_ids, inp_id);
+    if (it == inp_ids.end()) {
+        std::fprintf(stderr, "recorder %zu has no input %zu\n", id, inp_id);
+        std::terminate();
+    }
+    inp_funcs[static_cast<std::size_t>(it - inp_ids.begin())] = func;
+}
+
+// opens the log with the sizes and element types of the current views and starts the writer thread
+bool recorder::start()
+{
+    std::vector<activity_log_writer::stream_t> streams;
+    std::vector<io_elem_t>                     elems;
+    std::vector<std::size_t>                   sizes;
+    std::vector<std::size_t>                   offsets;
+    std::size_t                                frame_bytes = 0;
+    for (std::size_t i = 0; i < views.size(); ++i) {
+        const auto elem = static_cast<io_elem_t>(views[i].index());
+        const auto size = io_span_size(views[i]);
+        streams.push_back({ inp_ids[i], size, params.elem.value_or(elem) });
+        elems.push_back(elem);
+        sizes.push_back(size);
+        offsets.push_back(frame_bytes);
+        frame_bytes += (size * io_elem_size(elem) + 7) / 8 * 8; // keeps every input aligned
+    }
+
+    sink = std::make_unique<sink_t>(params.queue_depth, frame_bytes);
+    const activity_log_writer::params_t log_params { params.compress, params.keyframe_interval };
+    if (!sink->writer.open(file_name, streams, log_params)) {
+        sink.reset();
+        return false;
+    }
+    sink->elems   = std::move(elems);
+    sink->sizes   = std::move(sizes);
+    sink->offsets = std::move(offsets);
+    sink->thread  = std::jthread([s = sink.get()](const std::stop_token &stoken) { s->write_frames(stoken); });
+    return true;
+}
+
+void recorder::process()
+{
+    ++step_cnt;
+    if (closed)
+        return;
+    for (std::size_t i = 0; i < inp_funcs.size(); ++i)
+        views[i] = std::get<0>(inp_funcs[i]());
+
+    if (!sink && !start()) {
+        closed = true;
+        return;
+    }
+
+    frame_t *frame = sink->queue.write_slot();
+    if (frame == nullptr) {
+        ++stall_cnt;
+        do {
+            sink->queue.wait_writable({});
+        } while ((frame = sink->queue.write_slot()) == nullptr);
+    }
+    for (std::size_t i = 0; i < views.size(); ++i) {
+        const auto bytes = as_bytes(views[i]);
+        std::memcpy(frame->data.data() + sink->offsets[i], bytes.data(), bytes.size());
+    }
+    frame->step = step_cnt;
+    sink->queue.publish();
+}
+
+void recorder::close()
+{
+    closed = true;
+    if (sink)
+        sink->finish();
+}
+
+std::string recorder::status_str() const
+{
+    std::string status { "RECORDER" };
+    status += " | id: " + std::to_string(id);
+    status += " | frames: " + std::to_string(get_frame_cnt());
+    if (sink) {
+        const auto bytes = sink->bytes_written.load(std::memory_order_relaxed);
+        const auto raw   = sink->raw_bytes.load(std::memory_order_relaxed);
+        status += " | size: " + std::to_string(bytes >> 10) + " kB";
+        if (bytes > 0)
+            status += " | ratio: " + std::to_string(static_cast<double>(raw) / static_cast<double>(bytes)).substr(0, 4);
+    }
+    status += " | stalls: " + std::to_string(stall_cnt);
+    return status;
+}
+
+} // sim
@@ -0,0 +1,76 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace sim {
+
+replay::replay(std::size_t _id, std::string _file_name, bool _loop, std::optional<std::size_t> stream_id) :
+    io_entity(),
+    id(_id),
+    file_name(std::move(_file_name)),
+    loop(_loop),
+    reader(std::make_unique<activity_log_reader>(file_name)),
+    stream_idx(reader->find_stream(stream_id.value_or(_id)))
+{
+    if (reader->is_open() && !is_valid())
+        std::fprintf(stderr, "activity log %s does not hold a stream of entity %zu\n", file_name.c_str(), stream_id.value_or(_id));
+}
+
+void replay::set_outp_func(std::function<std::span<float>()> function)
+{
+    output_mem = function;
+}
+
+std::size_t replay::get_outp_size() const
+{
+    return is_valid() ? reader->get_stream(stream_idx).size : 0;
+}
+
+io_elem_t replay::get_outp_elem_type() const
+{
+    return is_valid() ? reader->get_stream(stream_idx).elem : io_elem_t::f32;
+}
+
+void replay::process()
+{
+    auto outp = output_mem();
+    if (next_frame >= reader->get_frame_cnt() && loop && reader->get_frame_cnt() > 1) {
+        next_frame = 1;
+        ++pass;
+    }
+    if (next_frame >= reader->get_frame_cnt() || !reader->seek(next_frame)) {
+        std::ranges::fill(outp, 0.0f);
+        return;
+    }
+    decode_into(reader->view(stream_idx), outp);
+    ++next_frame;
+}
+
+std::string replay::status_str() const
+{
+    std::string status { "REPLAY" };
+    status += " | id: " + std::to_string(id);
+    status += " | frame: " + std::to_string(next_frame) + "/" + std::to_string(reader->get_frame_cnt());
+    status += " | pass: " + std::to_string(pass);
+    return status;
+}
+
+void replay::save_state(checkpoint_writer &cw) const
+{
+    cw.write<uint64_t>(next_frame);
+    cw.write<uint64_t>(pass);
+}
+
+bool replay::load_state(checkpoint_reader &cr)
+{
+    next_frame = cr.read<uint64_t>();
+    pass       = cr.read<uint64_t>();
+    if (next_frame > reader->get_frame_cnt()) {
+        std::fprintf(stderr, "replay position in checkpoint exceeds the activity log %s\n", file_name.c_str());
+        return false;
+    }
+    return cr.good();
+}
+
+} // sim
@@ -0,0 +1,155 @@
+#include "sim_alloc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace sim {
+
+namespace {
+
+std::atomic<bool> use_huge_pages {false};
+
+thread_local arena *cur_arena = nullptr;
+
+constexpr std::size_t round_up(std::size_t val, std::size_t align)
+{
+    return (val + align - 1) / align * align;
+}
+
+// the alignment only depends on the size, such that deallocations do not depend on the current settings
+constexpr std::size_t heap_alignment(std::size_t bytes)
+{
+    return bytes >= huge_page_size ? huge_page_size : alloc_alignment;
+}
+
+void advise_huge_pages([[maybe_unused]] void *ptr, [[maybe_unused]] std::size_t bytes)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+}
+
+} // namespace
+
+void set_huge_pages(bool enable)
+{
+    use_huge_pages.store(enable, std::memory_order_relaxed);
+}
+
+bool huge_pages_enabled()
+{
+    return use_huge_pages.load(std::memory_order_relaxed);
+}
+
+void* allocate_aligned(std::size_t bytes, arena *src)
+{
+    if (src != nullptr)
+        return src->allocate(bytes);
+
+    const std::size_t align = heap_alignment(bytes);
+    const std::size_t size  = round_up(std::max<std::size_t>(bytes, 1), align);
+    void *ptr = ::operator new(size, std::align_val_t{align});
+    if (align == huge_page_size && huge_pages_enabled())
+        advise_huge_pages(ptr, size);
+    return ptr;
+}
+
+void deallocate_aligned(void *ptr, std::size_t bytes, arena *src) noexcept
+{
+    if (src != nullptr)
+        return; // released with the arena
+    const std::size_t align = heap_alignment(bytes);
+    ::operator delete(ptr, round_up(std::max<std::size_t>(bytes, 1), align), std::align_val_t{align});
+}
+
+arena::arena(std::size_t chunk_size, bool huge_tlb) :
+    chunk_size(round_up(std::max(chunk_size, huge_page_size), huge_page_size)),
+    huge_tlb(huge_tlb)
+{}
+
+arena::~arena()
+{
+    for (const auto &chunk : chunks) {
+#if defined(__linux__)
+        munmap(chunk.base, chunk.size);
+#else
+        ::operator delete(chunk.base, std::align_val_t{huge_page_size});
+#endif
+    }
+}
+
+void arena::add_chunk(std::size_t min_size)
+{
+    const std::size_t size = round_up(std::max(min_size, chunk_size), huge_page_size);
+    void *ptr = nullptr;
+#if defined(__linux__)
+#if defined(MAP_HUGETLB)
+    // explicit huge pages require a preallocated pool (vm.nr_hugepages), fall back to transparent huge pages
+    if (huge_tlb) {
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED)
+            ptr = nullptr;
+    }
+#endif
+    if (ptr == nullptr) {
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::bad_alloc();
+        advise_huge_pages(ptr, size);
+    }
+#else
+    ptr = ::operator new(size, std::align_val_t{huge_page_size});
+#endif
+    chunks.push_back({ static_cast<std::byte*>(ptr), size, 0 });
+}
+
+void* arena::allocate(std::size_t bytes)
+{
+    const std::size_t size = round_up(std::max<std::size_t>(bytes, 1), alloc_alignment);
+    std::lock_guard lock { mtx };
+    if (chunks.empty() || chunks.back().size - chunks.back().used < size)
+        add_chunk(size);
+    auto &chunk = chunks.back();
+    void *ptr = chunk.base + chunk.used;
+    chunk.used += size;
+    return ptr;
+}
+
+std::size_t arena::used_bytes() const
+{
+    std::size_t sum = 0;
+    for (const auto &chunk : chunks)
+        sum += chunk.used;
+    return sum;
+}
+
+std::size_t arena::reserved_bytes() const
+{
+    std::size_t sum = 0;
+    for (const auto &chunk : chunks)
+        sum += chunk.size;
+    return sum;
+}
+
+arena* arena::current()
+{
+    return cur_arena;
+}
+
+arena_scope::arena_scope(arena &a) :
+    prev(cur_arena)
+{
+    cur_arena = &a;
+}
+
+arena_scope::~arena_scope()
+{
+    cur_arena = prev;
+}
+
+} // sim
@@ -4,36 +4,78 @@
 
 #include <ranges>
 #include <cstdio>
+#include <algorithm>
+#include <typeinfo>
+#include <random>
+#include <execution>
+#include <unordered_set>
 
 #include "sim_env.h"
 
 namespace sim {
-void env::init_io_buffers()
+void connect_io_buffers(std::unordered_map<std::size_t,io_buffer> &io_buffers, const std::vector<io_entity*> &entities)
 {
-    // construct buffers and set output functions
-    for (auto &io_ent : iterate_entities()) {
-        const std::size_t id = io_ent.get_outp_id();
-        auto [buf_it,success] = io_buffers.emplace(id, io_buffer(io_ent.get_outp_size()));
-        if (success == false) {
+    // gather the maximum delay of each output, which determines the number of slots of the respective buffer
+    std::unordered_map<std::size_t,std::size_t> max_delays;
+    for (const io_entity *io_ent : entities) {
+        for (auto inp_id : io_ent->get_inp_ids()) {
+            auto &max_delay = max_delays[inp_id];
+            max_delay = std::max(max_delay, io_ent->get_inp_delay(inp_id));
+        }
+    }
+    // construct buffers and set output functions, sinks without an output (e.g., output taps) do not get a buffer
+    std::unordered_set<std::size_t> ids;
+    for (io_entity *io_ent : entities) {
+        const std::size_t id = io_ent->get_outp_id();
+        if (!ids.insert(id).second) {
             std::fprintf(stderr,"duplicate io_entity ID!\n");
             std::terminate();
         }
-        io_ent.set_outp_func(buf_it->second.outp_buffer_func());
+        if (io_ent->get_outp_size() == 0)
+            continue;
+        const auto delay_it  = max_delays.find(id);
+        const std::size_t slot_cnt = delay_it == max_delays.end() ? 2 : delay_it->second + 2;
+        auto buf_it = io_buffers.emplace(id, io_buffer(io_ent->get_outp_size(), slot_cnt, io_ent->get_outp_elem_type())).first;
+        io_ent->set_outp_func(buf_it->second.outp_buffer_func());
     }
+    // outputs that are sparse are additionally handed over as sparse views
+    std::unordered_map<std::size_t,bool> sparse_outputs;
+    for (const io_entity *io_ent : entities)
+        sparse_outputs.emplace(io_ent->get_outp_id(), io_ent->get_outp_sparsity() > 0);
+
     // set input funcs
-    for (auto &io_ent : iterate_entities()) {
-        const auto inp_ids = io_ent.get_inp_ids();
+    for (io_entity *io_ent : entities) {
+        const auto inp_ids = io_ent->get_inp_ids();
         for (auto inp_id : inp_ids) {
             auto it = io_buffers.find(inp_id);
             if (it == io_buffers.end()) {
                 std::fprintf(stderr,"missing io_entity ID!\n");
                 std::terminate();
             }
-            io_ent.set_inp_func(inp_id, it->second.inp_buffer_func() );
+            const std::size_t delay = io_ent->get_inp_delay(inp_id);
+            io_ent->set_inp_func(inp_id, it->second.inp_buffer_func(delay) );
+            if (sparse_outputs.at(inp_id))
+                io_ent->set_sparse_inp_func(inp_id, it->second.sparse_inp_func(delay) );
         }
     }
 }
 
+void env::use_huge_page_arena()
+{
+    if (!alloc_arena)
+        alloc_arena = std::make_unique<arena>();
+}
+
+void env::init_io_buffers()
+{
+    std::vector<io_entity*> all_entities;
+    for (auto &io_ent : iterate_entities()) {
+        all_entities.push_back(&io_ent);
+        entity_timings.try_emplace(io_ent.get_outp_id());
+    }
+    connect_io_buffers(io_buffers, all_entities);
+}
+
 std::generator<io_entity &> env::iterate_entities()
 {
     for (auto &ev : entities | std::views::values ) {
@@ -43,60 +85,302 @@ std::generator<io_entity &> env::iterate_entities()
     }
 }
 
-void env::process()
+void env::set_schedule(const std::vector<std::vector<std::size_t>> &partitions)
+{
+    std::unordered_map<std::size_t,io_entity*> by_id;
+    for (auto &io_ent : iterate_entities())
+        by_id.emplace(io_ent.get_outp_id(), &io_ent);
+
+    schedule.clear();
+    std::size_t scheduled_cnt = 0;
+    for (const auto &partition : partitions) {
+        auto &part = schedule.emplace_back();
+        for (const auto id : partition) {
+            const auto it = by_id.find(id);
+            if (it == by_id.end() || it->second == nullptr) {
+                std::fprintf(stderr,"unknown or duplicate io_entity ID %zu in schedule!\n", id);
+                std::terminate();
+            }
+            part.push_back(it->second);
+            it->second = nullptr;
+            ++scheduled_cnt;
+        }
+    }
+    if (scheduled_cnt != by_id.size()) {
+        std::fprintf(stderr,"schedule does not cover all io_entities!\n");
+        std::terminate();
+    }
+    std::erase_if(schedule, [](const auto &part) { return part.empty(); });
+}
+
+void env::set_clock(std::size_t id, std::size_t divider, std::size_t phase)
 {
-    for (auto &pre_proc : pre_process_hooks | std::views::values ) {
-        pre_proc();
+    bool known = false;
+    for (const auto &io_ent : iterate_entities())
+        known |= io_ent.get_outp_id() == id;
+    if (!known) {
+        std::fprintf(stderr,"unknown io_entity ID %zu for clock!\n", id);
+        std::terminate();
     }
+    if (divider <= 1)
+        clocks.erase(id);
+    else
+        clocks.insert_or_assign(id, entity_clock_t{ divider, phase % divider });
+}
 
-    for (auto &io_ent : iterate_entities()) {
-        io_ent.process();
+bool env::ticks(std::size_t id) const
+{
+    const auto it = clocks.find(id);
+    return it == clocks.end() || (step_cnt - 1) % it->second.divider == it->second.phase;
+}
+
+bool env::freeze(std::size_t key_source_id, const std::vector<std::size_t> &ids, const freeze_params_t &params)
+{
+    unfreeze();
+
+    std::unordered_map<std::size_t,io_entity*> by_id;
+    for (auto &io_ent : iterate_entities())
+        by_id.emplace(io_ent.get_outp_id(), &io_ent);
+
+    const auto src_it = by_id.find(key_source_id);
+    if (src_it == by_id.end() || clocks.contains(key_source_id)) {
+        std::fprintf(stderr,"unknown or clocked key source %zu for freezing!\n", key_source_id);
+        return false;
+    }
+
+    const std::unordered_set<std::size_t> frozen_ids(ids.begin(), ids.end());
+    for (const auto id : frozen_ids) {
+        const auto it = by_id.find(id);
+        if (it == by_id.end() || id == key_source_id || clocks.contains(id) || !io_buffers.contains(id)) {
+            std::fprintf(stderr,"io_entity %zu cannot be frozen!\n", id);
+            return false;
+        }
+        if (it->second->get_inp_ids().empty()) {
+            std::fprintf(stderr,"frozen io_entity %zu has no inputs!\n", id);
+            return false;
+        }
+        for (const auto inp_id : it->second->get_inp_ids()) {
+            if (inp_id != key_source_id && !frozen_ids.contains(inp_id)) {
+                std::fprintf(stderr,"input %zu of frozen io_entity %zu is neither frozen nor the key source!\n", inp_id, id);
+                return false;
+            }
+        }
+    }
+
+    // the lags are resolved in rounds, every round settles the entities whose inputs are settled already
+    std::unordered_map<std::size_t,std::size_t> lags { {key_source_id, 0} };
+    for (bool progress = true; progress; ) {
+        progress = false;
+        for (const auto id : frozen_ids) {
+            if (lags.contains(id))
+                continue;
+            const io_entity           *io_ent = by_id.at(id);
+            std::optional<std::size_t> lag;
+            bool                       ready = true;
+            for (const auto inp_id : io_ent->get_inp_ids()) {
+                const auto inp_lag = lags.find(inp_id);
+                if (inp_lag == lags.end()) {
+                    ready = false;
+                    break;
+                }
+                const std::size_t cand = inp_lag->second + 1 + io_ent->get_inp_delay(inp_id);
+                if (lag && *lag != cand) {
+                    std::fprintf(stderr,"inputs of frozen io_entity %zu do not depend on the same sample!\n", id);
+                    return false;
+                }
+                lag = cand;
+            }
+            if (ready) {
+                lags.emplace(id, *lag);
+                progress = true;
+            }
+        }
+    }
+    if (lags.size() != frozen_ids.size() + 1) {
+        std::fprintf(stderr,"frozen io_entities form a cycle!\n");
+        return false;
     }
 
-    for (auto &post_proc : post_process_hooks | std::views::values ) {
-        post_proc();
+    std::size_t max_lag = 0;
+    for (const auto id : frozen_ids) {
+        io_entity *io_ent = by_id.at(id);
+        io_buffer &buf    = io_buffers.at(id);
+        frozen.emplace(id, frozen_t{
+            io_ent,
+            &buf,
+            lags.at(id),
+            output_cache(buf.size(), io_ent->get_outp_sparsity(), params.elem.value_or(buf.elem_type()), params.max_bytes),
+            {},
+            false
+        });
+        io_ent->set_frozen(true);
+        max_lag = std::max(max_lag, lags.at(id));
     }
+    key_source = src_it->second;
+    sample_keys.assign(max_lag + 1, std::nullopt);
+    return true;
 }
 
-void env::swap_io()
+void env::unfreeze()
+{
+    for (auto &fr : frozen | std::views::values)
+        fr.ent->set_frozen(false);
+    frozen.clear();
+    key_source = nullptr;
+    sample_keys.clear();
+}
+
+std::optional<output_cache::stats_t> env::get_frozen_stats(std::size_t id) const
+{
+    const auto it = frozen.find(id);
+    if (it == frozen.end())
+        return {};
+    return it->second.cache.get_stats();
+}
+
+// frozen entities whose input sample is cached get their output from the cache instead of being processed
+void env::serve_frozen()
+{
+    for (auto &fr : frozen | std::views::values) {
+        fr.key    = step_cnt > fr.lag ? sample_keys[(step_cnt - fr.lag) % sample_keys.size()] : std::nullopt;
+        fr.served = fr.key && fr.cache.load(*fr.key, fr.buf->cur_write_buffer());
+    }
+}
+
+// stores the outputs of the frozen entities that were processed and the key of the current sample
+void env::store_frozen()
+{
+    for (auto &fr : frozen | std::views::values) {
+        if (!fr.served && fr.key)
+            fr.cache.store(*fr.key, fr.buf->cur_write_buffer());
+    }
+    sample_keys[step_cnt % sample_keys.size()] = key_source->get_sample_key();
+}
+
+void env::run_hooks(std::unordered_map<std::size_t,hook_t> &hooks) const
 {
-    for (auto &pre_proc : pre_swap_hooks | std::views::values) {
-        pre_proc();
+    for (auto &hook : hooks | std::views::values) {
+        if (step_cnt % hook.interval == 0)
+            hook.func();
     }
+}
+
+void env::process()
+{
+    COAST_TIME_SCOPE(&env_timings[timing_process]);
+
+    ++step_cnt;
+
+    run_hooks(pre_process_hooks);
+
+    if (!frozen.empty())
+        serve_frozen();
+
+    // without any clocks every entity ticks on every step, frozen entities served from their cache are skipped
+    const std::function<bool(std::size_t)> tick_func = [this](std::size_t id) {
+        const auto it = frozen.find(id);
+        return ticks(id) && (it == frozen.end() || !it->second.served);
+    };
+    const auto *tick = clocks.empty() && frozen.empty() ? nullptr : &tick_func;
+
+    if (schedule.empty()) {
+        for (auto &ev : entities | std::views::values) {
+            ev->process_all(entity_timings, tick);
+        }
+    } else {
+        std::for_each(
+            std::execution::par,
+            schedule.begin(), schedule.end(),
+            [this,tick](const std::vector<io_entity*> &partition) {
+                for (io_entity *io_ent : partition) {
+                    if (tick != nullptr && !(*tick)(io_ent->get_outp_id()))
+                        continue;
+                    COAST_TIME_SCOPE(&entity_timings.at(io_ent->get_outp_id()));
+                    io_ent->process();
+                }
+            }
+        );
+    }
+
+    if (!frozen.empty())
+        store_frozen();
+
+    run_hooks(post_process_hooks);
+}
 
-    for (auto &buf : io_buffers | std::views::values ) {
-        buf.swap_buffer();
+void env::swap_io()
+{
+    COAST_TIME_SCOPE(&env_timings[timing_swap_io]);
+
+    run_hooks(pre_swap_hooks);
+
+    // buffers of entities that did not tick keep publishing their last output
+    for (auto &[id, buf] : io_buffers) {
+        if (clocks.empty() || ticks(id))
+            buf.swap_buffer();
     }
 
-    for (auto &post_proc : post_swap_hooks | std::views::values) {
-        post_proc();
+    for (auto &batch_hook : batch_hooks | std::views::values) {
+        batch_hook.record(step_cnt);
     }
+
+    run_hooks(post_swap_hooks);
 }
 
-std::size_t env::set_pre_process_hook(std::function<void()> func)
+std::size_t env::set_pre_process_hook(std::function<void()> func, std::size_t interval)
 {
-    pre_process_hooks.emplace(next_hook_id, func);
+    pre_process_hooks.emplace(next_hook_id, hook_t{ std::move(func), std::max<std::size_t>(interval, 1) });
     return next_hook_id++;
 }
 
-std::size_t env::set_post_process_hook(std::function<void()> func)
+std::size_t env::set_post_process_hook(std::function<void()> func, std::size_t interval)
 {
-    post_process_hooks.emplace(next_hook_id, func);
+    post_process_hooks.emplace(next_hook_id, hook_t{ std::move(func), std::max<std::size_t>(interval, 1) });
     return next_hook_id++;
 }
 
-std::size_t env::set_pre_swap_hook(std::function<void()> func)
+std::size_t env::set_pre_swap_hook(std::function<void()> func, std::size_t interval)
 {
-    pre_swap_hooks.emplace(next_hook_id, func);
+    pre_swap_hooks.emplace(next_hook_id, hook_t{ std::move(func), std::max<std::size_t>(interval, 1) });
     return next_hook_id++;
 }
 
-std::size_t env::set_post_swap_hook(std::function<void()> func)
+std::size_t env::set_post_swap_hook(std::function<void()> func, std::size_t interval)
 {
-    post_swap_hooks.emplace(next_hook_id, func);
+    post_swap_hooks.emplace(next_hook_id, hook_t{ std::move(func), std::max<std::size_t>(interval, 1) });
     return next_hook_id++;
 }
 
+std::size_t env::set_batch_hook(
+    const std::vector<std::size_t>       &buffer_ids,
+    std::size_t                          batch_size,
+    io_batch_recorder::mode_t            mode,
+    std::function<void(const io_batch&)> func
+){
+    std::vector<io_buffer*> buffers;
+    for (const auto id : buffer_ids) {
+        auto it = io_buffers.find(id);
+        if (it == io_buffers.end()) {
+            std::fprintf(stderr,"missing io_buffer ID for batch hook!\n");
+            std::terminate();
+        }
+        buffers.push_back(&it->second);
+    }
+    batch_hooks.emplace(
+        std::piecewise_construct,
+        std::forward_as_tuple(next_hook_id),
+        std::forward_as_tuple(buffer_ids, std::move(buffers), batch_size, mode, std::move(func))
+    );
+    return next_hook_id++;
+}
+
+void env::flush_batch_hooks()
+{
+    for (auto &batch_hook : batch_hooks | std::views::values) {
+        batch_hook.flush();
+    }
+}
+
 void env::remove_pre_process_hook(std::size_t id)
 {
     pre_process_hooks.erase(id);
@@ -117,4 +401,263 @@ void env::remove_post_swap_hook(std::size_t id)
     post_swap_hooks.erase(id);
 }
 
+void env::remove_batch_hook(std::size_t id)
+{
+    batch_hooks.erase(id);
+}
+
+const latency_histogram * env::get_entity_timing(std::size_t id) const
+{
+    const auto it = entity_timings.find(id);
+    return it == entity_timings.end() ? nullptr : &it->second;
+}
+
+std::string env::timings_json()
+{
+    std::string json { "{\n  \"enabled\": " };
+    json += timing_enabled ? "true" : "false";
+    json += ",\n  \"env\": " + env_timings.to_json();
+    json += ",\n  \"entities\": [";
+
+    std::vector<io_entity*> sorted_entities;
+    for (auto &io_ent : iterate_entities())
+        sorted_entities.push_back(&io_ent);
+    std::ranges::sort(sorted_entities, {}, [](const io_entity *ent) { return ent->get_outp_id(); });
+
+    for (bool first = true; const io_entity *io_ent : sorted_entities) {
+        const std::size_t id = io_ent->get_outp_id();
+        json += first ? "\n    {" : ",\n    {";
+        json += "\"id\": " + std::to_string(id);
+        if (const auto *hist = get_entity_timing(id))
+            json += ", \"process\": " + hist->to_json();
+        if (const auto *phases = io_ent->get_phase_timings())
+            json += ", \"phases\": " + phases->to_json();
+        json += "}";
+        first = false;
+    }
+    json += "\n  ],\n  \"batches\": {";
+    for (bool first = true; const auto &[type, ev] : entities) {
+        if (const auto *hist = ev->get_batch_timing()) {
+            json += first ? "\n    \"" : ",\n    \"";
+            json += std::string(type.name()) + "\": " + hist->to_json();
+            first = false;
+        }
+    }
+    return json + "\n  }\n}\n";
+}
+
+void env::reset_timings()
+{
+    env_timings.reset();
+    for (auto &hist : entity_timings | std::views::values)
+        hist.reset();
+    for (auto &io_ent : iterate_entities())
+        io_ent.reset_phase_timings();
+    for (auto &ev : entities | std::views::values)
+        ev->reset_batch_timing();
+}
+
+bool env::save_checkpoint(const std::string &file_name)
+{
+    return write_checkpoint(file_name, checkpoint_header_t::kind_t::full);
+}
+
+bool env::save_delta_checkpoint(const std::string &file_name)
+{
+    if (checkpoint_sequence == 0) {
+        std::fprintf(stderr, "delta checkpoints require a previous full checkpoint\n");
+        return false;
+    }
+    return write_checkpoint(file_name, checkpoint_header_t::kind_t::delta);
+}
+
+/*
+ * Writes the state of all entities and io buffers into a checkpoint. The checkpoint is first written to a temporary
+ * file that replaces the target file only if writing succeeded, i.e., an existing checkpoint is never left broken.
+ */
+bool env::write_checkpoint(const std::string &file_name, checkpoint_header_t::kind_t kind)
+{
+    // entities and buffers are stored ordered by ID to get a deterministic layout
+    std::vector<std::pair<const io_entity*,std::string_view>> sorted_entities;
+    for (auto &ev : entities | std::views::values)
+        for (std::size_t i = 0; i < ev->get_size(); ++i)
+            sorted_entities.emplace_back(&ev->as_base(i), ev->get_checkpoint_tag());
+    std::ranges::sort(sorted_entities, {}, [](const auto &ent) { return ent.first->get_outp_id(); });
+
+    std::vector<std::size_t> buffer_ids;
+    for (const auto id : io_buffers | std::views::keys)
+        buffer_ids.push_back(id);
+    std::ranges::sort(buffer_ids);
+
+    // sequence IDs are random to keep checkpoint chains of different runs apart
+    std::random_device rdev;
+    checkpoint_chain_t chain {};
+    chain.sequence      = (static_cast<uint64_t>(rdev()) << 32 | rdev()) | 1;
+    chain.base_sequence = kind == checkpoint_header_t::kind_t::delta ? checkpoint_sequence : 0;
+
+    const std::string tmp_file_name = file_name + ".tmp";
+    {
+        checkpoint_writer cw(tmp_file_name, kind == checkpoint_header_t::kind_t::delta);
+
+        checkpoint_header_t header {};
+        std::ranges::copy(checkpoint_header_t::magic_value, header.magic);
+        header.version    = checkpoint_header_t::cur_version;
+        header.kind       = kind;
+        header.entity_cnt = sorted_entities.size();
+        header.buffer_cnt = buffer_ids.size();
+        cw.write(header);
+        cw.write(chain);
+        cw.write(checkpoint_step_t{ step_cnt });
+
+        for (const auto &[io_ent, tag] : sorted_entities) {
+            cw.write<uint64_t>(io_ent->get_outp_id());
+            cw.write_string(tag);
+            const std::size_t record = cw.begin_record();
+            io_ent->save_state(cw);
+            cw.end_record(record);
+        }
+
+        for (const auto id : buffer_ids) {
+            cw.write<uint64_t>(id);
+            const std::size_t record = cw.begin_record();
+            io_buffers.at(id).save_state(cw);
+            cw.end_record(record);
+        }
+
+        if (!cw.close()) {
+            std::remove(tmp_file_name.c_str());
+            return false;
+        }
+    }
+
+    if (!commit_checkpoint(tmp_file_name, file_name))
+        return false;
+
+    // the state just written is the base of the next delta checkpoint
+    for (auto &io_ent : iterate_entities())
+        io_ent.mark_checkpointed();
+    checkpoint_sequence = chain.sequence;
+    return true;
+}
+
+/*
+ * Restores the state of all entities and io buffers from a checkpoint. Records of entities that are not part of this
+ * environment (or have a different type) are skipped with a warning. All record headers are read and validated before
+ * the first record is restored, see the description in sim_env.h for the remaining failure modes.
+ */
+bool env::load_checkpoint(const std::string &file_name)
+{
+    checkpoint_reader cr(file_name);
+    if (!cr.good())
+        return false;
+
+    const auto header = cr.read<checkpoint_header_t>();
+    if (!std::ranges::equal(header.magic, checkpoint_header_t::magic_value) ||
+        header.version == 0 || header.version > checkpoint_header_t::cur_version)
+    {
+        std::fprintf(stderr, "%s is not a supported checkpoint\n", file_name.c_str());
+        return false;
+    }
+
+    cr.set_version(header.version);
+
+    // version 1 checkpoints are full snapshots without chain information
+    const auto chain = header.version >= 2 ? cr.read<checkpoint_chain_t>() : checkpoint_chain_t {};
+    const auto step  = header.version >= 3 ? cr.read<checkpoint_step_t>()  : checkpoint_step_t { step_cnt };
+    if (header.kind == checkpoint_header_t::kind_t::delta) {
+        if (chain.base_sequence != checkpoint_sequence || checkpoint_sequence == 0) {
+            std::fprintf(stderr, "delta checkpoint %s does not continue the loaded checkpoint\n", file_name.c_str());
+            return false;
+        }
+        cr.set_delta(true);
+    } else if (header.kind != checkpoint_header_t::kind_t::full) {
+        std::fprintf(stderr, "%s has an unknown checkpoint kind\n", file_name.c_str());
+        return false;
+    }
+
+    struct entity_ref_t {
+        io_entity        *ent;
+        std::string_view  tag;
+    };
+    std::unordered_map<std::size_t,entity_ref_t> entity_lu;
+    for (auto &ev : entities | std::views::values)
+        for (std::size_t i = 0; i < ev->get_size(); ++i)
+            entity_lu.emplace(ev->as_base(i).get_outp_id(), entity_ref_t{ &ev->as_base(i), ev->get_checkpoint_tag() });
+
+    // 1. read all record headers, the records are restored only if the structure of the whole file is valid
+    struct record_t {
+        uint64_t     id;
+        io_entity   *ent;   // nullptr for buffer records and skipped entity records
+        io_buffer   *buf;   // nullptr for entity records and skipped buffer records
+        std::size_t  begin;
+        std::size_t  end;
+    };
+    std::vector<record_t> records;
+
+    for (uint64_t ei = 0; ei < header.entity_cnt && cr.good(); ++ei) {
+        const auto        id         = cr.read<uint64_t>();
+        const std::string type_name  { cr.read_string() };
+        const std::size_t record_end = cr.begin_record();
+
+        // checkpoints before version 4 identify the entity type by its typeid name
+        const auto it = entity_lu.find(id);
+        if (it == entity_lu.end() ||
+            type_name != (header.version >= 4 ? it->second.tag : std::string_view{typeid(*it->second.ent).name()}))
+        {
+            std::fprintf(stderr, "skipping checkpoint record of unknown io_entity %zu\n", static_cast<std::size_t>(id));
+            cr.skip_record(record_end);
+            continue;
+        }
+        records.push_back({ id, it->second.ent, nullptr, cr.position(), record_end });
+        cr.skip_record(record_end);
+    }
+
+    for (uint64_t bi = 0; bi < header.buffer_cnt && cr.good(); ++bi) {
+        const auto        id         = cr.read<uint64_t>();
+        const std::size_t record_end = cr.begin_record();
+
+        const auto it = io_buffers.find(id);
+        if (it == io_buffers.end()) {
+            std::fprintf(stderr, "skipping checkpoint record of unknown io_buffer %zu\n", static_cast<std::size_t>(id));
+            cr.skip_record(record_end);
+            continue;
+        }
+        records.push_back({ id, nullptr, &it->second, cr.position(), record_end });
+        cr.skip_record(record_end);
+    }
+
+    if (!cr.good()) {
+        std::fprintf(stderr, "checkpoint %s is truncated or malformed\n", file_name.c_str());
+        return false;
+    }
+
+    // 2. restore the records
+    for (const auto &rec : records) {
+        cr.seek(rec.begin);
+        const bool restored = rec.ent != nullptr ? rec.ent->load_state(cr) : rec.buf->load_state(cr);
+        if (!restored || !cr.good() || cr.position() != rec.end) {
+            std::fprintf(stderr, "could not restore %s %zu from checkpoint\n",
+                rec.ent != nullptr ? "io_entity" : "io_buffer", static_cast<std::size_t>(rec.id));
+            return false;
+        }
+    }
+
+    for (auto &io_ent : iterate_entities())
+        io_ent.mark_checkpointed();
+    checkpoint_sequence = chain.sequence;
+    step_cnt            = step.step_cnt;
+
+    // the keys of the samples in flight are not part of checkpoints
+    std::ranges::fill(sample_keys, std::nullopt);
+    return true;
+}
+
+bool env::load_checkpoints(std::span<const std::string> file_names)
+{
+    for (const auto &file_name : file_names)
+        if (!load_checkpoint(file_name))
+            return false;
+    return true;
+}
+
 } // sim
\ No newline at end of file
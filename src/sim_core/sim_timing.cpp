@@ -0,0 +1,103 @@
+#include "sim_timing.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+namespace sim {
+
+/*
+ * values below 2 * half_sub_cnt are stored exactly, larger values are stored with a precision of
+ * 1 / half_sub_cnt relative to their magnitude
+ */
+std::size_t latency_histogram::bucket_idx(uint64_t val)
+{
+    const int bits = std::bit_width(val);
+    if (bits <= sub_bucket_bits)
+        return static_cast<std::size_t>(val);
+    const int exponent = bits - sub_bucket_bits;
+    return static_cast<std::size_t>(exponent) * half_sub_cnt + static_cast<std::size_t>(val >> exponent);
+}
+
+uint64_t latency_histogram::bucket_upper_bound(std::size_t idx)
+{
+    if (idx < 2 * half_sub_cnt)
+        return idx;
+    const std::size_t exponent = idx / half_sub_cnt - 1;
+    const uint64_t    sub      = idx - exponent * half_sub_cnt;
+    return ((sub + 1) << exponent) - 1;
+}
+
+void latency_histogram::record(uint64_t ns)
+{
+    counts[bucket_idx(ns)].fetch_add(1, std::memory_order_relaxed);
+    total_cnt.fetch_add(1, std::memory_order_relaxed);
+    total_sum.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t cur_max = max_val.load(std::memory_order_relaxed);
+    while (ns > cur_max && !max_val.compare_exchange_weak(cur_max, ns, std::memory_order_relaxed)) {}
+}
+
+void latency_histogram::reset()
+{
+    for (auto &cnt : counts)
+        cnt.store(0, std::memory_order_relaxed);
+    total_cnt.store(0, std::memory_order_relaxed);
+    total_sum.store(0, std::memory_order_relaxed);
+    max_val.store(0, std::memory_order_relaxed);
+}
+
+double latency_histogram::mean() const
+{
+    const uint64_t cnt = count();
+    return cnt > 0 ? static_cast<double>(total_sum.load(std::memory_order_relaxed)) / static_cast<double>(cnt) : 0.0;
+}
+
+uint64_t latency_histogram::percentile(double p) const
+{
+    const uint64_t cnt = count();
+    if (cnt == 0)
+        return 0;
+    const auto target = static_cast<uint64_t>(std::clamp(p, 0.0, 100.0) / 100.0 * static_cast<double>(cnt) + 0.5);
+    uint64_t acc = 0;
+    for (std::size_t idx = 0; idx < bucket_cnt; ++idx) {
+        acc += counts[idx].load(std::memory_order_relaxed);
+        if (acc >= std::max<uint64_t>(target, 1))
+            return std::min(bucket_upper_bound(idx), max());
+    }
+    return max();
+}
+
+std::string latency_histogram::to_json() const
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+        "{\"count\": %llu, \"mean_ns\": %.1f, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu}",
+        static_cast<unsigned long long>(count()), mean(),
+        static_cast<unsigned long long>(percentile(50.0)),
+        static_cast<unsigned long long>(percentile(90.0)),
+        static_cast<unsigned long long>(percentile(99.0)),
+        static_cast<unsigned long long>(max()));
+    return buf;
+}
+
+timing_set::timing_set(std::initializer_list<std::string_view> _names) :
+    names ( _names.begin(), _names.end()                                  ),
+    hists ( std::make_unique<latency_histogram[]>(_names.size()) )
+{}
+
+void timing_set::reset()
+{
+    for (std::size_t idx = 0; idx < size(); ++idx)
+        hists[idx].reset();
+}
+
+std::string timing_set::to_json() const
+{
+    std::string json { "{" };
+    for (std::size_t idx = 0; idx < size(); ++idx) {
+        json += (idx > 0 ? ", \"" : "\"") + names[idx] + "\": " + hists[idx].to_json();
+    }
+    return json + "}";
+}
+
+} // sim
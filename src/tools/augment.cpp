@@ -0,0 +1,141 @@
+#include "augment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+#include <vector>
+
+#include "mnist_db.h"
+
+namespace mdb {
+
+namespace {
+
+// bilinear interpolation, zero outside of the image
+float sample_bilinear(std::span<const float> src, std::size_t width, std::size_t height, float x, float y)
+{
+    const float fx = std::floor(x);
+    const float fy = std::floor(y);
+    const auto  x0 = static_cast<long>(fx);
+    const auto  y0 = static_cast<long>(fy);
+    const float ax = x - fx;
+    const float ay = y - fy;
+
+    const auto at = [&](long xi, long yi) -> float {
+        if (xi < 0 || yi < 0 || xi >= static_cast<long>(width) || yi >= static_cast<long>(height))
+            return 0.0f;
+        return src[static_cast<std::size_t>(yi) * width + static_cast<std::size_t>(xi)];
+    };
+    return (1.0f - ay) * ((1.0f - ax) * at(x0, y0)     + ax * at(x0 + 1, y0)) +
+                   ay  * ((1.0f - ax) * at(x0, y0 + 1) + ax * at(x0 + 1, y0 + 1));
+}
+
+// separable gaussian smoothing of a width * height field in place
+void smooth(std::vector<float> &field, std::vector<float> &tmp, std::size_t width, std::size_t height, float sigma)
+{
+    const auto radius = static_cast<long>(std::ceil(2.0f * sigma));
+    std::vector<float> kernel(static_cast<std::size_t>(2 * radius + 1));
+    for (long i = -radius; i <= radius; ++i)
+        kernel[static_cast<std::size_t>(i + radius)] = std::exp(-0.5f * static_cast<float>(i * i) / (sigma * sigma));
+    const float norm = std::accumulate(kernel.begin(), kernel.end(), 0.0f);
+    for (auto &k : kernel)
+        k /= norm;
+
+    const auto w = static_cast<long>(width);
+    const auto h = static_cast<long>(height);
+    tmp.resize(field.size());
+    for (long y = 0; y < h; ++y) {
+        for (long x = 0; x < w; ++x) {
+            float sum = 0.0f;
+            for (long i = -radius; i <= radius; ++i)
+                sum += kernel[static_cast<std::size_t>(i + radius)] * field[static_cast<std::size_t>(y * w + std::clamp(x + i, 0L, w - 1))];
+            tmp[static_cast<std::size_t>(y * w + x)] = sum;
+        }
+    }
+    for (long y = 0; y < h; ++y) {
+        for (long x = 0; x < w; ++x) {
+            float sum = 0.0f;
+            for (long i = -radius; i <= radius; ++i)
+                sum += kernel[static_cast<std::size_t>(i + radius)] * tmp[static_cast<std::size_t>(std::clamp(y + i, 0L, h - 1) * w + x)];
+            field[static_cast<std::size_t>(y * w + x)] = sum;
+        }
+    }
+}
+
+} // namespace
+
+void augment_image(
+    std::span<const uint8_t> img,
+    std::size_t              width,
+    std::size_t              height,
+    std::span<float>         outp,
+    const augment_params_t  &params,
+    std::mt19937            &rgen
+){
+    thread_local std::vector<float> src, disp_x, disp_y, tmp;
+
+    std::uniform_real_distribution<float> sym(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    const float angle    = sym(rgen) * params.max_rotation * std::numbers::pi_v<float> / 180.0f;
+    const float shift_x  = sym(rgen) * params.max_shift;
+    const float shift_y  = sym(rgen) * params.max_shift;
+    const float contrast = 1.0f + sym(rgen) * params.contrast;
+
+    const std::size_t size = width * height;
+    src.resize(size);
+    std::ranges::transform(img.first(size), src.begin(), mnist_db::norm_pixel);
+
+    // elastic deformation: smoothed random displacement field (Simard et al., 2003)
+    const bool elastic = params.elastic_alpha > 0.0f;
+    if (elastic) {
+        disp_x.resize(size);
+        disp_y.resize(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            disp_x[i] = sym(rgen);
+            disp_y[i] = sym(rgen);
+        }
+        smooth(disp_x, tmp, width, height, params.elastic_sigma);
+        smooth(disp_y, tmp, width, height, params.elastic_sigma);
+    }
+
+    // inverse mapping of every output pixel into the source image (rotation around the center, then translation)
+    const float cx = static_cast<float>(width  - 1) * 0.5f;
+    const float cy = static_cast<float>(height - 1) * 0.5f;
+    const float cs = std::cos(angle);
+    const float sn = std::sin(angle);
+    for (std::size_t y = 0; y < height; ++y) {
+        for (std::size_t x = 0; x < width; ++x) {
+            const std::size_t i  = y * width + x;
+            const float       xs = static_cast<float>(x) - cx - shift_x;
+            const float       ys = static_cast<float>(y) - cy - shift_y;
+            float sx =  cs * xs + sn * ys + cx;
+            float sy = -sn * xs + cs * ys + cy;
+            if (elastic) {
+                sx += params.elastic_alpha * disp_x[i];
+                sy += params.elastic_alpha * disp_y[i];
+            }
+            outp[i] = sample_bilinear(src, width, height, sx, sy);
+        }
+    }
+
+    // contrast jitter around the mean intensity
+    const float mean = std::accumulate(outp.begin(), outp.begin() + static_cast<long>(size), 0.0f) / static_cast<float>(size);
+    for (auto &val : outp.first(size))
+        val = std::clamp(mean + (val - mean) * contrast, 0.0f, 1.0f);
+
+    // occlusion by a rectangle at a random position
+    if (unit(rgen) < params.occlusion_prob) {
+        const auto occ_w = std::min(width,  static_cast<std::size_t>(std::lround(params.occlusion_size * static_cast<float>(width))));
+        const auto occ_h = std::min(height, static_cast<std::size_t>(std::lround(params.occlusion_size * static_cast<float>(height))));
+        std::uniform_int_distribution<std::size_t> pos_x(0, width  - occ_w);
+        std::uniform_int_distribution<std::size_t> pos_y(0, height - occ_h);
+        const std::size_t ox = pos_x(rgen);
+        const std::size_t oy = pos_y(rgen);
+        for (std::size_t y = oy; y < oy + occ_h; ++y)
+            std::ranges::fill(outp.subspan(y * width + ox, occ_w), 0.0f);
+    }
+}
+
+} // mdb
@@ -0,0 +1,230 @@
+#include "idx_stream_io.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include <sys/types.h>
+
+namespace sim {
+
+namespace {
+
+std::FILE* open_idx(const std::string &file_name, mdb::idx_header_t &header)
+{
+    std::FILE *file = std::fopen(file_name.c_str(), "rb");
+    if (!file) {
+        std::fprintf(stderr, "could not open idx file %s\n", file_name.c_str());
+        return nullptr;
+    }
+    std::vector<std::byte> buf(mdb::max_idx_header_size);
+    buf.resize(std::fread(buf.data(), 1, buf.size(), file));
+    const auto parsed = mdb::parse_idx_header(buf);
+    if (!parsed || parsed->data_type != mdb::idx_file::data_type_t::u8) {
+        std::fprintf(stderr, "idx file %s does not hold u8 data\n", file_name.c_str());
+        std::fclose(file);
+        return nullptr;
+    }
+    header = *parsed;
+    return file;
+}
+
+// reads cnt bytes at the given offset, missing bytes (truncated files) are zeroed. Seeks with fseeko, as long (fseek)
+// is only 32 bits wide on some platforms, which does not cover large data sets
+void read_at(std::FILE *file, std::size_t offset, std::span<uint8_t> dst)
+{
+    std::size_t read = 0;
+    if (offset <= static_cast<std::size_t>(std::numeric_limits<off_t>::max()) &&
+        fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0)
+        read = std::fread(dst.data(), 1, dst.size(), file);
+    if (read < dst.size()) {
+        std::fprintf(stderr, "idx stream: short read at offset %zu\n", offset);
+        std::ranges::fill(dst.subspan(read), uint8_t{0});
+    }
+}
+
+} // namespace
+
+idx_stream_io::source_t::~source_t()
+{
+    if (img_file)
+        std::fclose(img_file);
+    if (lbl_file)
+        std::fclose(lbl_file);
+}
+
+idx_stream_io::idx_stream_io(
+    std::size_t        _id,
+    int                _change_interval,
+    const std::string &img_file,
+    const std::string &label_file,
+    params_t           _params,
+    int                rnd_seed,
+    io_elem_t          _outp_elem
+) :
+    io_entity(),
+    id(_id),
+    outp_elem(_outp_elem),
+    params(_params),
+    change_interval(_change_interval),
+    seed(rnd_seed),
+    source(std::make_unique<source_t>()),
+    rgen(rnd_seed),
+    dis(0.0f,0.05f) // 5% noise
+{
+    params.chunk_size = std::max<std::size_t>(params.chunk_size, 1);
+    params.window     = std::max<std::size_t>(params.window, 1);
+
+    source->img_file = open_idx(img_file, source->img_header);
+    source->lbl_file = open_idx(label_file, source->lbl_header);
+    if (source->img_file && source->lbl_file &&
+        source->img_header.num_elements == source->lbl_header.num_elements && source->lbl_header.element_size == 1)
+        return;
+
+    std::fprintf(stderr, "idx stream %zu: invalid image / label files %s, %s\n", id, img_file.c_str(), label_file.c_str());
+    source = std::make_unique<source_t>();
+}
+
+void idx_stream_io::set_outp_func(std::function<std::span<float>()> function)
+{
+    output_mem = function;
+}
+
+std::size_t idx_stream_io::chunk_cnt() const
+{
+    return (source->img_header.num_elements + params.chunk_size - 1) / params.chunk_size;
+}
+
+/*
+ * reads the next chunk of the current epoch and advances the read position, only called by the prefetch thread
+ */
+void idx_stream_io::read_chunk(chunk_t &chunk)
+{
+    source_t &src = *source;
+    if (src.order_epoch != src.epoch) {
+        src.chunk_order.resize(chunk_cnt());
+        std::iota(src.chunk_order.begin(), src.chunk_order.end(), 0u);
+        if (params.shuffle) {
+            std::seed_seq seq { seed, static_cast<int>(src.epoch) };
+            std::mt19937  order_rgen(seq);
+            std::ranges::shuffle(src.chunk_order, order_rgen);
+        }
+        src.order_epoch = src.epoch;
+    }
+
+    const std::size_t elem  = src.img_header.element_size;
+    const std::size_t first = src.chunk_order[src.order_pos] * params.chunk_size;
+    chunk.count     = std::min(params.chunk_size, src.img_header.num_elements - first);
+    chunk.epoch     = src.epoch;
+    chunk.order_pos = src.order_pos;
+    read_at(src.img_file, src.img_header.data_offset + first * elem, std::span(chunk.images).first(chunk.count * elem));
+    read_at(src.lbl_file, src.lbl_header.data_offset + first,        std::span(chunk.labels).first(chunk.count));
+
+    const auto order = std::span(chunk.order).first(chunk.count);
+    std::iota(order.begin(), order.end(), 0u);
+    if (params.shuffle) {
+        std::seed_seq seq { seed, static_cast<int>(src.epoch), static_cast<int>(src.order_pos) + 1 };
+        std::mt19937  order_rgen(seq);
+        std::ranges::shuffle(order, order_rgen);
+    }
+
+    if (++src.order_pos == src.chunk_order.size()) {
+        src.order_pos = 0;
+        ++src.epoch;
+    }
+}
+
+/*
+ * (re)starts the prefetching at the read position of the source, frames read ahead before are discarded
+ */
+void idx_stream_io::restart_producer()
+{
+    if (!producer) {
+        const std::size_t elem = source->img_header.element_size;
+        producer = std::make_unique<run_ahead<chunk_t>>(
+            params.window,
+            chunk_t{
+                std::vector<uint8_t>(params.chunk_size * elem),
+                std::vector<uint8_t>(params.chunk_size),
+                std::vector<uint32_t>(params.chunk_size),
+                0, 0, 0
+            },
+            [this](chunk_t &chunk) { read_chunk(chunk); }
+        );
+    }
+    producer->stop();
+    cur_chunk = nullptr;
+    producer->start();
+}
+
+void idx_stream_io::process()
+{
+    auto outp = output_mem();
+    if (!is_valid() || change_interval <= 0) {
+        mdb::render_image({}, outp, dis, rgen);
+        return;
+    }
+
+    if (!producer || !producer->running())
+        restart_producer();
+    if (cur_chunk == nullptr) {
+        cur_chunk  = &producer->next();
+        sample_pos = std::min(sample_pos, cur_chunk->count - 1);
+    }
+
+    const std::size_t elem   = source->img_header.element_size;
+    const std::size_t sample = cur_chunk->order[sample_pos];
+    cur_label = cur_chunk->labels[sample];
+    mdb::render_image(std::span(cur_chunk->images).subspan(sample * elem, elem), outp, dis, rgen);
+
+    if ((++ci_cnt %= change_interval) == 0 && ++sample_pos == cur_chunk->count) {
+        sample_pos = 0;
+        cur_chunk  = &producer->next();
+    }
+}
+
+std::string idx_stream_io::status_str() const
+{
+    std::string status { "IDX STREAM" };
+    status += " | id: " + std::to_string(id);
+    if (cur_chunk != nullptr) {
+        status += " | epoch: " + std::to_string(cur_chunk->epoch);
+        status += " | chunk: " + std::to_string(cur_chunk->order_pos) + "/" + std::to_string(chunk_cnt());
+        status += " | sample: " + std::to_string(sample_pos);
+    }
+    if (producer)
+        status += " | window: " + std::to_string(producer->size());
+    return status;
+}
+
+// the position of the current output is stored, chunks read ahead are not part of checkpoints
+void idx_stream_io::save_state(checkpoint_writer &cw) const
+{
+    cw.write<uint64_t>(cur_chunk ? cur_chunk->epoch     : source->epoch);
+    cw.write<uint64_t>(cur_chunk ? cur_chunk->order_pos : source->order_pos);
+    cw.write<uint64_t>(sample_pos);
+    cw.write<uint64_t>(ci_cnt);
+    cw.write(change_interval);
+    cw.write_rng(rgen);
+}
+
+bool idx_stream_io::load_state(checkpoint_reader &cr)
+{
+    // the chunks read ahead belong to the old position, the prefetching is restarted on the next process() call
+    if (producer)
+        producer->stop();
+    cur_chunk = nullptr;
+    source->epoch     = cr.read<uint64_t>();
+    source->order_pos = cr.read<uint64_t>();
+    sample_pos        = cr.read<uint64_t>();
+    ci_cnt            = cr.read<uint64_t>();
+    cr.read_into(change_interval);
+    cr.read_rng(rgen);
+    if (is_valid() && source->order_pos >= chunk_cnt()) {
+        std::fprintf(stderr, "idx stream position in checkpoint exceeds the data set\n");
+        return false;
+    }
+    return cr.good();
+}
+
+} // sim
@@ -6,91 +6,206 @@
 
 #include "mnist_db.h"
 
-#include <cassert>
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <iostream>
 #include <numeric>
 #include <limits>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace mdb {
 
-uint8_t idx_file::bswap(uint8_t x)
+mapped_file::mapped_file(const std::string &filename)
 {
-    return std::byteswap(x);
+#if defined(__unix__) || defined(__APPLE__)
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st {};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *ptr = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr != MAP_FAILED) {
+            // the data is read sequentially once (and then randomly), start the read ahead right away
+            madvise(ptr, static_cast<std::size_t>(st.st_size), MADV_WILLNEED);
+            base   = static_cast<const std::byte*>(ptr);
+            length = static_cast<std::size_t>(st.st_size);
+        }
+    }
+    close(fd); // the mapping stays valid
+#else
+    std::FILE *file = std::fopen(filename.c_str(), "rb");
+    if (!file)
+        return;
+    std::fseek(file, 0, SEEK_END);
+    const long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size > 0) {
+        fallback.resize(static_cast<std::size_t>(size));
+        if (std::fread(fallback.data(), 1, fallback.size(), file) == fallback.size()) {
+            base   = fallback.data();
+            length = fallback.size();
+        }
+    }
+    std::fclose(file);
+#endif
 }
 
-int16_t idx_file::bswab(int16_t x)
+mapped_file::~mapped_file()
 {
-    return std::byteswap(x);
+    unmap();
 }
 
-int32_t idx_file::bswab(int32_t x)
+void mapped_file::unmap()
 {
-    return std::byteswap(x);
+#if defined(__unix__) || defined(__APPLE__)
+    if (base != nullptr)
+        munmap(const_cast<std::byte*>(base), length);
+#endif
+    base   = nullptr;
+    length = 0;
+    fallback.clear();
 }
 
-idx_file::idx_file(const std::string &filename) :
-    u8_data(), i8_data(), i16_data(), i32_data(), f32_data(), f64_data(),
-    dimensions(),element_size(),num_elements()
+mapped_file::mapped_file(mapped_file &&other) noexcept :
+    base(std::exchange(other.base, nullptr)),
+    length(std::exchange(other.length, 0)),
+    fallback(std::move(other.fallback))
+{}
+
+mapped_file& mapped_file::operator=(mapped_file &&other) noexcept
 {
-//    std::fstream ifs(filename,std::ios::binary | std::ios::in);
-    std::FILE *file = std::fopen(filename.c_str(),"rb");
-    if (!file) {
-        std::cerr << "Could not open file " << filename << std::endl;
-        return;
+    if (this != &other) {
+        unmap();
+        base     = std::exchange(other.base, nullptr);
+        length   = std::exchange(other.length, 0);
+        fallback = std::move(other.fallback);
+    }
+    return *this;
+}
+
+namespace {
+
+uint32_t read_be32(const std::byte *ptr)
+{
+    uint32_t val;
+    std::memcpy(&val, ptr, sizeof(val));
+    return std::endian::native == std::endian::little ? std::byteswap(val) : val;
+}
+
+std::size_t type_size(idx_file::data_type_t type)
+{
+    switch (type) {
+        case idx_file::data_type_t::u8  :
+        case idx_file::data_type_t::i8  : return 1;
+        case idx_file::data_type_t::i16 : return 2;
+        case idx_file::data_type_t::i32 :
+        case idx_file::data_type_t::f32 : return 4;
+        case idx_file::data_type_t::f64 : return 8;
+        default                         : return 0;
     }
-    uint32_t tmp;
-    std::size_t elements_read = std::fread(&tmp, sizeof(tmp), 1, file);
-    if (elements_read != 1) {
-        std::cerr << "Could not read file " << filename << std::endl;
-        std::cerr << "Read " << elements_read << " elements from " << filename << std::endl;
+}
+
+} // namespace
+
+std::optional<idx_header_t> parse_idx_header(std::span<const std::byte> bytes)
+{
+    if (bytes.size() < 4) {
+        std::cerr << "Could not read idx header" << std::endl;
+        return {};
     }
-    uint32_t magic = std::byteswap(tmp);
+    const uint32_t magic = read_be32(bytes.data());
     if ((magic >> 16) != 0) {
         std::cerr << "Invalid magic number" << std::endl;
-        return;
+        return {};
     }
-    uint8_t data_type = (magic >> 8) & 0xff;
-    uint8_t dim_count = (magic >> 0) & 0xff;
-    if (dim_count == 0) {
+    idx_header_t header {};
+    header.data_type = static_cast<idx_file::data_type_t>((magic >> 8) & 0xff);
+    header.type_size = type_size(header.data_type);
+    if (header.type_size == 0) {
+        std::cerr << "Invalid data type" << std::endl;
+        return {};
+    }
+    const uint8_t dim_count = (magic >> 0) & 0xff;
+    header.data_offset = 4 + 4 * std::size_t{dim_count};
+    if (dim_count == 0 || bytes.size() < header.data_offset) {
         std::cerr << "Invalid dimensions" << std::endl;
-        return;
+        return {};
     }
     for (uint8_t i = 0; i < dim_count; i++) {
-        //    ifs >> tmp;
-        //ifs.read((char *)&tmp, sizeof(tmp));
-        std::fread(&tmp, sizeof(tmp), 1, file);
-        dimensions.push_back(std::byteswap(tmp));
-    }
-    element_size = std::accumulate(dimensions.begin()+1, dimensions.end(), 1, std::multiplies<>());
-    num_elements = dimensions[0];
-    switch (data_type) {
-        case 0x08 : {
-            read_data(file, u8_data);
-        } break;
-        case 0x09 : {
-            read_data(file, i8_data);
-        } break;
-        case 0x0B : {
-            read_data(file, i16_data);
-        } break;
-        case 0x0C : {
-            read_data(file, i32_data);
-        } break;
-        case 0x0D : {
-            read_data(file, f32_data);
-        } break;
-        case 0x0E : {
-            read_data(file, f64_data);
-        } break;
-        default:    std::cerr << "Invalid data type" << std::endl;
+        header.dimensions.push_back(read_be32(bytes.data() + 4 + 4 * i));
     }
-    std::fclose(file);
+    header.element_size = std::accumulate(header.dimensions.begin()+1, header.dimensions.end(), std::size_t{1}, std::multiplies<>());
+    header.num_elements = header.dimensions[0];
+    return header;
+}
+
+void render_image(
+    std::span<const uint8_t>              img,
+    std::span<float>                      outp,
+    std::uniform_real_distribution<float> noise,
+    std::mt19937                         &rgen
+){
+    constexpr std::size_t block = 64;
+    std::array<float,block> noise_blk;
+
+    for (std::size_t off = 0; off < outp.size(); off += block) {
+        const std::size_t cnt = std::min(block, outp.size() - off);
+        for (std::size_t i = 0; i < cnt; ++i)
+            noise_blk[i] = noise(rgen);
+        if (img.empty()) {
+            for (std::size_t i = 0; i < cnt; ++i)
+                outp[off + i] = std::clamp(noise_blk[i], 0.0f, 1.0f);
+        } else {
+            for (std::size_t i = 0; i < cnt; ++i)
+                outp[off + i] = std::clamp(mnist_db::norm_pixel(img[off + i]) + noise_blk[i], 0.0f, 1.0f);
+        }
+    }
+}
+
+idx_file::idx_file(const std::string &filename) :
+    file(filename), swapped(), payload(), data_type(data_type_t::none),
+    dimensions(), element_size(), num_elements()
+{
+    if (!file.is_open()) {
+        std::cerr << "Could not open file " << filename << std::endl;
+        return;
+    }
+    const auto header = parse_idx_header(file.bytes());
+    if (!header)
+        return;
+    dimensions   = header->dimensions;
+    element_size = header->element_size;
+    num_elements = header->num_elements;
+
+    const auto data = file.bytes().subspan(header->data_offset);
+    const auto type = header->data_type;
+    const std::size_t data_bytes = num_elements * element_size * header->type_size;
+    if (data.size() < data_bytes) {
+        std::cerr << "File " << filename << " is truncated" << std::endl;
+        return;
+    }
+    switch (type) {
+        case data_type_t::u8  : map_data<uint8_t>(data.first(data_bytes)); break;
+        case data_type_t::i8  : map_data<int8_t>(data.first(data_bytes));  break;
+        case data_type_t::i16 : map_data<int16_t>(data.first(data_bytes)); break;
+        case data_type_t::i32 : map_data<int32_t>(data.first(data_bytes)); break;
+        case data_type_t::f32 : map_data<float>(data.first(data_bytes));   break;
+        case data_type_t::f64 : map_data<double>(data.first(data_bytes));  break;
+        default : break;
+    }
+    data_type = type;
 }
 
 mnist_db::mnist_db(const std::string &img_file, const std::string &label_file) :
     img_data(img_file),
-    label_data(label_file),
-    norm_img_data( img_data.get_u8().size() )
+    label_data(label_file)
 {
     if (img_data.get_u8().size() != img_data.get_num_elements() * img_data.get_element_size()) {
         std::cerr << "unexpected data in img_file" << std::endl;
@@ -103,14 +218,6 @@ mnist_db::mnist_db(const std::string &img_file, const std::string &label_file) :
         std::cerr << "img_file and label_file have different number of elements" << std::endl;
         return;
     }
-
-    for (auto &val : norm_img_data) {
-        std::size_t idx = &val - norm_img_data.data();
-        // addition of epsilon is a ROOT thing and just needed for easier visualization
-        val = std::numeric_limits<float>::epsilon() +
-              static_cast<float>(img_data.get_u8().at(idx)) /
-                  (255.0f + std::numeric_limits<float>::epsilon()*2);
-    }
 }
 
 void mnist_db::print_info() const
@@ -134,21 +241,11 @@ std::span<const uint8_t> mnist_db::get_image(std::size_t idx) const
     return img_data.get_element<uint8_t>(idx);
 }
 
-std::span<const float> mnist_db::get_norm_image(std::size_t idx) const
-{
-    if((idx + 1) * img_data.get_element_size() > norm_img_data.size()) {
-        std::cout << "idx: " << idx << std::endl;
-        std::cout << "elem_size: " << img_data.get_element_size() << std::endl;
-        std::cout << "data.size: " << norm_img_data.size() << std::endl;
-        assert(false);
-    }
-
-    return { norm_img_data.data() + idx * img_data.get_element_size(), img_data.get_element_size()};
-}
-
 uint8_t mnist_db::get_label(std::size_t idx) const
 {
-    return label_data.get_u8().at(idx);
+    // clamped to the last label like all element accesses
+    const auto label = label_data.get_element<uint8_t>(idx);
+    return label.empty() ? 0 : label.front();
 }
 
 std::size_t mnist_db::get_image_cnt() const
@@ -160,4 +257,16 @@ std::size_t mnist_db::get_image_size() const
 {
     return img_data.get_element_size();
 }
+
+std::size_t mnist_db::get_image_width() const
+{
+    const auto &dims = img_data.get_dimensions();
+    return dims.size() == 3 ? dims[2] : get_image_size();
+}
+
+std::size_t mnist_db::get_image_height() const
+{
+    const auto &dims = img_data.get_dimensions();
+    return dims.size() == 3 ? dims[1] : 1;
+}
 } // mdb
\ No newline at end of file
@@ -5,23 +5,52 @@
 #include "mnist_io.h"
 #include "hd_ngm2_tools.h"
 
+#include <cstdio>
+
 namespace sim {
+
+namespace {
+
+// splitmix64 finalizer, decorrelates the seeds of neighboring frames
+uint64_t mix(uint64_t val)
+{
+    val += 0x9E3779B97F4A7C15ull;
+    val  = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9ull;
+    val  = (val ^ (val >> 27)) * 0x94D049BB133111EBull;
+    return val ^ (val >> 31);
+}
+
+uint32_t seed32(uint64_t val)
+{
+    return static_cast<uint32_t>(val ^ (val >> 32));
+}
+
+} // namespace
+
 mnist_io::mnist_io(
     std::size_t _id,
     int _change_interval,
     const std::string &img_file,
     const std::string &label_file,
-    int rnd_seed
+    int rnd_seed,
+    io_elem_t _outp_elem
 ) :
     io_entity(),
     mnist_db(img_file,label_file),
     id(_id),
-    cur_epoch(0),
-    cur_idx(0),
-    ci_cnt(0),
+    outp_elem(_outp_elem),
+    state{0, 0, 0, std::mt19937(rnd_seed)},
     change_interval(_change_interval),
-    rgen(rnd_seed),
-    dis(0.0f,0.05f) // 5% noise
+    dis(0.0f,0.05f), // 5% noise
+    run_ahead_depth(0),
+    run_ahead_interval(_change_interval),
+    ahead_state(state),
+    aug_workers(0),
+    aug_depth(0),
+    seed(static_cast<uint32_t>(rnd_seed)),
+    aug_base(state),
+    aug_valid(false),
+    noise_variants(0)
 {}
 
 void mnist_io::set_outp_func(std::function<std::span<float>()> function)
@@ -29,25 +58,181 @@ void mnist_io::set_outp_func(std::function<std::span<float>()> function)
     output_mem = function;
 }
 
+/*
+ * generates the output of one step from the given state and advances it, shared by the inline and the run-ahead mode.
+ * The u8 image is converted on the fly (see render_image).
+ */
+void mnist_io::generate(std::span<float> outp, gen_state_t &st, int interval) const
+{
+    if (noise_variants > 0 && interval > 0) {
+        std::mt19937 noise_rgen(seed32(noise_seed(st.cur_epoch, st.cur_idx, st.ci_cnt)));
+        mdb::render_image(get_image(st.cur_idx), outp, dis, noise_rgen);
+    } else {
+        mdb::render_image(interval > 0 ? get_image(st.cur_idx) : std::span<const uint8_t>{}, outp, dis, st.rgen);
+    }
+    advance(st, interval, get_image_cnt());
+}
+
+// seed of the random values of a presentation (e.g., its augmentation), with noise variants the epoch only selects the
+// variant
+uint64_t mnist_io::frame_seed(uint64_t epoch, uint64_t idx) const
+{
+    if (noise_variants > 0)
+        epoch %= noise_variants;
+    return mix(mix(mix(seed) ^ epoch) ^ idx);
+}
+
+// seed of the pixel noise of the ci-th step of a presentation, with noise variants the noise is the same for all steps
+uint64_t mnist_io::noise_seed(uint64_t epoch, uint64_t idx, uint64_t ci) const
+{
+    return mix(frame_seed(epoch, idx) ^ (noise_variants > 0 ? 0 : ci + 1));
+}
+
+void mnist_io::advance(gen_state_t &st, int interval, std::size_t image_cnt)
+{
+    if ((interval > 0) && ((++st.ci_cnt %= interval) == 0)) {
+        st.cur_idx = (st.cur_idx + 1) % image_cnt;
+        if (st.cur_idx == 0)
+            ++st.cur_epoch;
+    }
+}
+
+/*
+ * generates the augmented image (without noise) of the seq-th presentation after aug_base, called concurrently by the
+ * workers of the pool. The position of the presentation is computed in closed form, the generator is seeded from the
+ * seed and this position.
+ */
+void mnist_io::generate_augmented(std::span<float> outp, uint64_t seq) const
+{
+    const uint64_t pos   = aug_base.cur_idx + seq;
+    const uint64_t idx   = pos % get_image_cnt();
+    const uint64_t epoch = aug_base.cur_epoch + pos / get_image_cnt();
+
+    std::mt19937 frame_rgen(seed32(frame_seed(epoch, idx)));
+    mdb::augment_image(get_image(idx), get_image_width(), get_image_height(), outp, aug_params, frame_rgen);
+}
+
+void mnist_io::set_augmentation(const mdb::augment_params_t &params, std::size_t workers, std::size_t depth)
+{
+    if (producer) {
+        state = cur_state();
+        producer.reset();
+    }
+    aug_pool.reset();
+    aug_params  = params;
+    aug_workers = workers;
+    aug_depth   = depth;
+}
+
+void mnist_io::set_noise_variants(std::size_t n)
+{
+    // frames generated ahead carry the old noise
+    if (producer) {
+        state = cur_state();
+        producer.reset();
+    }
+    aug_pool.reset();
+    noise_variants = n;
+}
+
+void mnist_io::set_run_ahead(std::size_t depth)
+{
+    if (producer) {
+        state = cur_state();
+        producer.reset();
+    }
+    run_ahead_depth = depth;
+}
+
+const mnist_io::gen_state_t& mnist_io::cur_state() const
+{
+    if (producer && producer->last() != nullptr)
+        return producer->last()->state;
+    return state;
+}
+
+/*
+ * discards all frames generated ahead and continues from the state of the last output
+ */
+void mnist_io::restart_producer()
+{
+    if (!producer) {
+        producer = std::make_unique<run_ahead<frame_t>>(
+            run_ahead_depth,
+            frame_t{ std::vector<float>(get_image_size()), state },
+            [this](frame_t &frame) {
+                generate(frame.data, ahead_state, run_ahead_interval);
+                frame.state = ahead_state;
+            }
+        );
+    }
+    state = cur_state();
+    producer->stop();
+    ahead_state        = state;
+    run_ahead_interval = change_interval;
+    producer->start();
+}
+
+/*
+ * discards all augmented images generated ahead and continues with the presentation of the last output
+ */
+void mnist_io::restart_aug_pool()
+{
+    if (aug_pool)
+        aug_pool->stop();
+    else
+        aug_pool = std::make_unique<aug_pool_t>(
+            aug_workers,
+            aug_depth,
+            std::vector<float>(get_image_size()),
+            [this](std::vector<float> &frame, uint64_t seq) { generate_augmented(frame, seq); }
+        );
+    aug_base  = state;
+    aug_valid = false;
+    aug_pool->start();
+}
+
 void mnist_io::process()
 {
     auto outp = output_mem();
-    if (change_interval > 0) {
-        auto img  = get_norm_image(cur_idx);
-        std::ranges::copy(img,outp.begin());
+
+    // the output of this step is generated from the state after the last output. With noise variants all steps of a
+    // presentation emit the same frame, i.e., the key only identifies the image and the variant
+    if (noise_variants > 0 && change_interval > 0) {
+        const gen_state_t &st = cur_state();
+        last_key = frame_seed(st.cur_epoch, st.cur_idx);
     } else {
-        std::ranges::fill(outp,0.0f);
+        last_key.reset();
     }
 
-    for (auto &ov : outp) {
-        ov = std::clamp(ov + dis(rgen),0.0f,1.0f);
+    if (aug_workers > 0 && change_interval > 0) {
+        // (re)start the pool if it is not running yet, the augmented image is taken once per presentation
+        if (!aug_pool || !aug_pool->running())
+            restart_aug_pool();
+        if (!aug_valid || state.ci_cnt == 0) {
+            const auto &img = aug_pool->next();
+            aug_image.assign(img.begin(), img.end());
+            aug_valid = true;
+        }
+        std::mt19937 noise_rgen(seed32(noise_seed(state.cur_epoch, state.cur_idx, state.ci_cnt)));
+        auto noise = dis;
+        for (std::size_t i = 0; i < outp.size(); ++i)
+            outp[i] = std::min(aug_image[i] + noise(noise_rgen), 1.0f);
+        advance(state, change_interval, get_image_cnt());
+        return;
     }
 
-    if ((change_interval > 0) && ((++ci_cnt %= change_interval) == 0)) {
-        cur_idx = (cur_idx + 1) % get_image_cnt();
-        if (cur_idx == 0)
-            ++cur_epoch;
+    if (run_ahead_depth == 0 || aug_workers > 0) {
+        generate(outp, state, change_interval);
+        return;
     }
+
+    // (re)start the producer if it is not running yet or if the change interval was modified (e.g., by the gui)
+    if (!producer || !producer->running() || run_ahead_interval != change_interval)
+        restart_producer();
+
+    const frame_t &frame = producer->next();
+    std::ranges::copy(frame.data, outp.begin());
 }
 
 std::size_t mnist_io::get_outp_id() const
@@ -64,8 +249,43 @@ std::string mnist_io::status_str() const
 {
     std::string status { "MNIST IO" };
     status += " | id: " + std::to_string(get_outp_id());
-    status += " | epoch: " + std::to_string(cur_epoch);
-    status += " | idx: " + std::to_string(cur_idx);
+    status += " | epoch: " + std::to_string(cur_state().cur_epoch);
+    status += " | idx: " + std::to_string(cur_state().cur_idx);
+    if (aug_workers > 0)
+        status += " | augment: " + std::to_string(aug_workers) + " workers";
+    if (noise_variants > 0)
+        status += " | noise variants: " + std::to_string(noise_variants);
     return status;
 }
+
+// in run-ahead mode the state of the last output is stored, i.e., frames generated ahead are not part of checkpoints
+void mnist_io::save_state(checkpoint_writer &cw) const
+{
+    const gen_state_t &st = cur_state();
+    cw.write<uint64_t>(st.cur_epoch);
+    cw.write<uint64_t>(st.cur_idx);
+    cw.write<uint64_t>(st.ci_cnt);
+    cw.write(change_interval);
+    cw.write_rng(st.rgen);
+}
+
+bool mnist_io::load_state(checkpoint_reader &cr)
+{
+    // the frames generated ahead belong to the old state, the producer is restarted on the next process() call
+    if (producer)
+        producer->stop();
+    if (aug_pool)
+        aug_pool->stop();
+    aug_valid = false;
+    state.cur_epoch = cr.read<uint64_t>();
+    state.cur_idx   = cr.read<uint64_t>();
+    state.ci_cnt    = cr.read<uint64_t>();
+    cr.read_into(change_interval);
+    cr.read_rng(state.rgen);
+    if (state.cur_idx >= get_image_cnt()) {
+        std::fprintf(stderr, "mnist position in checkpoint exceeds the data set\n");
+        return false;
+    }
+    return cr.good();
+}
 } // sim
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "readout.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace sim {
+
+void vote_readout::fit(
+    std::span<const float>   features,
+    std::span<const uint8_t> labels,
+    std::size_t              _feature_cnt,
+    std::size_t              _label_cnt
+){
+    feature_cnt = _feature_cnt;
+    label_cnt   = _label_cnt;
+
+    // mean activity of every feature per label
+    std::vector<double>      act_sum(feature_cnt * label_cnt, 0.0);
+    std::vector<std::size_t> label_freq(label_cnt, 0);
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        const auto row = features.subspan(i * feature_cnt, feature_cnt);
+        for (std::size_t f = 0; f < feature_cnt; ++f)
+            act_sum[f * label_cnt + labels[i]] += row[f];
+        ++label_freq[labels[i]];
+    }
+
+    assignment.assign(feature_cnt, 0);
+    std::vector<std::size_t> voter_cnt(label_cnt, 0);
+    for (std::size_t f = 0; f < feature_cnt; ++f) {
+        double best = -1.0;
+        for (std::size_t l = 0; l < label_cnt; ++l) {
+            if (label_freq[l] == 0)
+                continue;
+            const double mean = act_sum[f * label_cnt + l] / static_cast<double>(label_freq[l]);
+            if (mean > best) {
+                best          = mean;
+                assignment[f] = static_cast<uint8_t>(l);
+            }
+        }
+        ++voter_cnt[assignment[f]];
+    }
+
+    voter_weight.resize(label_cnt);
+    for (std::size_t l = 0; l < label_cnt; ++l)
+        voter_weight[l] = voter_cnt[l] > 0 ? 1.0f / static_cast<float>(voter_cnt[l]) : 0.0f;
+}
+
+uint8_t vote_readout::predict(std::span<const float> row) const
+{
+    std::vector<float> votes(label_cnt, 0.0f);
+    for (std::size_t f = 0; f < feature_cnt; ++f)
+        votes[assignment[f]] += row[f];
+    for (std::size_t l = 0; l < label_cnt; ++l)
+        votes[l] *= voter_weight[l];
+    return static_cast<uint8_t>(std::ranges::max_element(votes) - votes.begin());
+}
+
+bool linear_readout::fit(
+    std::span<const float>   features,
+    std::span<const uint8_t> labels,
+    std::size_t              _feature_cnt,
+    std::size_t              _label_cnt,
+    double                   ridge
+){
+    feature_cnt = _feature_cnt;
+    label_cnt   = _label_cnt;
+    const std::size_t dim = feature_cnt + 1; // constant 1 as last input models the bias
+
+    // normal equations (X^T X + lambda I) W = X^T Y, only the lower triangle of X^T X is accumulated
+    std::vector<double> xtx(dim * dim, 0.0);
+    std::vector<double> xty(dim * label_cnt, 0.0);
+    std::vector<double> x(dim);
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+        const auto row = features.subspan(i * feature_cnt, feature_cnt);
+        std::ranges::copy(row, x.begin());
+        x[feature_cnt] = 1.0;
+        for (std::size_t r = 0; r < dim; ++r) {
+            if (x[r] == 0.0)
+                continue;
+            for (std::size_t c = 0; c <= r; ++c)
+                xtx[r * dim + c] += x[r] * x[c];
+            xty[r * label_cnt + labels[i]] += x[r];
+        }
+    }
+
+    // the penalty is scaled by the mean feature energy, the bias is not penalized
+    double trace = 0.0;
+    for (std::size_t f = 0; f < feature_cnt; ++f)
+        trace += xtx[f * dim + f];
+    const double lambda = ridge * std::max(trace / static_cast<double>(std::max<std::size_t>(feature_cnt, 1)), 1e-12);
+    for (std::size_t f = 0; f < feature_cnt; ++f)
+        xtx[f * dim + f] += lambda;
+
+    // in-place Cholesky decomposition L L^T of the lower triangle
+    for (std::size_t j = 0; j < dim; ++j) {
+        double diag = xtx[j * dim + j];
+        for (std::size_t k = 0; k < j; ++k)
+            diag -= xtx[j * dim + k] * xtx[j * dim + k];
+        if (diag <= 0.0) {
+            std::fprintf(stderr, "linear readout: normal equations are not positive definite\n");
+            return false;
+        }
+        diag = std::sqrt(diag);
+        xtx[j * dim + j] = diag;
+        for (std::size_t i = j + 1; i < dim; ++i) {
+            double val = xtx[i * dim + j];
+            for (std::size_t k = 0; k < j; ++k)
+                val -= xtx[i * dim + k] * xtx[j * dim + k];
+            xtx[i * dim + j] = val / diag;
+        }
+    }
+
+    // forward (L z = X^T Y) and backward (L^T W = z) substitution for all labels at once
+    weights = std::move(xty);
+    for (std::size_t i = 0; i < dim; ++i) {
+        for (std::size_t k = 0; k < i; ++k)
+            for (std::size_t l = 0; l < label_cnt; ++l)
+                weights[i * label_cnt + l] -= xtx[i * dim + k] * weights[k * label_cnt + l];
+        for (std::size_t l = 0; l < label_cnt; ++l)
+            weights[i * label_cnt + l] /= xtx[i * dim + i];
+    }
+    for (std::size_t i = dim; i-- > 0; ) {
+        for (std::size_t k = i + 1; k < dim; ++k)
+            for (std::size_t l = 0; l < label_cnt; ++l)
+                weights[i * label_cnt + l] -= xtx[k * dim + i] * weights[k * label_cnt + l];
+        for (std::size_t l = 0; l < label_cnt; ++l)
+            weights[i * label_cnt + l] /= xtx[i * dim + i];
+    }
+    return true;
+}
+
+uint8_t linear_readout::predict(std::span<const float> row) const
+{
+    std::vector<double> out(weights.begin() + static_cast<std::ptrdiff_t>(feature_cnt * label_cnt), weights.end());
+    for (std::size_t f = 0; f < feature_cnt; ++f) {
+        if (row[f] == 0.0f)
+            continue;
+        for (std::size_t l = 0; l < label_cnt; ++l)
+            out[l] += row[f] * weights[f * label_cnt + l];
+    }
+    return static_cast<uint8_t>(std::ranges::max_element(out) - out.begin());
+}
+
+} // sim
@@ -0,0 +1,241 @@
+#include "synthetic_io.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace sim {
+
+namespace {
+
+// maps a 32 bit random value onto [0..range) by a multiplication instead of a division (Lemire), slightly biased
+// for ranges that are not powers of two, which does not matter for synthetic patterns
+uint32_t draw(std::mt19937 &rgen, std::size_t range)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(rgen()) * range) >> 32);
+}
+
+} // namespace
+
+synthetic_io::synthetic_io(
+    std::size_t _id,
+    int         _change_interval,
+    params_t    _params,
+    int         rnd_seed,
+    io_elem_t   _outp_elem
+) :
+    io_entity(),
+    id(_id),
+    outp_elem(_outp_elem),
+    params(_params),
+    change_interval(_change_interval),
+    rgen(rnd_seed)
+{
+    params.size         = std::max<std::size_t>(params.size, 1);
+    params.sparsity     = std::clamp(params.sparsity, 0.0f, 0.5f);
+    params.pattern_cnt  = std::max<std::size_t>(params.pattern_cnt, 1);
+    params.sequence_len = std::max<std::size_t>(params.sequence_len, 1);
+    params.noise        = std::clamp(params.noise, 0.0f, 1.0f);
+    if (params.width == 0)
+        params.width = static_cast<std::size_t>(std::lround(std::sqrt(static_cast<double>(params.size))));
+    params.width = std::clamp<std::size_t>(params.width, 1, params.size);
+    height       = params.size / params.width;  // remaining elements of non-rectangular sizes stay inactive
+    params.bar_width = std::clamp<std::size_t>(params.bar_width, 1, std::min(params.width, height));
+
+    active_cnt = std::max<std::size_t>(1, static_cast<std::size_t>(std::lround(params.sparsity * static_cast<float>(params.size))));
+    marks.resize(params.size);
+
+    if (params.kind == kind_t::prototypes || params.kind == kind_t::sequences) {
+        patterns.resize(params.kind == kind_t::prototypes ? params.pattern_cnt : params.pattern_cnt * params.sequence_len);
+        for (auto &pattern : patterns)
+            random_pattern(pattern);
+    }
+    if (params.kind == kind_t::sequences) {
+        std::vector<double> weights(params.pattern_cnt);
+        for (std::size_t i = 0; i < weights.size(); ++i)
+            weights[i] = 1.0 / static_cast<double>(i + 1);
+        seq_dist = std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+    }
+}
+
+void synthetic_io::set_outp_func(std::function<std::span<float>()> function)
+{
+    output_mem = function;
+}
+
+// draws active_cnt distinct elements (rejection sampling, the sparsity is at most 0.5)
+void synthetic_io::random_pattern(std::vector<uint32_t> &dst)
+{
+    dst.clear();
+    while (dst.size() < active_cnt) {
+        const uint32_t elem = draw(rgen, params.size);
+        if (marks[elem] == 0) {
+            marks[elem] = 1;
+            dst.push_back(elem);
+        }
+    }
+    for (const auto elem : dst)
+        marks[elem] = 0;
+}
+
+// copies a fixed pattern into active and moves the given fraction (noise) of its elements to random inactive positions
+void synthetic_io::distort(const std::vector<uint32_t> &src)
+{
+    active = src;
+    // without any inactive position (size 1) there is nowhere to move an element to
+    if (params.noise <= 0.0f || active.size() >= params.size)
+        return;
+    // an element is moved if a 32 bit random value falls below the noise fraction of the 32 bit range
+    const auto move_thres = static_cast<uint64_t>(static_cast<double>(params.noise) * 4294967296.0);
+    for (const auto elem : active)
+        marks[elem] = 1;
+    for (auto &elem : active) {
+        if (rgen() >= move_thres)
+            continue;
+        uint32_t target = draw(rgen, params.size);
+        while (marks[target] != 0)
+            target = draw(rgen, params.size);
+        marks[elem]   = 0;
+        marks[target] = 1;
+        elem          = target;
+    }
+    for (const auto elem : active)
+        marks[elem] = 0;
+}
+
+void synthetic_io::next_pattern()
+{
+    switch (params.kind) {
+        case kind_t::sparse_random:
+            random_pattern(active);
+            cur_label = pattern_nr;
+            break;
+        case kind_t::prototypes: {
+            std::uniform_int_distribution<std::size_t> proto_dist(0, params.pattern_cnt - 1);
+            cur_label = proto_dist(rgen);
+            distort(patterns[cur_label]);
+            break;
+        }
+        case kind_t::sequences: {
+            std::size_t seq = cur_label / params.sequence_len;
+            if (pattern_nr == 0 || ++seq_pos == params.sequence_len) {
+                seq     = seq_dist(rgen);
+                seq_pos = 0;
+            }
+            cur_label = seq * params.sequence_len + seq_pos;
+            distort(patterns[cur_label]);
+            break;
+        }
+        case kind_t::moving_bars: {
+            const std::size_t extent = bar_vertical ? params.width : height;
+            if (pattern_nr == 0 || bar_pos + params.bar_width >= extent) {
+                bar_vertical = static_cast<uint8_t>(rgen() & 1);
+                bar_reverse  = static_cast<uint8_t>(rgen() & 1);
+                bar_pos      = 0;
+            } else {
+                ++bar_pos;
+            }
+            cur_label = bar_vertical;
+            break;
+        }
+    }
+    ++pattern_nr;
+}
+
+void synthetic_io::render_bar(std::span<float> outp) const
+{
+    const std::size_t extent = bar_vertical ? params.width : height;
+    const std::size_t first  = bar_reverse ? extent - params.bar_width - bar_pos : bar_pos;
+    if (bar_vertical) {
+        for (std::size_t y = 0; y < height; ++y)
+            std::ranges::fill(outp.subspan(y * params.width + first, params.bar_width), 1.0f);
+    } else {
+        std::ranges::fill(outp.subspan(first * params.width, params.bar_width * params.width), 1.0f);
+    }
+}
+
+void synthetic_io::process()
+{
+    auto outp = output_mem();
+    if (pattern_nr == 0 || (change_interval > 0 && ci_cnt == 0))
+        next_pattern();
+
+    std::ranges::fill(outp, 0.0f);
+    if (params.kind == kind_t::moving_bars) {
+        render_bar(outp);
+    } else {
+        for (const auto elem : active)
+            outp[elem] = 1.0f;
+    }
+
+    if (change_interval > 0)
+        ci_cnt = (ci_cnt + 1) % static_cast<std::size_t>(change_interval);
+}
+
+std::size_t synthetic_io::get_outp_sparsity() const
+{
+    if (params.kind == kind_t::moving_bars)
+        return params.bar_width * std::max(params.width, height);
+    return active_cnt;
+}
+
+std::size_t synthetic_io::get_label_cnt() const
+{
+    switch (params.kind) {
+        case kind_t::prototypes:  return params.pattern_cnt;
+        case kind_t::sequences:   return params.pattern_cnt * params.sequence_len;
+        case kind_t::moving_bars: return 2;
+        default:                  return 0;
+    }
+}
+
+std::string synthetic_io::status_str() const
+{
+    static constexpr const char *kind_names[] = { "random", "prototypes", "bars", "sequences" };
+    std::string status { "SYNTHETIC IO" };
+    status += " | id: " + std::to_string(id);
+    status += " | kind: " + std::string(kind_names[static_cast<std::size_t>(params.kind)]);
+    status += " | pattern: " + std::to_string(pattern_nr);
+    status += " | label: " + std::to_string(cur_label);
+    return status;
+}
+
+// the fixed patterns are derived from the seed and not stored
+void synthetic_io::save_state(checkpoint_writer &cw) const
+{
+    cw.write<uint64_t>(ci_cnt);
+    cw.write<uint64_t>(pattern_nr);
+    cw.write<uint64_t>(cur_label);
+    cw.write<uint64_t>(seq_pos);
+    cw.write<uint64_t>(bar_pos);
+    cw.write(bar_vertical);
+    cw.write(bar_reverse);
+    cw.write_array(active);
+    cw.write(change_interval);
+    cw.write_rng(rgen);
+}
+
+bool synthetic_io::load_state(checkpoint_reader &cr)
+{
+    ci_cnt     = cr.read<uint64_t>();
+    pattern_nr = cr.read<uint64_t>();
+    cur_label  = cr.read<uint64_t>();
+    seq_pos    = cr.read<uint64_t>();
+    bar_pos    = cr.read<uint64_t>();
+    cr.read_into(bar_vertical);
+    cr.read_into(bar_reverse);
+    cr.read_array_into(active);
+    cr.read_into(change_interval);
+    cr.read_rng(rgen);
+
+    const bool label_ok = get_label_cnt() == 0 || cur_label < get_label_cnt();
+    const bool bar_ok   = bar_pos + params.bar_width <= (bar_vertical ? params.width : height);
+    if (!label_ok || !bar_ok || seq_pos >= params.sequence_len ||
+        std::ranges::any_of(active, [this](uint32_t elem) { return elem >= params.size; })) {
+        std::fprintf(stderr, "synthetic io state in checkpoint does not match the parameters\n");
+        return false;
+    }
+    return cr.good();
+}
+
+} // sim
@@ -0,0 +1,554 @@
+#include "topology.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <set>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "hd_ngm2_cfg.h"
+#include "mnist_io.h"
+#include "sim_alloc.h"
+
+namespace sim {
+
+using json = nlohmann::json;
+
+namespace {
+
+/*
+ * helper functions to parse the parameter overrides of a neuron group (after merging with the preset)
+ */
+void parse_sigmoid(const json &j, ngm2::sigmoid_shape_t &shape)
+{
+    shape.steepness        = j.at(0).get<float>();
+    shape.transition_point = j.at(1).get<float>();
+}
+
+template<class T>
+void parse_opt(const json &j, const char *key, T &val)
+{
+    if (const auto it = j.find(key); it != j.end())
+        val = it->get<T>();
+}
+
+bool parse_dendrite_params(const json &j, ngm2::dendrite_t::params_t &dp)
+{
+    if (const auto it = j.find("type"); it != j.end()) {
+        const auto type = it->get<std::string>();
+        if (type == "proximal")
+            dp.type = ngm2::dendrite_t::type_t::proximal;
+        else if (type == "apical")
+            dp.type = ngm2::dendrite_t::type_t::apical;
+        else {
+            std::fprintf(stderr, "unknown dendrite type \"%s\" in topology\n", type.c_str());
+            return false;
+        }
+    }
+    int max_branch_level = dp.max_branch_level;
+    parse_opt(j, "max_branch_level", max_branch_level);
+    if (max_branch_level < 0 || max_branch_level > ngm2::dendrite_t::max_supported_branch_level) {
+        std::fprintf(stderr, "max_branch_level %d in topology is outside of [0, %d]\n",
+            max_branch_level, ngm2::dendrite_t::max_supported_branch_level);
+        return false;
+    }
+    dp.max_branch_level = static_cast<uint8_t>(max_branch_level);
+
+    parse_opt(j, "permanence_threshold",    dp.permanence_threshold);
+    parse_opt(j, "primary_learning_rate",   dp.default_primary_learning_rate);
+    parse_opt(j, "secondary_learning_rate", dp.default_secondary_learning_rate);
+    parse_opt(j, "mismatch_act_thres",      dp.default_mismatch_act_thres);
+    parse_opt(j, "mismatch_smoothing",      dp.default_mismatch_smoothing);
+    parse_opt(j, "accumulated_theta_thres", dp.default_accumulated_theta_thres);
+    parse_opt(j, "min_mismatch_deviation",  dp.default_min_mismatch_deviation);
+    parse_opt(j, "min_mismatch_percentage", dp.default_min_mismatch_percentage);
+    return true;
+}
+
+/*
+ * element type of the precision given by key ("f32", "f16" or "u8"), "native" (the element type of the buffers) leaves
+ * elem empty if allowed. Unknown values are reported with the given kind of precision.
+ */
+bool parse_elem(
+    const json               &j,
+    const char               *key,
+    const char               *default_val,
+    bool                      allow_native,
+    const char               *kind,
+    std::optional<io_elem_t> &elem
+){
+    const auto precision = j.value(key, std::string{default_val});
+    if (precision == "f32")
+        elem = io_elem_t::f32;
+    else if (precision == "f16")
+        elem = io_elem_t::f16;
+    else if (precision == "u8")
+        elem = io_elem_t::u8;
+    else if (!allow_native || precision != "native") {
+        std::fprintf(stderr, "unknown %s precision \"%s\" in topology\n", kind, precision.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::optional<io_elem_t> parse_precision(const json &j)
+{
+    std::optional<io_elem_t> elem;
+    if (!parse_elem(j, "output_precision", "f32", false, "output", elem))
+        return {};
+    return elem;
+}
+
+/*
+ * input delays ({ "<input id>": <delay>, ... }), the keys are converted with a checked conversion as conversion errors
+ * are not covered by the json exceptions
+ */
+template<class K>
+bool parse_input_delays(const json &j, std::map<K,std::size_t> &delays)
+{
+    const auto it = j.find("input_delays");
+    if (it == j.end())
+        return true;
+    for (const auto &[key, delay] : it->items()) {
+        K inp_id {};
+        const auto [end, ec] = std::from_chars(key.data(), key.data() + key.size(), inp_id);
+        if (ec != std::errc{} || end != key.data() + key.size()) {
+            std::fprintf(stderr, "invalid input id \"%s\" in input_delays of topology\n", key.c_str());
+            return false;
+        }
+        delays[inp_id] = delay.template get<std::size_t>();
+    }
+    return true;
+}
+
+// recorder parameters, the recorded element type stays empty for "native" (the element type of the buffers)
+std::optional<recorder_params_t> parse_recorder(const json &j)
+{
+    recorder_params_t params;
+    if (!parse_elem(j, "precision", "native", true, "recording", params.elem))
+        return {};
+    parse_opt(j, "compress",          params.compress);
+    parse_opt(j, "keyframe_interval", params.keyframe_interval);
+    parse_opt(j, "queue_depth",       params.queue_depth);
+    return params;
+}
+
+// layer freezing (see env::freeze), the cached element type stays empty for "native" (the element type of the buffers)
+std::optional<topology_plan_t::freeze_cfg_t> parse_freeze(const json &j)
+{
+    topology_plan_t::freeze_cfg_t cfg { j.at("source").get<std::size_t>(), j.at("entities").get<std::vector<std::size_t>>(), {} };
+    if (!parse_elem(j, "precision", "native", true, "cache", cfg.params.elem))
+        return {};
+    if (const auto it = j.find("max_mb"); it != j.end())
+        cfg.params.max_bytes = it->get<std::size_t>() << 20;
+    return cfg;
+}
+
+std::optional<ngm2::neuron_group_t::params_t> parse_neuron_group(const json &j)
+{
+    const auto id         = j.at("id").get<std::size_t>();
+    const auto neuron_cnt = j.at("neurons").get<std::size_t>();
+    const auto input_size = j.at("input_size").get<std::size_t>();
+    const auto inputs     = j.at("inputs").get<std::set<ngm2::partial_id_t>>();
+    const auto seed       = j.value("seed", 0);
+    const auto dend_cnt   = j.value("dendrites", std::size_t{3});
+
+    // basic_cng provides the defaults (and the seeding scheme) for everything that is not overridden
+    auto params = ngm2::basic_cng(id, neuron_cnt, input_size, inputs, seed, dend_cnt);
+
+    parse_opt(j, "local_inhibition_strength", params.default_local_inhibition_strength);
+    parse_opt(j, "common_learning_rate",      params.default_common_learning_rate);
+    parse_opt(j, "stochastic_win_thres",      params.default_stochastic_win_thres);
+    parse_opt(j, "k_winners",                 params.k_winners);
+    parse_opt(j, "sparse_inputs",             params.sparse_inputs);
+    if (const auto precision = parse_precision(j))
+        params.outp_elem = *precision;
+    else
+        return {};
+    if (const auto it = j.find("weight_filter"); it != j.end())
+        parse_sigmoid(*it, params.default_weight_filter);
+
+    if (!parse_input_delays(j, params.input_delays))
+        return {};
+
+    // neuron and dendrite parameters are identical for all neurons of the group (except for the seeds)
+    const json dend_j = j.value("dendrite", json::object());
+    for (auto &np : params.neuron_params) {
+        parse_opt(j, "branch_interval", np.default_branch_interval);
+        if (const auto it = j.find("activity_learning_window"); it != j.end()) {
+            parse_sigmoid(it->at(0), np.default_activity_learning_window.first);
+            parse_sigmoid(it->at(1), np.default_activity_learning_window.second);
+        }
+        for (auto &dp : np.dendrite_params) {
+            if (!parse_dendrite_params(dend_j, dp))
+                return {};
+        }
+    }
+    return params;
+}
+
+std::optional<external_input::empty_policy_t> parse_empty_policy(const json &j)
+{
+    const auto policy = j.value("on_empty", std::string{"block"});
+    if (policy == "block")
+        return external_input::empty_policy_t::block;
+    if (policy == "zero")
+        return external_input::empty_policy_t::zero;
+    if (policy == "repeat")
+        return external_input::empty_policy_t::repeat;
+    std::fprintf(stderr, "unknown empty policy \"%s\" in topology\n", policy.c_str());
+    return {};
+}
+
+std::optional<synthetic_params_t> parse_synthetic(const json &j)
+{
+    synthetic_params_t params;
+    const auto kind = j.value("kind", std::string{"prototypes"});
+    if (kind == "random")
+        params.kind = synthetic_params_t::kind_t::sparse_random;
+    else if (kind == "prototypes")
+        params.kind = synthetic_params_t::kind_t::prototypes;
+    else if (kind == "bars")
+        params.kind = synthetic_params_t::kind_t::moving_bars;
+    else if (kind == "sequences")
+        params.kind = synthetic_params_t::kind_t::sequences;
+    else {
+        std::fprintf(stderr, "unknown synthetic input kind \"%s\" in topology\n", kind.c_str());
+        return {};
+    }
+    parse_opt(j, "size",         params.size);
+    parse_opt(j, "sparsity",     params.sparsity);
+    parse_opt(j, "patterns",     params.pattern_cnt);
+    parse_opt(j, "sequence_len", params.sequence_len);
+    parse_opt(j, "noise",        params.noise);
+    parse_opt(j, "width",        params.width);
+    parse_opt(j, "bar_width",    params.bar_width);
+    return params;
+}
+
+std::optional<std::string> resolve(const std::string &val, const std::map<std::string,std::string> &vars)
+{
+    if (!val.starts_with('$'))
+        return val;
+    const auto it = vars.find(val.substr(1));
+    if (it == vars.end()) {
+        std::fprintf(stderr, "undefined variable \"%s\" in topology\n", val.c_str());
+        return {};
+    }
+    return it->second;
+}
+
+/*
+ * greedy longest-processing-time-first partitioning of the entities onto the given number of partitions
+ */
+std::vector<std::vector<std::size_t>> partition_entities(
+    const std::vector<topology_plan_t::entity_info_t> &entities,
+    std::size_t                                       partition_cnt
+){
+    partition_cnt = std::min(partition_cnt, entities.size());
+    if (partition_cnt <= 1)
+        return {};
+
+    std::vector<std::size_t> order(entities.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::ranges::stable_sort(order, [&](std::size_t a, std::size_t b) { return entities[a].cost > entities[b].cost; });
+
+    std::vector<std::vector<std::size_t>> partitions(partition_cnt);
+    std::vector<double> load(partition_cnt, 0.0);
+    for (const auto idx : order) {
+        const auto min_part = std::ranges::min_element(load) - load.begin();
+        partitions[min_part].push_back(entities[idx].id);
+        load[min_part] += entities[idx].cost;
+    }
+    for (auto &part : partitions)
+        std::ranges::sort(part);
+    return partitions;
+}
+
+} // namespace
+
+std::optional<topology_plan_t> compile_topology(
+    const std::string                        &file_name,
+    const std::map<std::string,std::string>  &vars
+){
+    std::ifstream file { file_name };
+    if (!file) {
+        std::fprintf(stderr, "could not open topology file %s\n", file_name.c_str());
+        return {};
+    }
+
+    topology_plan_t plan;
+    try {
+        const json topo    = json::parse(file);
+        const json presets = topo.value("presets", json::object());
+
+        // 1. merge each entity with its preset and sort by id
+        std::vector<json> entity_cfgs;
+        for (const auto &ent : topo.at("entities")) {
+            json cfg = json::object();
+            if (const auto it = ent.find("preset"); it != ent.end()) {
+                const auto preset = presets.find(it->get<std::string>());
+                if (preset == presets.end()) {
+                    std::fprintf(stderr, "unknown preset \"%s\" in topology\n", it->get<std::string>().c_str());
+                    return {};
+                }
+                cfg = *preset;
+            }
+            cfg.merge_patch(ent);
+            entity_cfgs.push_back(std::move(cfg));
+        }
+        std::ranges::stable_sort(entity_cfgs, {}, [](const json &cfg) { return cfg.at("id").get<std::size_t>(); });
+
+        // 2. parse the entities
+        std::set<std::size_t> ids;
+        for (const auto &cfg : entity_cfgs) {
+            const auto id      = cfg.at("id").get<std::size_t>();
+            const auto type    = cfg.at("type").get<std::string>();
+            const auto divider = std::max(cfg.value("clock_divider", std::size_t{1}), std::size_t{1});
+            const auto phase   = cfg.value("clock_phase", std::size_t{0});
+            if (!ids.insert(id).second) {
+                std::fprintf(stderr, "duplicate entity id %zu in topology\n", id);
+                return {};
+            }
+            if (type == "mnist_io") {
+                auto image_file = resolve(cfg.at("image_file").get<std::string>(), vars);
+                auto label_file = resolve(cfg.at("label_file").get<std::string>(), vars);
+                const auto precision = parse_precision(cfg);
+                if (!image_file || !label_file || !precision)
+                    return {};
+                mdb::augment_params_t augment;
+                std::size_t augment_workers = 0;
+                std::size_t augment_depth   = 64;
+                if (const auto aug = cfg.find("augment"); aug != cfg.end()) {
+                    augment_workers = 4;
+                    parse_opt(*aug, "shift",          augment.max_shift);
+                    parse_opt(*aug, "rotation",       augment.max_rotation);
+                    parse_opt(*aug, "elastic_alpha",  augment.elastic_alpha);
+                    parse_opt(*aug, "elastic_sigma",  augment.elastic_sigma);
+                    parse_opt(*aug, "contrast",       augment.contrast);
+                    parse_opt(*aug, "occlusion",      augment.occlusion_prob);
+                    parse_opt(*aug, "occlusion_size", augment.occlusion_size);
+                    parse_opt(*aug, "workers",        augment_workers);
+                    parse_opt(*aug, "depth",          augment_depth);
+                }
+                plan.mnist_ios.push_back({
+                    id,
+                    cfg.value("change_interval", 15),
+                    std::move(*image_file),
+                    std::move(*label_file),
+                    cfg.value("seed", 0),
+                    *precision,
+                    cfg.value("run_ahead", std::size_t{0}),
+                    augment,
+                    augment_workers,
+                    augment_depth,
+                    cfg.value("noise_variants", std::size_t{0})
+                });
+                plan.entities.push_back({ id, {}, 0, 1.0 / static_cast<double>(divider), divider, phase });
+            } else if (type == "idx_stream") {
+                auto image_file = resolve(cfg.at("image_file").get<std::string>(), vars);
+                auto label_file = resolve(cfg.at("label_file").get<std::string>(), vars);
+                const auto precision = parse_precision(cfg);
+                if (!image_file || !label_file || !precision)
+                    return {};
+                idx_stream_params_t params;
+                parse_opt(cfg, "chunk_size", params.chunk_size);
+                parse_opt(cfg, "window",     params.window);
+                parse_opt(cfg, "shuffle",    params.shuffle);
+                plan.idx_streams.push_back({
+                    id,
+                    cfg.value("change_interval", 15),
+                    std::move(*image_file),
+                    std::move(*label_file),
+                    cfg.value("seed", 0),
+                    *precision,
+                    params
+                });
+                plan.entities.push_back({ id, {}, 0, 1.0 / static_cast<double>(divider), divider, phase });
+            } else if (type == "synthetic") {
+                const auto precision = parse_precision(cfg);
+                const auto params    = parse_synthetic(cfg);
+                if (!precision || !params)
+                    return {};
+                plan.synthetics.push_back({ id, cfg.value("change_interval", 15), *params, cfg.value("seed", 0), *precision });
+                plan.entities.push_back({ id, {}, 0, 1.0 / static_cast<double>(divider), divider, phase });
+            } else if (type == "external_input") {
+                const auto precision = parse_precision(cfg);
+                const auto on_empty  = parse_empty_policy(cfg);
+                if (!precision || !on_empty)
+                    return {};
+                plan.external_inputs.push_back({
+                    id,
+                    cfg.at("size").get<std::size_t>(),
+                    cfg.value("queue_depth", std::size_t{4}),
+                    *on_empty,
+                    *precision
+                });
+                plan.entities.push_back({ id, {}, 0, 1.0 / static_cast<double>(divider), divider, phase });
+            } else if (type == "output_tap") {
+                topology_plan_t::output_tap_cfg_t tap {
+                    id,
+                    cfg.at("inputs").get<std::vector<std::size_t>>(),
+                    cfg.at("input_size").get<std::size_t>(),
+                    cfg.value("queue_depth", std::size_t{0}),
+                    {}
+                };
+                if (!parse_input_delays(cfg, tap.inp_delays))
+                    return {};
+                plan.entities.push_back({ id, tap.inp_ids, tap.input_size, 1.0 / static_cast<double>(divider), divider, phase });
+                plan.output_taps.push_back(std::move(tap));
+            } else if (type == "replay") {
+                auto file_name = resolve(cfg.at("file").get<std::string>(), vars);
+                if (!file_name)
+                    return {};
+                std::optional<std::size_t> stream_id;
+                if (const auto it = cfg.find("stream"); it != cfg.end())
+                    stream_id = it->get<std::size_t>();
+                plan.replays.push_back({ id, std::move(*file_name), cfg.value("loop", true), stream_id });
+                plan.entities.push_back({ id, {}, 0, 1.0 / static_cast<double>(divider), divider, phase });
+            } else if (type == "recorder") {
+                auto       file_name = resolve(cfg.at("file").get<std::string>(), vars);
+                const auto params    = parse_recorder(cfg);
+                if (!file_name || !params)
+                    return {};
+                topology_plan_t::recorder_cfg_t rec { id, cfg.at("inputs").get<std::vector<std::size_t>>(), std::move(*file_name), *params };
+                plan.entities.push_back({ id, rec.inp_ids, 0, 1.0 / static_cast<double>(divider), divider, phase });
+                plan.recorders.push_back(std::move(rec));
+            } else if (type == "neuron_group") {
+                auto params = parse_neuron_group(cfg);
+                if (!params)
+                    return {};
+                const auto &dp = params->neuron_params.front().dendrite_params.front();
+                const double cost = static_cast<double>(params->neuron_params.size())
+                                  * static_cast<double>(params->neuron_params.front().dendrite_params.size())
+                                  * static_cast<double>(dp.input_size)
+                                  * static_cast<double>(dp.max_branch_level + 1)
+                                  / static_cast<double>(divider);
+                plan.entities.push_back({
+                    id, { dp.input_ids.begin(), dp.input_ids.end() }, dp.input_size, cost, divider, phase
+                });
+                plan.neuron_groups.push_back(std::move(*params));
+            } else {
+                std::fprintf(stderr, "unknown entity type \"%s\" in topology\n", type.c_str());
+                return {};
+            }
+        }
+
+        // 3. validate connections
+        for (const auto &ent : plan.entities) {
+            for (const auto inp_id : ent.inp_ids) {
+                if (!ids.contains(inp_id)) {
+                    std::fprintf(stderr, "entity %zu references missing input %zu in topology\n", ent.id, inp_id);
+                    return {};
+                }
+            }
+        }
+
+        // 4. thread partitioning
+        plan.partitions = partition_entities(plan.entities, topo.value("threads", std::size_t{1}));
+        plan.huge_pages = topo.value("huge_pages", false);
+
+        // 5. layer freezing, the connections of the frozen entities are validated by env::freeze
+        if (const auto it = topo.find("freeze"); it != topo.end()) {
+            plan.freeze = parse_freeze(*it);
+            if (!plan.freeze)
+                return {};
+            for (const auto id : plan.freeze->ids) {
+                if (!ids.contains(id)) {
+                    std::fprintf(stderr, "frozen entity %zu is missing in topology\n", id);
+                    return {};
+                }
+            }
+        }
+    }
+    catch (const json::exception &e) {
+        std::fprintf(stderr, "invalid topology file %s: %s\n", file_name.c_str(), e.what());
+        return {};
+    }
+    return plan;
+}
+
+bool instantiate_topology(env &sim_env, topology_plan_t &&plan)
+{
+    // has to be set before the entities allocate their synapses, the per dendrite arrays are too small for huge pages of
+    // their own and are taken from an arena of the env
+    if (plan.huge_pages) {
+        set_huge_pages(true);
+        sim_env.use_huge_page_arena();
+    }
+
+    sim_env.reserve<mnist_io>(plan.mnist_ios.size());
+    sim_env.reserve<idx_stream_io>(plan.idx_streams.size());
+    sim_env.reserve<synthetic_io>(plan.synthetics.size());
+    sim_env.reserve<replay>(plan.replays.size());
+    sim_env.reserve<external_input>(plan.external_inputs.size());
+    sim_env.reserve<ngm2::neuron_group_t>(plan.neuron_groups.size());
+    sim_env.reserve<output_tap>(plan.output_taps.size());
+    sim_env.reserve<recorder>(plan.recorders.size());
+
+    for (auto &cfg : plan.mnist_ios) {
+        sim_env.emplace_back<mnist_io>(
+            cfg.id, cfg.change_interval, cfg.image_file, cfg.label_file, cfg.random_seed, cfg.outp_elem
+        );
+        auto &io = sim_env.get_entities<mnist_io>().value()->back();
+        io.set_run_ahead(cfg.run_ahead);
+        if (cfg.augment_workers > 0)
+            io.set_augmentation(cfg.augment, cfg.augment_workers, cfg.augment_depth);
+        io.set_noise_variants(cfg.noise_variants);
+    }
+    for (auto &cfg : plan.idx_streams) {
+        sim_env.emplace_back<idx_stream_io>(
+            cfg.id, cfg.change_interval, cfg.image_file, cfg.label_file, cfg.params, cfg.random_seed, cfg.outp_elem
+        );
+        if (!sim_env.get_entities<idx_stream_io>().value()->back().is_valid())
+            return false;
+    }
+    for (auto &cfg : plan.synthetics)
+        sim_env.emplace_back<synthetic_io>(cfg.id, cfg.change_interval, cfg.params, cfg.random_seed, cfg.outp_elem);
+    for (auto &cfg : plan.replays) {
+        sim_env.emplace_back<replay>(cfg.id, std::move(cfg.file_name), cfg.loop, cfg.stream_id);
+        if (!sim_env.get_entities<replay>().value()->back().is_valid())
+            return false;
+    }
+    for (auto &cfg : plan.external_inputs)
+        sim_env.emplace_back<external_input>(cfg.id, cfg.size, cfg.queue_depth, cfg.on_empty, cfg.outp_elem);
+    for (auto &params : plan.neuron_groups)
+        sim_env.emplace_back<ngm2::neuron_group_t>(std::move(params));
+    for (auto &cfg : plan.output_taps)
+        sim_env.emplace_back<output_tap>(cfg.id, std::move(cfg.inp_ids), cfg.input_size, cfg.queue_depth, std::move(cfg.inp_delays));
+    for (auto &cfg : plan.recorders)
+        sim_env.emplace_back<recorder>(cfg.id, std::move(cfg.inp_ids), std::move(cfg.file_name), cfg.params);
+
+    // the input sizes can only be validated against the actual output sizes (e.g., of the mnist images)
+    std::unordered_map<std::size_t,std::size_t> outp_sizes;
+    for (auto &io_ent : sim_env.iterate_entities())
+        outp_sizes.emplace(io_ent.get_outp_id(), io_ent.get_outp_size());
+    for (const auto &ent : plan.entities) {
+        if (ent.input_size == 0)
+            continue;
+        std::size_t inp_size = 0;
+        for (const auto inp_id : ent.inp_ids)
+            inp_size += outp_sizes.at(inp_id);
+        if (inp_size != ent.input_size) {
+            std::fprintf(stderr, "input size %zu of entity %zu does not match the size of its inputs (%zu)\n",
+                ent.input_size, ent.id, inp_size);
+            return false;
+        }
+    }
+
+    sim_env.init_io_buffers();
+    if (!plan.partitions.empty())
+        sim_env.set_schedule(plan.partitions);
+    for (const auto &ent : plan.entities)
+        sim_env.set_clock(ent.id, ent.clock_divider, ent.clock_phase);
+    if (plan.freeze)
+        return sim_env.freeze(plan.freeze->source, plan.freeze->ids, plan.freeze->params);
+    return true;
+}
+
+} // sim